@@ -0,0 +1,39 @@
+#!/bin/bash
+## ========================================================================== ##
+## Copyright (c) 2014-2020 The University of Texas at Austin.                 ##
+## All rights reserved.                                                       ##
+##                                                                            ##
+## Licensed under the Apache License, Version 2.0 (the "License");            ##
+## you may not use this file except in compliance with the License.           ##
+## A copy of the License is included with this software in the file LICENSE.  ##
+## If your copy does not contain the License, you may obtain a copy of the    ##
+## License at:                                                                ##
+##                                                                            ##
+##     https://www.apache.org/licenses/LICENSE-2.0                            ##
+##                                                                            ##
+## Unless required by applicable law or agreed to in writing, software        ##
+## distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  ##
+## WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           ##
+## See the License for the specific language governing permissions and        ##
+## limitations under the License.                                             ##
+##                                                                            ##
+## ========================================================================== ##
+
+
+
+# Compare Schlieren tracing throughput with gradients computed on the fly
+# (six extra volume samples per bend) against the precomputed gradient field.
+#
+# usage: benchmark.sh [width height]
+# Set MPI_COMMAND (e.g. "mpirun -np 4") to run distributed.
+
+W=${1:-1920}
+H=${2:-1080}
+GXY_SCHLIEREN=${GXY_SCHLIEREN:-gxyschlieren}
+
+for test in "-S1 csafe-1.state" "-S2 csafe-2.state"; do
+  for mode in -g -G; do
+    rays=$(${MPI_COMMAND} ${GXY_SCHLIEREN} -s $W $H $mode $test 2>/dev/null | grep "TIMING rays/sec" | awk '{print $3}')
+    echo "$test $mode: $rays rays/sec"
+  done
+done
@@ -45,6 +45,8 @@ syntax(char *a)
   cerr << "  -S k       render only every k'th rendering" << endl;
   cerr << "  -c         client/server interface" << endl;
   cerr << "  -N         max number of simultaneous renderings (VERY large)" << endl;
+  cerr << "  -w         write each RenderingSet's images before starting the next (default: overlap with next render)" << endl;
+  cerr << "  -T         split each rendering's framebuffer into tiles held by all processes (default: held by one)" << endl;
   exit(1);
 }
 
@@ -72,6 +74,8 @@ int main(int argc,  char *argv[])
   ClientServer cs;
   int maxConcurrentRenderings = 99999999;
   bool override_windowsize = false;
+  bool async_images = true;
+  bool tiled = false;
 
   for (int i = 1; i < argc; i++)
   {
@@ -87,6 +91,8 @@ int main(int argc,  char *argv[])
     }
     else if (!strcmp(argv[i], "-S")) skip = atoi(argv[++i]);
     else if (!strcmp(argv[i], "-N")) maxConcurrentRenderings = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-w")) async_images = false;
+    else if (!strcmp(argv[i], "-T")) tiled = true;
     else if (statefile == "")   statefile = argv[i];
     else syntax(argv[0]);
   }
@@ -178,10 +184,9 @@ int main(int argc,  char *argv[])
         exit(1);
       }
 
-    vector<RenderingSetP> theRenderingSets;
-    theRenderingSets.push_back(RenderingSet::NewP());
+    vector< pair<CameraP, VisualizationP> > theViews;
 
-		int k = 0, index = 0;
+		int k = 0;
     for (auto c : theCameras)
       for (auto v : theVisualizations)
       {
@@ -191,12 +196,30 @@ int main(int argc,  char *argv[])
           continue;
         }
 
-        if (theRenderingSets.back()->GetNumberOfRenderings() >= maxConcurrentRenderings)
-          theRenderingSets.push_back(RenderingSet::NewP());
+        theViews.push_back(pair<CameraP, VisualizationP>(c, v));
 
-        RenderingP theRendering = Rendering::NewP();
+        k ++;
+      }
+
+    // Create all the Renderings and RenderingSets up front so that each costs
+    // a single collective rather than one per object
+
+    int nRenderingSets = (theViews.size() + maxConcurrentRenderings - 1) / maxConcurrentRenderings;
+    if (nRenderingSets == 0) nRenderingSets = 1;
 
-        theRendering->SetTheOwner(index++ % mpiSize );
+    vector<RenderingSetP> theRenderingSets = RenderingSet::NewP(nRenderingSets);
+    vector<RenderingP> theRenderings = Rendering::NewP(theViews.size());
+
+    vector<KeyedObjectP> theBatch;
+
+    int index = 0;
+    for (auto& cv : theViews)
+    {
+        CameraP c = cv.first;
+        RenderingP theRendering = theRenderings[index];
+
+        theRendering->SetTheOwner(index % mpiSize );
+        theRendering->SetTiled(tiled);
         if (override_windowsize)
         {
             c->set_width(width);
@@ -204,19 +227,24 @@ int main(int argc,  char *argv[])
         }
         theRendering->SetTheCamera(c);
         theRendering->SetTheDatasets(theDatasets);
-        theRendering->SetTheVisualization(v);
-        if (! theRendering->Commit())
-        {
-          std::cerr << "error committing theRendering\n";
-          theApplication.QuitApplication();
-          theApplication.Wait();
-          exit(1);
-        }
+        theRendering->SetTheVisualization(cv.second);
 
-        theRenderingSets.back()->AddRendering(theRendering);
+        theRenderingSets[index / maxConcurrentRenderings]->AddRendering(theRendering);
+        theBatch.push_back(theRendering);
 
-        k ++;
-      }
+        index ++;
+    }
+
+    if (! KeyedObject::CommitBatch(theBatch))
+    {
+      std::cerr << "error committing theRenderings\n";
+      theApplication.QuitApplication();
+      theApplication.Wait();
+      exit(1);
+    }
+
+    theBatch.clear();
+    theRenderings.clear();
 
     cout << "index = " << index << endl;
 
@@ -263,12 +291,21 @@ int main(int argc,  char *argv[])
 #endif
       rs->WaitForDone();
 
-      rs->SaveImages(cinema ? (cdb + "/image/image").c_str() : "image");
+      // Asynchronously, the images are snapshotted and written in the background
+      // while the next RenderingSet renders
+
+      if (async_images)
+        rs->SaveImagesAsync(theRenderer, cinema ? (cdb + "/image/image").c_str() : "image");
+      else
+        rs->SaveImages(cinema ? (cdb + "/image/image").c_str() : "image");
 
       long t1 = my_time();
       cout << rs->GetNumberOfRenderings() << ": " << ((t1 - t0) / 1000000000.0) << " seconds" << endl;
     }
 
+    if (async_images)
+      RenderingSet::FlushImages(theRenderer);
+
     long t_done = my_time();
     cout << "TIMING total " << (t_done - t_rendering_start) / 1000000000.0 << " seconds" << endl;
 
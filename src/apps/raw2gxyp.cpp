@@ -0,0 +1,113 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+// Wrap a raw particle dump (the same xyz[v] float records that partition
+// reads) in a .gxyp header so it can be loaded directly by Particles, with
+// each process reading its own slice and redistributing in parallel.
+
+#include <iostream>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "Particles.h"
+
+using namespace gxy;
+using namespace std;
+
+void
+syntax(char *a)
+{
+  cerr << "syntax: " << a << " [options] ifile ofile.gxyp" << endl;
+  cerr << "options:" << endl;
+  cerr << "    -V                     input has v per point (no)" << endl;
+  exit(1);
+}
+
+#define POINTS_PER_BUFFER  1000000
+
+int
+main(int argc, char *argv[])
+{
+  string iname = "", oname = "";
+  bool input_has_v = false;
+
+  for (int i = 1; i < argc; i++)
+    if (argv[i][0] == '-')
+      switch(argv[i][1])
+      {
+        case 'V': input_has_v = true; break;
+        default: syntax(argv[0]);
+      }
+    else if (iname == "") iname = argv[i];
+    else if (oname == "") oname = argv[i];
+    else syntax(argv[0]);
+
+  if (iname == "" || oname == "")
+    syntax(argv[0]);
+
+  size_t itemsize = (input_has_v ? 4 : 3)*sizeof(float);
+
+  struct stat info;
+  if (stat(iname.c_str(), &info))
+  {
+    cerr << "cannot stat " << iname << endl;
+    exit(1);
+  }
+
+  if (info.st_size % itemsize)
+  {
+    cerr << iname << " is not a whole number of " << itemsize << "-byte records" << endl;
+    exit(1);
+  }
+
+  FILE *in = fopen(iname.c_str(), "rb");
+  FILE *out = fopen(oname.c_str(), "wb");
+  if (! in || ! out)
+  {
+    cerr << "cannot open " << (in ? oname : iname) << endl;
+    exit(1);
+  }
+
+  ParticleFileHeader hdr;
+  memcpy(hdr.magic, "GXYP", 4);
+  hdr.has_data = input_has_v ? 1 : 0;
+  hdr.count = info.st_size / itemsize;
+
+  fwrite(&hdr, sizeof(hdr), 1, out);
+
+  char *buffer = new char[POINTS_PER_BUFFER * itemsize];
+  for (size_t n; (n = fread(buffer, itemsize, POINTS_PER_BUFFER, in)) > 0; )
+    if (fwrite(buffer, itemsize, n, out) != n)
+    {
+      cerr << "write error" << endl;
+      exit(1);
+    }
+
+  delete[] buffer;
+
+  fclose(in);
+  fclose(out);
+
+  cerr << hdr.count << " particles written to " << oname << endl;
+  return 0;
+}
@@ -26,11 +26,18 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
 
 using namespace std;
 
 #include "rapidjson/document.h"
 #include "rapidjson/filereadstream.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
 
 using namespace rapidjson;
 
@@ -62,12 +69,22 @@ void syntax(char *a)
     cerr << "  -p port          port (5001)\n";
     cerr << "  -l layout        layout file (layout.json)\n";
     cerr << "  -c               cycle\n";
+    cerr << "  -S               hand time steps to co-located Galaxy ranks in shared memory\n";
   }
     
   MPI_Finalize();
   exit(0);
 }
 
+// Matches SocketConnector::ShmDescriptor; sent in place of the data when
+// time steps are published in shared memory
+
+struct ShmDescriptor
+{
+  char    name[256];
+  int64_t size;
+};
+
 #include <signal.h>
 
 static gxy::SocketHandler *master = NULL;
@@ -97,6 +114,7 @@ main(int argc, char **argv)
   int delay = 5;
   int nsteps = 10;
   bool cycle = false;
+  bool shm = false;
 
   signal(SIGINT, IntHandler);
 
@@ -122,6 +140,7 @@ main(int argc, char **argv)
         case 'd': delay = atoi(argv[++i]); break;
         case 'n': nsteps = atoi(argv[++i]); break;
         case 'c': cycle = true; break;
+        case 'S': shm = true; break;
         default:
           syntax(argv[0]);
       }
@@ -249,7 +268,21 @@ main(int argc, char **argv)
 
     if (mpiRank == 0 && t == 0)
     {
-      string cmd = string("new ") + datadesc + ";";
+      string desc = datadesc;
+
+      if (shm)
+      {
+        Document doc;
+        doc.Parse(datadesc);
+        doc.AddMember("shared memory", Value().SetBool(true), doc.GetAllocator());
+
+        StringBuffer strbuf;
+        Writer<StringBuffer> writer(strbuf);
+        doc.Accept(writer);
+        desc = strbuf.GetString();
+      }
+
+      string cmd = string("new ") + desc + ";";
       if (! master->CSendRecv(cmd))
       {
         cerr << "sending new failed... " << cmd << "\n";
@@ -407,13 +440,44 @@ main(int argc, char **argv)
 
       MPI_Barrier(MPI_COMM_WORLD);
   
+      size_t sz = point_count * (isvector[i] ? 3 : 1) * sizeof(float);
+
       skt->ConnectToServer(host.c_str(), port);
-      skt->Send(interpolated[i], point_count * (isvector[i] ? 3 : 1) * sizeof(float));
+
+      ShmDescriptor desc;
+      if (shm)
+      {
+        // Publish the time step in a fresh shared memory object and send
+        // only its name.  Galaxy maps it privately, so once it has acked
+        // the name can go away
+
+        snprintf(desc.name, sizeof(desc.name), "/simsim-%d-%d-%s-%d", getpid(), mpiRank, name.c_str(), it);
+        desc.size = sz;
+
+        int fd = shm_open(desc.name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        void *ptr = (fd < 0 || ftruncate(fd, sz)) ? MAP_FAILED : mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+          cerr << "unable to create shared memory " << desc.name << "\n";
+          MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        memcpy(ptr, interpolated[i], sz);
+        munmap(ptr, sz);
+        close(fd);
+
+        skt->Send(&desc, sizeof(desc));
+      }
+      else
+        skt->Send(interpolated[i], sz);
 
       int rply;
       skt->Receive(&rply, sizeof(rply), 1);
       std::cerr << mpiRank << ": received ack for " << name << "\n";
 
+      if (shm)
+        shm_unlink(desc.name);
+
       if (mpiRank == 0)
       {
         string rply;
@@ -425,7 +489,9 @@ main(int argc, char **argv)
       }
     }
 
-#if 0
+    // Galaxy received the variables into back buffers while it went on
+    // rendering the previous time step; tell it to swap them in
+
     if (mpiRank == 0)
     {
       string cmd = string("commit;");
@@ -435,7 +501,6 @@ main(int argc, char **argv)
         status = 0;
       }
     }
-#endif
 
     skt->CloseSocket();
     skt->Delete();
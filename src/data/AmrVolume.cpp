@@ -20,9 +20,13 @@
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <alloca.h>
+#include <string.h>
 
 #include "Application.h"
 #include "AmrVolume.h"
+#include "OsprayAmrVolume.h"
 
 namespace gxy
 {
@@ -37,7 +41,8 @@ AmrVolume::initialize()
 
 AmrVolume::~AmrVolume()
 {
-    // put stuff here
+    for (auto s : gridsamples)
+        delete[] s;
 }
 
 void
@@ -244,11 +249,15 @@ AmrVolume::local_import(char *fname, MPI_Comm c)
     else
         std::cerr << " scalars type not flota " << std::endl;
     type = gsp->GetScalarType() == VTK_FLOAT?FLOAT:UCHAR;
+    // keep every component; samples are interleaved per point
+    number_of_components = gsp->GetNumberOfScalarComponents();
+    npts = npts * number_of_components;
     fltptr = new float[npts];
     float* dptr = (float*)gsp->GetScalarPointer();
     //gridsamples.push_back((float*)gsp->GetScalarPointer());
     for(int p = 0; p<npts;p++) fltptr[p] = dptr[p];
     gridsamples.push_back(fltptr);
+    gridlevel.push_back(0);
     float* yourmama = (float*)gsp->GetScalarPointer();
     std::cerr << "first float from gsp" << yourmama[0]<< " " << yourmama[1] << std::endl;
     gsp->GetScalarRange(range);
@@ -279,10 +288,11 @@ AmrVolume::local_import(char *fname, MPI_Comm c)
             tmpvec.z = dvector[2];
             gridspacing.push_back(tmpvec);
             dptr = (float*)gsp->GetScalarPointer();
-            npts = gsp->GetNumberOfPoints();
+            npts = gsp->GetNumberOfPoints() * number_of_components;
             fltptr = new float[npts];
             for(int p = 0; p<npts;p++) fltptr[p] = dptr[p];
             gridsamples.push_back(fltptr);
+            gridlevel.push_back(l);
             //gridsamples.push_back((float*)gsp->GetScalarPointer());
         }
     }
@@ -303,8 +313,245 @@ AmrVolume::local_import(char *fname, MPI_Comm c)
     // global box same as local box in this one d example... bad juju. 
     global_box = Box(lowerbound,upperbound);
 
+    build_grid_index();
+
     return true;
 }
+
+// Grids are few and large relative to cells, so a small leaf size keeps
+// the tree shallow without making the leaf scan expensive.
+
+#define AMR_INDEX_LEAF_SIZE 4
+
+void
+AmrVolume::build_grid_index()
+{
+    gridindex.clear();
+    gridindexgrids.clear();
+
+    // Only grids that overlap the local partition participate
+
+    Box *lb = get_local_box();
+    for (int i = 0; i < gridsamples.size(); i++)
+    {
+        vec3f lo = gridorigin[i];
+        vec3f hi = lo + vec3f(gridcounts[i].x * gridspacing[i].x,
+                              gridcounts[i].y * gridspacing[i].y,
+                              gridcounts[i].z * gridspacing[i].z);
+
+        if (hi.x < lb->xyz_min.x || lo.x > lb->xyz_max.x ||
+            hi.y < lb->xyz_min.y || lo.y > lb->xyz_max.y ||
+            hi.z < lb->xyz_min.z || lo.z > lb->xyz_max.z)
+            continue;
+
+        gridindexgrids.push_back(i);
+    }
+
+    gridindexdepth = 0;
+    if (gridindexgrids.size())
+    {
+        gridindex.reserve(2 * gridindexgrids.size());
+        build_grid_index_node(0, gridindexgrids.size(), 1);
+    }
+}
+
+int
+AmrVolume::build_grid_index_node(int first, int count, int depth)
+{
+    if (depth > gridindexdepth)
+        gridindexdepth = depth;
+
+    int n = gridindex.size();
+    gridindex.push_back(GridIndexNode());
+
+    vec3f lo = gridorigin[gridindexgrids[first]], hi = lo;
+    for (int i = first; i < first + count; i++)
+    {
+        int g = gridindexgrids[i];
+        vec3f glo = gridorigin[g];
+        vec3f ghi = glo + vec3f(gridcounts[g].x * gridspacing[g].x,
+                                gridcounts[g].y * gridspacing[g].y,
+                                gridcounts[g].z * gridspacing[g].z);
+        lo.x = std::min(lo.x, glo.x); hi.x = std::max(hi.x, ghi.x);
+        lo.y = std::min(lo.y, glo.y); hi.y = std::max(hi.y, ghi.y);
+        lo.z = std::min(lo.z, glo.z); hi.z = std::max(hi.z, ghi.z);
+    }
+
+    gridindex[n].lo = lo;
+    gridindex[n].hi = hi;
+    gridindex[n].first = first;
+    gridindex[n].count = count;
+    gridindex[n].left = gridindex[n].right = -1;
+
+    if (count <= AMR_INDEX_LEAF_SIZE)
+        return n;
+
+    // Split at the median grid center along the longest axis of the node
+
+    vec3f d = hi - lo;
+    int axis = (d.x > d.y) ? (d.x > d.z ? 0 : 2) : (d.y > d.z ? 1 : 2);
+
+    auto center = [this, axis](int g) -> float
+    {
+        float o = ((float *)&gridorigin[g])[axis];
+        return o + 0.5 * ((int *)&gridcounts[g])[axis] * ((float *)&gridspacing[g])[axis];
+    };
+
+    int half = count >> 1;
+    std::nth_element(gridindexgrids.begin() + first,
+                     gridindexgrids.begin() + first + half,
+                     gridindexgrids.begin() + first + count,
+                     [&center](int a, int b) { return center(a) < center(b); });
+
+    // gridindex may be reallocated by the recursion, so don't hold a reference
+
+    int left = build_grid_index_node(first, half, depth + 1);
+    int right = build_grid_index_node(first + half, count - half, depth + 1);
+
+    gridindex[n].left = left;
+    gridindex[n].right = right;
+    gridindex[n].count = 0;
+
+    return n;
+}
+
+int
+AmrVolume::find_grid(vec3f& p)
+{
+    if (gridindex.size() == 0)
+        return -1;
+
+    int best = -1, best_level = -1;
+
+    // Each level visited leaves at most one sibling behind on the stack
+
+    int *stack = (int *)alloca((gridindexdepth + 1) * sizeof(int)), sp = 0;
+    stack[sp++] = 0;
+
+    while (sp)
+    {
+        GridIndexNode& node = gridindex[stack[--sp]];
+
+        if (p.x < node.lo.x || p.x > node.hi.x ||
+            p.y < node.lo.y || p.y > node.hi.y ||
+            p.z < node.lo.z || p.z > node.hi.z)
+            continue;
+
+        if (node.left == -1)
+        {
+            for (int i = node.first; i < node.first + node.count; i++)
+            {
+                int g = gridindexgrids[i];
+                if (gridlevel[g] <= best_level)
+                    continue;
+
+                vec3f q = p - gridorigin[g];
+                if (q.x < 0 || q.x > gridcounts[g].x * gridspacing[g].x ||
+                    q.y < 0 || q.y > gridcounts[g].y * gridspacing[g].y ||
+                    q.z < 0 || q.z > gridcounts[g].z * gridspacing[g].z)
+                    continue;
+
+                best = g;
+                best_level = gridlevel[g];
+            }
+        }
+        else
+        {
+            stack[sp++] = node.left;
+            stack[sp++] = node.right;
+        }
+    }
+
+    return best;
+}
+
+bool
+AmrVolume::Sample(vec3f& p, float* result)
+{
+    int g = find_grid(p);
+    if (g < 0)
+        return false;
+
+    vec3f q = p - gridorigin[g];
+    q.x = q.x / gridspacing[g].x;
+    q.y = q.y / gridspacing[g].y;
+    q.z = q.z / gridspacing[g].z;
+
+    // Lower corner of the containing cell, clamped so that a point on the 
+    // upper face of the grid interpolates within the last cell
+
+    vec3i c = gridcounts[g];
+    vec3i ll(floor(q.x), floor(q.y), floor(q.z));
+    if (ll.x >= c.x) ll.x = c.x - 1;
+    if (ll.y >= c.y) ll.y = c.y - 1;
+    if (ll.z >= c.z) ll.z = c.z - 1;
+
+    float dx = q.x - ll.x;
+    float dy = q.y - ll.y;
+    float dz = q.z - ll.z;
+
+    // Samples are point data so there are counts + 1 along each axis, 
+    // with number_of_components interleaved values per point
+
+    int nc = number_of_components;
+    int sx = nc;
+    int sy = sx * (c.x + 1);
+    int sz = sy * (c.y + 1);
+    float *s = gridsamples[g] + ll.z*sz + ll.y*sy + ll.x*sx;
+
+    for (int i = 0; i < nc; i++, s++)
+    {
+        float t00 = (1-dx)*s[0]         + dx*s[sx];
+        float t10 = (1-dx)*s[sy]        + dx*s[sy+sx];
+        float t01 = (1-dx)*s[sz]        + dx*s[sz+sx];
+        float t11 = (1-dx)*s[sz+sy]     + dx*s[sz+sy+sx];
+        float t0  = (1-dy)*t00 + dy*t10;
+        float t1  = (1-dy)*t01 + dy*t11;
+
+        result[i] = (1-dz)*t0 + dz*t1;
+    }
+
+    return true;
+}
+
+int
+AmrVolume::Sample(int n, vec3f *p, float *results, unsigned char *inside)
+{
+    int nc = number_of_components;
+    int nInside = 0;
+    for (int i = 0; i < n; i++)
+    {
+        float *r = results + i*nc;
+        bool in = Sample(p[i], r);
+        if (! in) memset(r, 0, nc*sizeof(float));
+        if (inside) inside[i] = in ? 1 : 0;
+        if (in) nInside++;
+    }
+    return nInside;
+}
+
+float
+AmrVolume::CellSize(vec3f& p)
+{
+    int g = find_grid(p);
+    if (g < 0)
+        return super::CellSize(p);
+
+    vec3f d = gridspacing[g];
+    return (d.x < d.y) ? (d.x < d.z ? d.x : d.z) : (d.y < d.z ? d.y : d.z);
+}
+
+OsprayObjectP 
+AmrVolume::CreateTheOSPRayEquivalent(KeyedDataObjectP kdop)
+{
+    if (! ospData || hasBeenModified())
+    {
+        ospData = OsprayObject::Cast(OsprayAmrVolume::NewP(AmrVolume::Cast(kdop)));
+        setModified(false);
+    }
+
+    return ospData;
+}
 int
 AmrVolume::get_grid_index(int level, int grid)
 {
@@ -51,10 +51,50 @@ public:
         /*! This action is performed in response to a ImportMsg */
         virtual bool local_import(char *fname, MPI_Comm c);
 
-        //! method to read gxyamr data
-        /*! an internal method used to load gxyamr metadata */
+        //! Interpolate p in the finest grid that contains it
+        /*! returns false if no grid in the local partition contains p */
+        virtual bool Sample(vec3f& p, float* i);
+        using Volume::Sample;
+
+        //! Interpolate a batch of points, each in the finest grid that contains it
+        virtual int Sample(int n, vec3f *p, float *results, unsigned char *inside = NULL);
+
+        //! smallest spacing of the finest grid that contains p
+        virtual float CellSize(vec3f& p);
+
+        //! the OSPRay equivalent of an AmrVolume is an OSPRay amr_volume
+        virtual OsprayObjectP CreateTheOSPRayEquivalent(KeyedDataObjectP);
+
+        //! number of grids (over all levels) in the local partition
+        int get_number_of_grids() { return gridsamples.size(); }
+        //! refinement level of the index'th grid
+        int get_grid_level(int index) { return gridlevel[index]; }
+        //! origin, spacing, cell counts and point samples of the index'th grid
+        /*! samples hold number_of_components interleaved values per point */
+        void get_grid(int index, vec3f& origin, vec3f& spacing, vec3i& counts, float*& samples)
+        {
+            origin = gridorigin[index];
+            spacing = gridspacing[index];
+            counts = gridcounts[index];
+            samples = gridsamples[index];
+        }
 
 private:
+        //! node of the kd tree over grid boxes.  Leaves (left == -1) 
+        //  reference count entries of gridindexgrids starting at first
+        struct GridIndexNode
+        {
+            vec3f lo, hi;
+            int left, right;
+            int first, count;
+        };
+
+        //! build the kd tree over the grids that overlap the local partition
+        void build_grid_index();
+        int build_grid_index_node(int first, int count, int depth);
+        //! index of the finest grid containing p, or -1
+        int find_grid(vec3f& p);
+
         enum amrtype {GXYAMR,ENZOAMR,NOEXT};
         //! method to read gxyamr data
         /*! an internal method used to load gxyamr metadata */
@@ -84,5 +124,9 @@ protected:
         std::vector<vec3f> gridspacing;
         std::vector<vec3i> gridcounts;
         std::vector<float*> gridsamples;
+        std::vector<int> gridlevel;
+        std::vector<GridIndexNode> gridindex;
+        std::vector<int> gridindexgrids;
+        int gridindexdepth = 0;
 };
 } // namespace gxy
@@ -83,6 +83,13 @@ Box::~Box() {};
 
 int
 Box::exit_face(float x, float y, float z, float dx, float dy, float dz)
+{
+	float t;
+	return exit_face(x, y, z, dx, dy, dz, t);
+}
+
+int
+Box::exit_face(float x, float y, float z, float dx, float dy, float dz, float& t)
 {
 	float tx = (dx > 0.0001) ? ((xyz_max.x - x) / dx) : (dx < -0.0001) ? ((xyz_min.x - x) / dx) : FLT_MAX;
 	float ty = (dy > 0.0001) ? ((xyz_max.y - y) / dy) : (dy < -0.0001) ? ((xyz_min.y - y) / dy) : FLT_MAX;
@@ -90,9 +97,9 @@ Box::exit_face(float x, float y, float z, float dx, float dy, float dz)
 	if (tx < 0) tx = FLT_MAX;
 	if (ty < 0) ty = FLT_MAX;
 	if (tz < 0) tz = FLT_MAX;
-	if (tx < ty && tx < tz) return (dx < 0) ? 0 : 1;
-	else if (ty < tz) return (dy < 0) ? 2 : 3;
-	else return (dz < 0) ? 4 : 5;
+	if (tx < ty && tx < tz) { t = tx; return (dx < 0) ? 0 : 1; }
+	else if (ty < tz) { t = ty; return (dy < 0) ? 2 : 3; }
+	else { t = tz; return (dz < 0) ? 4 : 5; }
 	// TODO: this will silently return 4 or 5 if vector origin is outside box. Fix?
 }
 
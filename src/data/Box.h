@@ -133,6 +133,9 @@ public:
 	 *          `5` if `dx = dy = dz = 0`.
 	 */
 	int exit_face(float x, float y, float z, float dx, float dy, float dz);
+	//! computes the exit face for a given vector, and the distance along the vector to it
+	/*! as exit_face above; `t` is set to the distance along `dx,dy,dz` to the exit point */
+	int exit_face(float x, float y, float z, float dx, float dy, float dz, float& t);
 
 	//! does the given vector intersects this Box?
 	/*! \returns true if the vector intersects the box, false otherwise.
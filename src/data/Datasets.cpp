@@ -108,7 +108,34 @@ Datasets::loadTyped(Value& v)
 
 	KeyedDataObjectP kop;
 	if (type == "Particles")
-		kop = Particles::NewP();
+	{
+		ParticlesP p = Particles::NewP();
+
+		// Particles read from a .gxyp file are distributed over the partitions
+		// of the named dataset, by default any Volume already loaded
+
+		KeyedDataObjectP source;
+		if (v.HasMember("partitioning"))
+		{
+			source = Find(v["partitioning"].GetString());
+			if (! source)
+			{
+				std::cerr << "Particles partitioning refers to unknown dataset: " << v["partitioning"].GetString() << "\n";
+				set_error(1);
+				return false;
+			}
+		}
+		else
+			for (auto d : datasets)
+				if (Volume::Cast(d.second))
+				{
+					source = d.second;
+					break;
+				}
+
+		p->SetPartitionSource(source, v.HasMember("halo") ? v["halo"].GetDouble() : 0.0);
+		kop = p;
+	}
 	else if (type == "Volume")
     kop = Volume::NewP();
 	else if (type == "Triangles")
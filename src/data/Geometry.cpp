@@ -23,7 +23,9 @@
 #include <memory.h>
 #include <vector>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #include "Geometry.h"
 #include "Particles.h"
@@ -250,6 +252,42 @@ Geometry::local_import(char *p, MPI_Comm c)
 
     pset = (vtkPointSet *)(rdr->GetOutput());
   }
+  else if (v.HasMember("shm"))
+  {
+    // A co-located producer left a VTK legacy string in a POSIX shared memory
+    // object; read it in place rather than pulling it through a socket
+
+    string name(v["shm"].GetString());
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info))
+    {
+      cerr << "error opening shared memory " << name << "\n";
+      exit(1);
+    }
+
+    void *ptr = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (ptr == MAP_FAILED)
+    {
+      cerr << "error mapping shared memory " << name << "\n";
+      exit(1);
+    }
+
+    vtkNew<vtkCharArray> bufArray;
+    bufArray->SetArray((char *)ptr, info.st_size, 1);
+
+    vtkNew<vtkUnstructuredGridReader> rdr;
+    rdr->ReadFromInputStringOn();
+    rdr->SetInputArray(bufArray.GetPointer());
+    rdr->Update();
+
+    pset = (vtkPointSet *)(rdr->GetOutput());
+
+    munmap(ptr, info.st_size);
+  }
 
   bool r = load_from_vtkPointSet(pset);
 
@@ -70,6 +70,7 @@ KeyedDataObject::CopyPartitioning(KeyedDataObjectP o)
 	global_box = *o->get_global_box();
 	for (int i = 0; i < 6; i++)
 			neighbors[i] = o->get_neighbor(i);
+	partitioning = *o->get_partitioning();
 }
 
 void 
@@ -78,6 +79,8 @@ KeyedDataObject::initialize()
 	super::initialize();
   time_varying = false;
   attached = false;
+  modified = false;
+  modification_count = 0;
   skt = NULL;
 }
 
@@ -112,4 +115,65 @@ KeyedDataObject::set_neighbors(int *n)
   memcpy(neighbors, n, 6*sizeof(int));
 }
 
+static void
+factor(int ijk, vec3i &factors)
+{
+  // If ijk is prime, 1, 1, ijk will be chosen, i+j+k == ijk+2
+
+  if (ijk == 1)
+  {
+    factors.x = factors.y = factors.z = 1;
+    return;
+  }
+
+  int mm = ijk+3;
+  for (int i = 1; i <= ijk>>1; i++)
+  {
+    int jk = ijk / i;
+    if (ijk == (i * jk))
+    {
+      for (int j = 1; j <= jk>>1; j++)
+      {
+        int k = jk / j;
+        if (jk == (j * k))
+        {
+          int m = i + j + k;
+          if (m < mm)
+          {
+            mm = m;
+            factors.x = i;
+            factors.y = j;
+            factors.z = k;
+          }
+        }
+      }
+    }
+  }
+}
+
+bool
+KeyedDataObject::get_global_partitions(vec3i& global_partitions)
+{
+	int rank = GetTheApplication()->GetRank();
+	int size = GetTheApplication()->GetSize();
+
+  if (getenv("PARTITIONING"))
+  {
+    if (3 != sscanf(getenv("PARTITIONING"), "%d,%d,%d", &global_partitions.x, &global_partitions.y, &global_partitions.z))
+    {
+      if (rank == 0) cerr << "ERROR: Illegal PARTITIONING environment variable" << endl;
+      return false;
+    }
+    if ((global_partitions.x*global_partitions.y*global_partitions.z) != size)
+    {
+      if (rank == 0) cerr << "ERROR: json PARTITIONING does not multiply to current MPI size" << endl;
+      return false;
+    }
+  }
+  else
+    factor(size, global_partitions);
+
+  return true;
+}
+
 } // namespace gxy
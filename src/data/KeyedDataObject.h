@@ -36,6 +36,7 @@
 #include "Box.h"
 #include "KeyedObject.h"
 #include "OsprayObject.h"
+#include "Partitioning.h"
 
 namespace gxy
 {
@@ -88,6 +89,15 @@ public:
    */
   bool has_neighbor(unsigned int face) { return neighbors[face] >= 0; }
 
+  //! return the process across the given face whose partition contains the point `p` on that face, or -1
+  /*! With a regular decomposition this is just get_neighbor(face); with an irregular one
+   * (see Partitioning) a face may border several partitions and `p` picks between them.
+   */
+  int neighbor_at(int face, vec3f& p) { return partitioning.empty() ? neighbors[face] : partitioning.neighbor_at(face, p); }
+
+  //! return the layout of an irregular decomposition; empty if the decomposition is a regular grid
+  Partitioning *get_partitioning() { return &partitioning; }
+
   //! is this KeyedDataObject time varying?
 	bool is_time_varying() { return time_varying; }
 
@@ -122,11 +132,15 @@ public:
 
   void set_boxes(Box l, Box g) {local_box = l; global_box = g;};
 
-  void setModified(bool m) { modified = m; }
+  void setModified(bool m) { modified = m; if (m) modification_count++; }
   bool hasBeenModified() { return modified; }
 
+  //! the number of times this object has been marked modified; lets caches of derived data detect changes
+  int getModificationCount() { return modification_count; }
+
 protected:
   bool modified;
+  int modification_count;
   OsprayObjectP ospData;
 	vtkClientSocket *skt;
 	std::string filename;
@@ -135,8 +149,12 @@ protected:
 
   virtual bool local_import(char *, MPI_Comm c);
 
+  //! factor the number of processes into a 3D grid of partitions, or take it from the PARTITIONING environment variable (i,j,k)
+  static bool get_global_partitions(vec3i& global_partitions);
+
 	Box global_box, local_box;
 	int neighbors[6];
+	Partitioning partitioning;
 
   //! tell a Galaxy processes to import a given data file
   class ImportMsg : public Work
@@ -24,8 +24,11 @@
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <float.h>
 
 #include "Application.h"
 #include "Particles.h"
@@ -68,6 +71,7 @@ void
 Particles::initialize()
 {
   super::initialize();
+  halo = 0;
 }
 
 Particles::~Particles()
@@ -128,6 +132,335 @@ Particles::load_from_vtkPointSet(vtkPointSet *pset)
   return true;
 }
 
+static bool
+is_binary_particle_file(string s)
+{
+  return s.size() > 5 && s.substr(s.size() - 5) == ".gxyp";
+}
+
+void
+Particles::SetPartitionSource(KeyedDataObjectP p, float h)
+{
+  partition_source = p;
+  halo = h;
+}
+
+bool
+Particles::Import(string s)
+{
+  if (! is_binary_particle_file(s))
+    return super::Import(s);
+
+  // Every process reads its own slice, so only the name and how the
+  // particles are to be distributed go out
+
+  unsigned char args[sizeof(Key) + sizeof(float)];
+  *(Key *)args = partition_source ? partition_source->getkey() : -1;
+  *(float *)(args + sizeof(Key)) = halo;
+
+  set_attached(false);
+  return KeyedDataObject::Import(s, args, sizeof(args));
+}
+
+bool
+Particles::local_import(char *p, MPI_Comm c)
+{
+  if (is_binary_particle_file(p))
+  {
+    char *args = p + strlen(p) + 1;
+    return load_from_binary(p, *(Key *)args, *(float *)(args + sizeof(Key)), c);
+  }
+  else
+    return super::local_import(p, c);
+}
+
+static bool
+read_fully(int fd, void *buf, size_t n, off_t offset)
+{
+  char *p = (char *)buf;
+  while (n > 0)
+  {
+    ssize_t k = pread(fd, p, n, offset);
+    if (k <= 0)
+      return false;
+
+    p += k;
+    n -= k;
+    offset += k;
+  }
+
+  return true;
+}
+
+// distance from p to the nearest point of b; 0 if p is inside
+
+static float
+box_distance(Box& b, vec3f& p)
+{
+  float dx = std::max(0.0f, std::max(b.xyz_min.x - p.x, p.x - b.xyz_max.x));
+  float dy = std::max(0.0f, std::max(b.xyz_min.y - p.y, p.y - b.xyz_max.y));
+  float dz = std::max(0.0f, std::max(b.xyz_min.z - p.z, p.z - b.xyz_max.z));
+  return sqrt(dx*dx + dy*dy + dz*dz);
+}
+
+// distance from p, inside b, to the nearest face of b
+
+static float
+inner_distance(Box& b, vec3f& p)
+{
+  float d = std::min(p.x - b.xyz_min.x, b.xyz_max.x - p.x);
+  d = std::min(d, std::min(p.y - b.xyz_min.y, b.xyz_max.y - p.y));
+  d = std::min(d, std::min(p.z - b.xyz_min.z, b.xyz_max.z - p.z));
+  return d;
+}
+
+bool
+Particles::load_from_binary(string fname, Key source, float halo, MPI_Comm c)
+{
+  int rank = GetTheApplication()->GetRank();
+  int size = GetTheApplication()->GetSize();
+
+  filename = fname;
+
+  // A process that can't read its slice still has to take part in the
+  // collectives below, so everyone agrees on success before going on
+
+  ParticleFileHeader hdr;
+  float *slice = NULL;
+  int n = 0, rsz = 0;
+
+  int ok = 1;
+
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    cerr << "ERROR: unable to open particle file: " << fname << endl;
+    ok = 0;
+  }
+  else if (! read_fully(fd, &hdr, sizeof(hdr), 0) || strncmp(hdr.magic, "GXYP", 4))
+  {
+    cerr << "ERROR: " << fname << " is not a Galaxy particle file" << endl;
+    ok = 0;
+  }
+  else
+  {
+    // Read this process' contiguous slice of the records
+
+    rsz = hdr.has_data ? 4 : 3;
+
+    int64_t first = (hdr.count * rank) / size;
+    int64_t last  = (hdr.count * (rank + 1)) / size;
+    n = last - first;
+
+    slice = new float[n * rsz];
+    if (! read_fully(fd, slice, (size_t)n * rsz * sizeof(float), sizeof(hdr) + first * rsz * sizeof(float)))
+    {
+      cerr << "ERROR: short read from particle file: " << fname << endl;
+      ok = 0;
+    }
+  }
+
+  if (fd >= 0)
+    close(fd);
+
+  MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_LAND, c);
+  if (! ok)
+  {
+    if (slice) delete[] slice;
+    return false;
+  }
+
+  // The partition owned by each process.  Normally these come from the
+  // dataset the particles are to be rendered with, so they land on the process
+  // that owns that region of the volume; failing that, the particles' own
+  // bounding box is split the way Volume splits its grid
+
+  vector<Box> boxes(size);
+
+  KeyedDataObjectP src;
+  if (source != -1)
+    src = KeyedDataObject::GetByKey(source);
+
+  if (src)
+  {
+    float lbox[6], *gboxes = new float[6*size];
+    memcpy(lbox, src->get_local_box()->get_min(), 3*sizeof(float));
+    memcpy(lbox + 3, src->get_local_box()->get_max(), 3*sizeof(float));
+
+    MPI_Allgather(lbox, 6, MPI_FLOAT, gboxes, 6, MPI_FLOAT, c);
+
+    for (int r = 0; r < size; r++)
+      boxes[r] = Box(gboxes + 6*r);
+
+    delete[] gboxes;
+
+    CopyPartitioning(src);
+  }
+  else
+  {
+    float lminmax[6] = {FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX}, gminmax[6];
+
+    for (float *r = slice; r < slice + n*rsz; r += rsz)
+      for (int j = 0; j < 3; j++)
+      {
+        if (r[j] < lminmax[j])   lminmax[j]   = r[j];
+        if (r[j] > lminmax[j+3]) lminmax[j+3] = r[j];
+      }
+
+    // negate the maxes so a single MIN reduction does both
+
+    for (int j = 3; j < 6; j++) lminmax[j] = -lminmax[j];
+    MPI_Allreduce(lminmax, gminmax, 6, MPI_FLOAT, MPI_MIN, c);
+    for (int j = 3; j < 6; j++) gminmax[j] = -gminmax[j];
+
+    vec3i gp;
+    if (! get_global_partitions(gp))
+    {
+      delete[] slice;
+      return false;
+    }
+
+    vec3f gmin(gminmax[0], gminmax[1], gminmax[2]);
+    vec3f gmax(gminmax[3], gminmax[4], gminmax[5]);
+    vec3f d((gmax.x - gmin.x) / gp.x, (gmax.y - gmin.y) / gp.y, (gmax.z - gmin.z) / gp.z);
+
+#define ijk2rank(i, j, k) ((i) + ((j) * gp.x) + ((k) * gp.x * gp.y))
+
+    for (int k = 0; k < gp.z; k++)
+      for (int j = 0; j < gp.y; j++)
+        for (int i = 0; i < gp.x; i++)
+        {
+          vec3f lo(gmin.x + i*d.x, gmin.y + j*d.y, gmin.z + k*d.z);
+          vec3f hi((i == gp.x-1) ? gmax.x : lo.x + d.x,
+                   (j == gp.y-1) ? gmax.y : lo.y + d.y,
+                   (k == gp.z-1) ? gmax.z : lo.z + d.z);
+          boxes[ijk2rank(i, j, k)] = Box(lo, hi);
+        }
+
+    vec3i ijk(rank % gp.x, (rank / gp.x) % gp.y, rank / (gp.x * gp.y));
+
+    neighbors[0] = (ijk.x > 0) ? ijk2rank(ijk.x - 1, ijk.y, ijk.z) : -1;
+    neighbors[1] = (ijk.x < (gp.x-1)) ? ijk2rank(ijk.x + 1, ijk.y, ijk.z) : -1;
+    neighbors[2] = (ijk.y > 0) ? ijk2rank(ijk.x, ijk.y - 1, ijk.z) : -1;
+    neighbors[3] = (ijk.y < (gp.y-1)) ? ijk2rank(ijk.x, ijk.y + 1, ijk.z) : -1;
+    neighbors[4] = (ijk.z > 0) ? ijk2rank(ijk.x, ijk.y, ijk.z - 1) : -1;
+    neighbors[5] = (ijk.z < (gp.z-1)) ? ijk2rank(ijk.x, ijk.y, ijk.z + 1) : -1;
+
+#undef ijk2rank
+
+    partitioning.clear();
+    global_box = Box(gmin, gmax);
+    local_box = boxes[rank];
+  }
+
+  // Each particle goes to the partition that contains it, or the nearest one
+  // if it lies outside them all, and is copied to every other partition within
+  // halo of it so spheres crossing a boundary are complete on both sides.
+  // Particles in a file tend to be spatially coherent, so try the previous
+  // particle's owner first.
+
+  vector<int> dst_rank, dst_particle;
+  dst_rank.reserve(n);
+  dst_particle.reserve(n);
+
+  int *send_counts = new int[size];
+  int *recv_counts = new int[size];
+  int *send_displs = new int[size];
+  int *recv_displs = new int[size];
+
+  for (int i = 0; i < size; i++)
+    send_counts[i] = 0;
+
+  int owner = 0;
+  for (int i = 0; i < n; i++)
+  {
+    float *r = slice + i*rsz;
+    vec3f p(r[0], r[1], r[2]);
+
+    if (! boxes[owner].isIn(p))
+    {
+      int nearest = 0;
+      float nearest_d = FLT_MAX;
+      for (int b = 0; b < size && nearest_d > 0; b++)
+      {
+        float d = box_distance(boxes[b], p);
+        if (d < nearest_d)
+        {
+          nearest = b;
+          nearest_d = d;
+        }
+      }
+      owner = nearest;
+    }
+
+    dst_rank.push_back(owner);
+    dst_particle.push_back(i);
+    send_counts[owner] += 4;
+
+    // the partitions tile space, so a particle further than halo from every
+    // face of its own can't be within halo of any other
+
+    if (halo > 0 && inner_distance(boxes[owner], p) < halo)
+      for (int b = 0; b < size; b++)
+        if (b != owner && box_distance(boxes[b], p) <= halo)
+        {
+          dst_rank.push_back(b);
+          dst_particle.push_back(i);
+          send_counts[b] += 4;
+        }
+  }
+
+  MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, c);
+
+  send_displs[0] = recv_displs[0] = 0;
+  for (int i = 1; i < size; i++)
+  {
+    send_displs[i] = send_displs[i-1] + send_counts[i-1];
+    recv_displs[i] = recv_displs[i-1] + recv_counts[i-1];
+  }
+
+  int nsend = (send_displs[size-1] + send_counts[size-1]) / 4;
+  int nrecv = (recv_displs[size-1] + recv_counts[size-1]) / 4;
+
+  // Pack the slice by destination as (x, y, z, value) records
+
+  float *sendbuf = new float[4*nsend];
+  int *next = new int[size];
+  memcpy(next, send_displs, size*sizeof(int));
+
+  for (int i = 0; i < (int)dst_rank.size(); i++)
+  {
+    float *r = slice + dst_particle[i]*rsz;
+    float *s = sendbuf + next[dst_rank[i]];
+    s[0] = r[0]; s[1] = r[1]; s[2] = r[2];
+    s[3] = hdr.has_data ? r[3] : 0.0;
+    next[dst_rank[i]] += 4;
+  }
+
+  delete[] slice;
+  delete[] next;
+
+  float *recvbuf = new float[4*nrecv];
+  MPI_Alltoallv(sendbuf, send_counts, send_displs, MPI_FLOAT, recvbuf, recv_counts, recv_displs, MPI_FLOAT, c);
+
+  delete[] sendbuf;
+  delete[] send_counts;
+  delete[] recv_counts;
+  delete[] send_displs;
+  delete[] recv_displs;
+
+  allocate(nrecv, 0);
+  for (int i = 0; i < nrecv; i++)
+  {
+    vertices[i] = vec3f(recvbuf[4*i + 0], recvbuf[4*i + 1], recvbuf[4*i + 2]);
+    data[i] = recvbuf[4*i + 3];
+  }
+
+  delete[] recvbuf;
+
+  return true;
+}
+
 OsprayObjectP 
 Particles::CreateTheOSPRayEquivalent(KeyedDataObjectP kdop)
 { 
@@ -28,6 +28,7 @@
 #include <string>
 #include <string.h>
 #include <memory.h>
+#include <stdint.h>
 #include <vector>
 
 #include "dtypes.h"
@@ -62,6 +63,18 @@ struct Particle
   } u;
 };
 
+//! header of a native Galaxy particle file (.gxyp)
+/*! The header is followed by `count` flat records of three floats (x, y, z), 
+ * or four (x, y, z, value) if `has_data` is set, so any contiguous range of 
+ * particles can be read or mapped directly from the file.
+ * \ingroup data 
+ */
+struct ParticleFileHeader
+{
+  char    magic[4];   // "GXYP"
+  int32_t has_data;   // non-zero if each record carries a data value
+  int64_t count;      // number of particle records
+};
 
 //!  a particle dataset within Galaxy
 /* \ingroup data 
@@ -95,8 +108,27 @@ public:
 
   virtual OsprayObjectP CreateTheOSPRayEquivalent(KeyedDataObjectP);
 
+  //! import a partition document, or a native .gxyp file that every process reads a slice of
+  virtual bool Import(std::string);
+
+  //! distribute the particles of a subsequently imported .gxyp file over the partitions of the given dataset
+  /*! Each particle goes to the process whose partition contains it and is copied to every
+   * other process whose partition lies within `halo` of it, so that spheres of radius up to
+   * `halo` are complete on either side of a partition boundary.  With no source, the bounding
+   * box of the particles is split into a regular grid of partitions.
+   */
+  void SetPartitionSource(KeyedDataObjectP source, float halo = 0);
+
 protected:
   virtual bool load_from_vtkPointSet(vtkPointSet *);
+
+  virtual bool local_import(char *, MPI_Comm);
+
+  //! read this process' slice of a .gxyp file and redistribute particles to their owning partitions
+  bool load_from_binary(std::string, Key source, float halo, MPI_Comm);
+
+  KeyedDataObjectP partition_source;
+  float halo;
 };
 
 } // namespace gxy
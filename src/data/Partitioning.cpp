@@ -0,0 +1,131 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#include "Partitioning.h"
+
+using namespace std;
+
+namespace gxy
+{
+
+static float
+component(vec3f& v, int axis)
+{
+  return (axis == 0) ? v.x : (axis == 1) ? v.y : v.z;
+}
+
+// True if the extents of a and b overlap with non-zero width along the axis
+
+static bool
+overlaps(Box& a, Box& b, int axis, float eps)
+{
+  return component(a.xyz_min, axis) < (component(b.xyz_max, axis) - eps) &&
+         component(b.xyz_min, axis) < (component(a.xyz_max, axis) - eps);
+}
+
+void
+Partitioning::clear()
+{
+  boxes.clear();
+  for (int f = 0; f < 6; f++)
+    faces[f].clear();
+}
+
+void
+Partitioning::set(vector<Box>& b, int rank)
+{
+  clear();
+  boxes = b;
+
+  // Neighboring partitions share a face plane, but their boxes are computed
+  // separately so the planes may differ in the last bit; compare with a
+  // tolerance that's small relative to the whole domain
+
+  Box global;
+  for (auto& box : boxes)
+    global.add(box);
+
+  vec3f extent = global.xyz_max - global.xyz_min;
+  eps[0] = 1e-5f * extent.x;
+  eps[1] = 1e-5f * extent.y;
+  eps[2] = 1e-5f * extent.z;
+
+  Box& me = boxes[rank];
+
+  for (int r = 0; r < boxes.size(); r++)
+  {
+    if (r == rank)
+      continue;
+
+    Box& them = boxes[r];
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+      int a1 = (axis + 1) % 3, a2 = (axis + 2) % 3;
+      if (! overlaps(me, them, a1, eps[a1]) || ! overlaps(me, them, a2, eps[a2]))
+        continue;
+
+      if (fabs(component(me.xyz_min, axis) - component(them.xyz_max, axis)) <= eps[axis])
+        faces[2*axis].push_back(r);
+      else if (fabs(component(me.xyz_max, axis) - component(them.xyz_min, axis)) <= eps[axis])
+        faces[2*axis + 1].push_back(r);
+    }
+  }
+}
+
+int
+Partitioning::neighbor_at(int face, vec3f& p)
+{
+  if (faces[face].size() == 1)
+    return faces[face][0];
+
+  // p lies on the face plane; pick the neighbor whose face covers it in the
+  // two other axes.  Points on an edge between two neighbors go to the first.
+
+  int axis = face >> 1;
+  int a1 = (axis + 1) % 3, a2 = (axis + 2) % 3;
+
+  for (auto r : faces[face])
+  {
+    Box& b = boxes[r];
+    if (component(p, a1) >= (component(b.xyz_min, a1) - eps[a1]) && component(p, a1) <= (component(b.xyz_max, a1) + eps[a1]) &&
+        component(p, a2) >= (component(b.xyz_min, a2) - eps[a2]) && component(p, a2) <= (component(b.xyz_max, a2) + eps[a2]))
+      return r;
+  }
+
+  return -1;
+}
+
+int
+Partitioning::owner(vec3f& p)
+{
+  for (int r = 0; r < boxes.size(); r++)
+  {
+    Box& b = boxes[r];
+    if (p.x >= b.xyz_min.x && p.x <= b.xyz_max.x &&
+        p.y >= b.xyz_min.y && p.y <= b.xyz_max.y &&
+        p.z >= b.xyz_min.z && p.z <= b.xyz_max.z)
+      return r;
+  }
+
+  return -1;
+}
+
+} // namespace gxy
@@ -0,0 +1,86 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file Partitioning.h 
+ * \brief the layout of a non-uniform spatial decomposition across processes
+ * \ingroup data
+ */
+
+#include <vector>
+
+#include "Box.h"
+#include "dtypes.h"
+
+namespace gxy
+{
+
+//! the layout of a non-uniform (e.g. k-d) spatial decomposition
+/*! A regular grid of partitions has exactly one neighbor across each face of a
+ * partition, which KeyedDataObject records in its six-entry neighbors array.  With
+ * an irregular decomposition a face may border several partitions, so this holds
+ * the Box owned by every process and, for the local process, the list of processes
+ * across each face.  An empty Partitioning means the decomposition is regular.
+ * \ingroup data
+ * \sa KeyedDataObject, Box
+ */
+class Partitioning
+{
+public:
+  //! install the boxes owned by each process and derive the face neighbors of process `rank`
+  void set(std::vector<Box>& boxes, int rank);
+
+  //! forget any irregular decomposition
+  void clear();
+
+  //! true if no irregular decomposition has been installed
+  bool empty() { return boxes.size() == 0; }
+
+  //! number of processes across the given face of the local partition
+  /*! This method uses the Box face orientation indices for neighbor indexing
+   *          - yz-face neighbors - `0` for the lower (left) `x`, `1` for the higher (right) `x`
+   *          - xz-face neighbors - `2` for the lower (left) `y`, `3` for the higher (right) `y`
+   *          - xy-face neighbors - `4` for the lower (left) `z`, `5` for the higher (right) `z`
+   */
+  int get_number_of_neighbors(int face) { return faces[face].size(); }
+
+  //! the `i^th` process across the given face of the local partition
+  int get_neighbor(int face, int i) { return faces[face][i]; }
+
+  //! the process across the given face whose partition contains point `p` on that face, or -1
+  int neighbor_at(int face, vec3f& p);
+
+  //! the process whose partition contains point `p`, or -1
+  int owner(vec3f& p);
+
+  //! the box owned by the given process
+  Box *get_box(int rank) { return &boxes[rank]; }
+
+  //! the number of partitions
+  int size() { return boxes.size(); }
+
+private:
+  std::vector<Box> boxes;
+  std::vector<int> faces[6];
+  float eps[3];
+};
+
+} // namespace gxy
@@ -19,10 +19,16 @@
 // ========================================================================== //
 
 #include <iostream>
+#include <algorithm>
+#include <math.h>
+#include <sys/mman.h>
+#include <pthread.h>
 
 #include "Application.h"
 #include "Volume.h"
 #include "OsprayVolume.h"
+#include "Threading.h"
+#include "VolumeSample_ispc.h"
 
 #include <vtkNew.h>
 #include <vtkDataSetReader.h>
@@ -45,6 +51,7 @@ Volume::initialize()
 	initialize_grid = false;
 	vtkobj = NULL;
 	samples = NULL;
+	mapped_size = 0;
   number_of_components = 1;
   super::initialize();
 }
@@ -55,10 +62,39 @@ Volume::Register()
 	RegisterClass();
 }
 
+static vector<Volume::DestroyHook> destroy_hooks;
+static pthread_mutex_t destroy_hooks_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void
+Volume::AddDestroyHook(DestroyHook h)
+{
+	pthread_mutex_lock(&destroy_hooks_lock);
+	destroy_hooks.push_back(h);
+	pthread_mutex_unlock(&destroy_hooks_lock);
+}
+
 Volume::~Volume()
 {
+	pthread_mutex_lock(&destroy_hooks_lock);
+	for (auto h : destroy_hooks)
+		h(getkey());
+	pthread_mutex_unlock(&destroy_hooks_lock);
+
 	if (vtkobj) vtkobj->Delete();
-	if (samples) free(samples);
+	free_samples();
+}
+
+void
+Volume::free_samples()
+{
+	if (samples)
+	{
+		if (mapped_size) munmap(samples, mapped_size);
+		else free(samples);
+	}
+
+	samples = NULL;
+	mapped_size = 0;
 }
 
 bool
@@ -85,42 +121,6 @@ Volume::LoadFromJSON(Value& v)
  	}
 }
 
-static void
-factor(int ijk, vec3i &factors)
-{
-  // If ijk is prime, 1, 1, ijk will be chosen, i+j+k == ijk+2
-
-  if (ijk == 1)
-  {
-    factors.x = factors.y = factors.z = 1;
-    return;
-  }
-
-  int mm = ijk+3;
-  for (int i = 1; i <= ijk>>1; i++)
-  {
-    int jk = ijk / i;
-    if (ijk == (i * jk))
-    {
-      for (int j = 1; j <= jk>>1; j++)
-      {
-        int k = jk / j;
-        if (jk == (j * k))
-        {
-          int m = i + j + k;
-          if (m < mm)
-          {
-            mm = m;
-            factors.x = i;
-            factors.y = j;
-            factors.z = k;
-          }
-        }
-      }
-    }
-  }
-}
-
 struct part
 {
   vec3i ijk;
@@ -171,6 +171,258 @@ partition(int ijk, vec3i factors, vec3i grid)
   return parts;
 }
 
+// k-d decomposition (GXY_KD_PARTITIONING).  The interior of the grid is cut into
+// a lattice of bricks whose cost is estimated from a sparse read of the data,
+// then the brick lattice is split recursively, each cut placed to divide the
+// cost in proportion to the number of processes on either side.  The
+// estimate is the brick's point count weighted by how much the data varies
+// within it: featureless regions are cheap to march through and
+// don't terminate rays, while structured ones end up hitting isosurfaces and
+// opaque transfer-function ranges.
+
+// interior grid index of the i'th brick boundary along an axis with n interior points cut into nb bricks
+
+static int
+brick_edge(int i, int n, int nb)
+{
+  return 1 + (int)(((long)i * (n - 1)) / nb);
+}
+
+static int
+axis_of(vec3i& v, int a)
+{
+  return (a == 0) ? v.x : (a == 1) ? v.y : v.z;
+}
+
+static int&
+axis_ref(vec3i& v, int a)
+{
+  return (a == 0) ? v.x : (a == 1) ? v.y : v.z;
+}
+
+static bool
+kd_split(vector<float>& cost, vec3i& nb, vec3f& brick_size, vec3i lo, vec3i hi, int first, int n, vector<vec3i>& plo, vector<vec3i>& phi)
+{
+  if (n == 1)
+  {
+    plo[first] = lo;
+    phi[first] = hi;
+    return true;
+  }
+
+  int nl = n / 2, nr = n - nl;
+
+  // Try the axes longest first (in world space) so partitions stay compact
+
+  float extent[3] = {(hi.x - lo.x) * brick_size.x, (hi.y - lo.y) * brick_size.y, (hi.z - lo.z) * brick_size.z};
+  int order[3] = {0, 1, 2};
+  for (int i = 0; i < 2; i++)
+    for (int j = i+1; j < 3; j++)
+      if (extent[order[j]] > extent[order[i]])
+        swap(order[i], order[j]);
+
+  for (int o = 0; o < 3; o++)
+  {
+    int a = order[o];
+    int m = axis_of(hi, a) - axis_of(lo, a);
+    if (m < 2)
+      continue;
+
+    int other = 1;
+    for (int b = 0; b < 3; b++)
+      if (b != a) other *= axis_of(hi, b) - axis_of(lo, b);
+
+    vector<double> slab(m, 0.0);
+    double total = 0;
+    for (int k = lo.z; k < hi.z; k++)
+      for (int j = lo.y; j < hi.y; j++)
+        for (int i = lo.x; i < hi.x; i++)
+        {
+          double c = cost[i + j*nb.x + k*nb.x*nb.y];
+          int s = (a == 0) ? i - lo.x : (a == 1) ? j - lo.y : k - lo.z;
+          slab[s] += c;
+          total += c;
+        }
+
+    // each side needs at least one brick per process
+
+    double target = total * nl / n;
+    double prefix = 0, best_diff = 0;
+    int best = -1;
+    for (int s = 1; s < m; s++)
+    {
+      prefix += slab[s-1];
+      if ((s * other) < nl || ((m - s) * other) < nr)
+        continue;
+
+      double diff = fabs(prefix - target);
+      if (best == -1 || diff < best_diff)
+      {
+        best = s;
+        best_diff = diff;
+      }
+    }
+
+    if (best == -1)
+      continue;
+
+    vec3i mid_hi = hi, mid_lo = lo;
+    axis_ref(mid_hi, a) = axis_of(lo, a) + best;
+    axis_ref(mid_lo, a) = axis_of(lo, a) + best;
+
+    return kd_split(cost, nb, brick_size, lo, mid_hi, first, nl, plo, phi) &&
+           kd_split(cost, nb, brick_size, mid_lo, hi, first + nl, nr, plo, phi);
+  }
+
+  return false;
+}
+
+template<typename T>
+static void
+brick_minmax(T *row, int n, int ncomp, float& bmin, float& bmax)
+{
+  for (int i = 0; i < n; i++)
+  {
+    float v = row[i*ncomp];
+    if (v < bmin) bmin = v;
+    if (v > bmax) bmax = v;
+  }
+}
+
+part *
+kd_partition(MPI_Comm c, string rawname, bool isFloat, int ncomp, vec3i grid)
+{
+  int rank = GetTheApplication()->GetRank();
+  int size = GetTheApplication()->GetSize();
+
+  vec3i n(grid.x - 2, grid.y - 2, grid.z - 2);
+
+  // Enough bricks that the cuts can balance cost reasonably finely
+
+  int bricks = getenv("GXY_KD_BRICKS") ? atoi(getenv("GXY_KD_BRICKS")) : max(8, 4*(int)ceil(cbrt((double)size)));
+  vec3i nb(min(bricks, n.x - 1), min(bricks, n.y - 1), min(bricks, n.z - 1));
+  int nbricks = nb.x * nb.y * nb.z;
+
+  if (nbricks < size)
+  {
+    if (rank == 0) cerr << "ERROR: volume too small for a k-d partitioning over " << size << " processes" << endl;
+    return NULL;
+  }
+
+  // Each process estimates the min/max of every size'th brick, reading
+  // at most 8 rows in y and z per brick
+
+  size_t sample_sz = ncomp * (isFloat ? 4 : 1);
+
+  vector<float> bmin(nbricks, FLT_MAX), bmax(nbricks, -FLT_MAX);
+
+  // A process that can't read its share still has to take part in the
+  // reductions, so everyone agrees on failure before giving up
+
+  ifstream raw;
+  raw.open(rawname.c_str(), ios::in | ios::binary);
+  if (raw.fail())
+    cerr << "ERROR: unable to open raw data: " << rawname << endl;
+
+  vector<char> row;
+
+  for (int b = rank; b < nbricks && ! raw.fail(); b += size)
+  {
+    int bi = b % nb.x, bj = (b / nb.x) % nb.y, bk = b / (nb.x * nb.y);
+
+    int x0 = brick_edge(bi, n.x, nb.x), x1 = brick_edge(bi+1, n.x, nb.x);
+    int y0 = brick_edge(bj, n.y, nb.y), y1 = brick_edge(bj+1, n.y, nb.y);
+    int z0 = brick_edge(bk, n.z, nb.z), z1 = brick_edge(bk+1, n.z, nb.z);
+
+    int sy = max(1, (y1 - y0) / 8);
+    int sz = max(1, (z1 - z0) / 8);
+
+    int nx = (x1 - x0) + 1;
+    row.resize(nx * sample_sz);
+
+    for (int z = z0; z <= z1; z += sz)
+      for (int y = y0; y <= y1; y += sy)
+      {
+        streampos src = (((size_t)z * grid.y * grid.x) + ((size_t)y * grid.x) + x0) * sample_sz;
+        raw.seekg(src, ios_base::beg);
+        raw.read(row.data(), row.size());
+
+        if (isFloat)
+          brick_minmax((float *)row.data(), nx, ncomp, bmin[b], bmax[b]);
+        else
+          brick_minmax((unsigned char *)row.data(), nx, ncomp, bmin[b], bmax[b]);
+      }
+  }
+
+  int ok = raw.fail() ? 0 : 1;
+  if (raw.is_open())
+  {
+    if (! ok) cerr << "ERROR: short read from raw data: " << rawname << endl;
+    raw.close();
+  }
+
+  MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_LAND, c);
+  if (! ok)
+    return NULL;
+
+  MPI_Allreduce(MPI_IN_PLACE, bmin.data(), nbricks, MPI_FLOAT, MPI_MIN, c);
+  MPI_Allreduce(MPI_IN_PLACE, bmax.data(), nbricks, MPI_FLOAT, MPI_MAX, c);
+
+  float gmin = *min_element(bmin.begin(), bmin.end());
+  float gmax = *max_element(bmax.begin(), bmax.end());
+  float span = (gmax > gmin) ? (gmax - gmin) : 1.0;
+
+  vector<float> cost(nbricks);
+  for (int b = 0; b < nbricks; b++)
+  {
+    int bi = b % nb.x, bj = (b / nb.x) % nb.y, bk = b / (nb.x * nb.y);
+    float npoints = (float)(brick_edge(bi+1, n.x, nb.x) - brick_edge(bi, n.x, nb.x)) *
+                           (brick_edge(bj+1, n.y, nb.y) - brick_edge(bj, n.y, nb.y)) *
+                           (brick_edge(bk+1, n.z, nb.z) - brick_edge(bk, n.z, nb.z));
+    cost[b] = npoints * (1.0 + (bmax[b] - bmin[b]) / span);
+  }
+
+  vector<vec3i> plo(size), phi(size);
+  vec3f brick_size((float)n.x / nb.x, (float)n.y / nb.y, (float)n.z / nb.z);
+  if (! kd_split(cost, nb, brick_size, vec3i(0, 0, 0), nb, 0, size, plo, phi))
+  {
+    if (rank == 0) cerr << "ERROR: unable to find a k-d partitioning over " << size << " processes" << endl;
+    return NULL;
+  }
+
+  part *parts = new part[size];
+  double max_cost = 0, total_cost = 0;
+  for (int r = 0; r < size; r++)
+  {
+    part *p = parts + r;
+
+    p->ijk = vec3i(r, 0, 0);
+
+    p->offsets = vec3i(brick_edge(plo[r].x, n.x, nb.x), brick_edge(plo[r].y, n.y, nb.y), brick_edge(plo[r].z, n.z, nb.z));
+    p->counts  = vec3i(brick_edge(phi[r].x, n.x, nb.x) - p->offsets.x + 1,
+                       brick_edge(phi[r].y, n.y, nb.y) - p->offsets.y + 1,
+                       brick_edge(phi[r].z, n.z, nb.z) - p->offsets.z + 1);
+
+    p->goffsets = p->offsets - vec3i(1, 1, 1);
+    p->gcounts  = p->counts + vec3i(2, 2, 2);
+
+    double c = 0;
+    for (int k = plo[r].z; k < phi[r].z; k++)
+      for (int j = plo[r].y; j < phi[r].y; j++)
+        for (int i = plo[r].x; i < phi[r].x; i++)
+          c += cost[i + j*nb.x + k*nb.x*nb.y];
+
+    total_cost += c;
+    if (c > max_cost) max_cost = c;
+  }
+
+  if (rank == 0)
+    cerr << "k-d partitioning: " << nb.x << "x" << nb.y << "x" << nb.z << " bricks, estimated cost imbalance (max/mean) "
+         << (max_cost / (total_cost / size)) << endl;
+
+  return parts;
+}
+
 bool
 Volume::local_import(char *fname, MPI_Comm c)
 {
@@ -301,23 +553,27 @@ Volume::local_import(char *fname, MPI_Comm c)
     return false;
   }
 
-  if (getenv("PARTITIONING"))
+	string rawname = data_fname[0] == '/' ? data_fname : (dir + data_fname);
+
+  bool kd = getenv("GXY_KD_PARTITIONING") && atoi(getenv("GXY_KD_PARTITIONING"));
+
+  part *partitions;
+  if (kd)
   {
-    if (3 != sscanf(getenv("PARTITIONING"), "%d,%d,%d", &global_partitions.x, &global_partitions.y, &global_partitions.z))
-    {
-      if (rank == 0) cerr << "ERROR: Illegal PARTITIONING environment variable" << endl;
-      return false;
-    }
-    if ((global_partitions.x*global_partitions.y*global_partitions.z) != size)
-    {
-      if (rank == 0) cerr << "ERROR: json PARTITIONING does not multiply to current MPI size" << endl;
+    partitions = kd_partition(c, rawname, type == FLOAT, number_of_components, global_counts);
+    if (! partitions)
       return false;
-    }
+
+    global_partitions = vec3i(size, 1, 1);
   }
   else
-    factor(size, global_partitions);
+  {
+    if (! get_global_partitions(global_partitions))
+      return false;
+
+    partitions = partition(size, global_partitions, global_counts);
+  }
 
-  part *partitions = partition(size, global_partitions, global_counts);
   part *my_partition = partitions + rank;
 
   ijk = my_partition->ijk;
@@ -336,7 +592,10 @@ Volume::local_import(char *fname, MPI_Comm c)
 
 	samples = (unsigned char *)malloc(tot_sz);
 
-	string rawname = data_fname[0] == '/' ? data_fname : (dir + data_fname);
+	// every pool thread samples the volume, wherever it runs, so spread it across the sockets
+
+	GetTheApplication()->GetTheThreadManager()->interleave(samples, tot_sz);
+
 	ifstream raw;
   raw.open(rawname.c_str(), ios::in | ios::binary);
 
@@ -357,7 +616,31 @@ Volume::local_import(char *fname, MPI_Comm c)
 
 #define ijk2rank(i, j, k) ((i) + ((j) * global_partitions.x) + ((k) * global_partitions.x * global_partitions.y))
 
-	if (getenv("MPI_TEST_RANK"))
+  partitioning.clear();
+
+  if (kd)
+  {
+    vector<Box> boxes;
+    for (int r = 0; r < size; r++)
+    {
+      float o[3] =
+      {
+        global_origin.x + (partitions[r].offsets.x * deltas.x),
+        global_origin.y + (partitions[r].offsets.y * deltas.y),
+        global_origin.z + (partitions[r].offsets.z * deltas.z)
+      };
+      boxes.push_back(Box(o, (int *)&partitions[r].counts, (float *)&deltas));
+    }
+
+    partitioning.set(boxes, rank);
+
+    // neighbors[] keeps the first partition across each face for code that
+    // only understands regular decompositions
+
+    for (int f = 0; f < 6; f++)
+      neighbors[f] = partitioning.get_number_of_neighbors(f) ? partitioning.get_neighbor(f, 0) : -1;
+  }
+  else if (getenv("MPI_TEST_RANK"))
 	{
 		neighbors[0] = -1;
 		neighbors[1] = -1;
@@ -388,6 +671,8 @@ Volume::local_import(char *fname, MPI_Comm c)
   };
 
   local_box = Box(lo, (int *)&local_counts, (float *)&deltas);
+
+  delete[] partitions;
   return true;
 }
 
@@ -589,7 +874,59 @@ Volume::Sample(vec3f& p, float* result)
   return true;
 }
 
-int 
+// Batches larger than this are split across the ThreadPool
+
+#define VOLUME_SAMPLE_CHUNK 16384
+
+class volume_sample_task : public ThreadPoolTask
+{
+public:
+  volume_sample_task(Volume *v, int n, vec3f *p, float *r, unsigned char *i) :
+    ThreadPoolTask(0), volume(v), n(n), p(p), r(r), i(i) {}
+
+  int work() { return volume->Sample(n, p, r, i); }
+
+private:
+  Volume *volume;
+  int n;
+  vec3f *p;
+  float *r;
+  unsigned char *i;
+};
+
+int
+Volume::Sample(int n, vec3f *p, float *results, unsigned char *inside)
+{
+  if (n > VOLUME_SAMPLE_CHUNK)
+  {
+    vector<future<int>> chunks;
+    for (int i = 0; i < n; i += VOLUME_SAMPLE_CHUNK)
+    {
+      int k = ((n - i) < VOLUME_SAMPLE_CHUNK) ? (n - i) : VOLUME_SAMPLE_CHUNK;
+      chunks.emplace_back(GetTheApplication()->GetTheThreadPool()->AddTask(
+          new volume_sample_task(this, k, p + i, results + i*number_of_components, inside ? inside + i : NULL)));
+    }
+
+    int nInside = 0;
+    for (auto& c : chunks)
+      nInside += c.get();
+
+    return nInside;
+  }
+
+  vec3i c = ghosted_local_counts;
+  vec3i g = ghosted_local_offset;
+  vec3f o = global_origin;
+
+  if (isFloat())
+    return ispc::VolumeSample_float((float *)samples, number_of_components, c.x, c.y, c.z,
+              g.x, g.y, g.z, o.x, o.y, o.z, deltas.x, deltas.y, deltas.z, n, (float *)p, results, (int8_t *)inside);
+  else
+    return ispc::VolumeSample_uchar((uint8_t *)samples, number_of_components, c.x, c.y, c.z,
+              g.x, g.y, g.z, o.x, o.y, o.z, deltas.x, deltas.y, deltas.z, n, (float *)p, results, (int8_t *)inside);
+}
+
+int
 Volume::PointOwner(vec3f& p)
 {
   // Transform p to real grid space
@@ -606,6 +943,9 @@ Volume::PointOwner(vec3f& p)
   // Is that in non-ghosted region?
   if ((ll.x < 1) || (ll.x >= (global_counts.x - 2)) ||(ll.y < 1) || (ll.y >= (global_counts.y - 2)) ||(ll.z < 1) || (ll.z >= (global_counts.z - 2))) return -1;
 
+  if (! partitioning.empty())
+    return partitioning.owner(p);
+
   int nx = (global_counts.x - 2) / global_partitions.x;
   int ny = (global_counts.y - 2) / global_partitions.y;
   int nz = (global_counts.z - 2) / global_partitions.z;
@@ -54,6 +54,12 @@ public:
 	virtual void initialize(); //!< initialize this Volume object
 	virtual ~Volume(); //!< default destructor
 
+	//! a function called with the key of each Volume as it is destroyed
+	typedef void (*DestroyHook)(Key);
+
+	//! register a DestroyHook, e.g. to drop data derived from a Volume along with it
+	static void AddDestroyHook(DestroyHook h);
+
 	//! supported volumetric datatypes
 	enum DataType
 	{
@@ -69,6 +75,20 @@ public:
 	  { std::cerr << "WARNING: overwriting (and leaking) Galaxy samples array!" << std::endl;} 
 	  samples = (unsigned char*)s; 
 	}
+	//! replace the samples array, handing the old one back to the caller
+	/*! If `mapped` is non-zero, `s` is a mapped region of that many bytes (eg. shared memory)
+	 * that will be unmapped rather than freed.   Check get_mapped_size() before swapping to
+	 * learn what kind of array is being handed back.
+	 */
+	unsigned char *swap_samples(unsigned char *s, size_t mapped = 0)
+	{
+		unsigned char *o = samples;
+		samples = s;
+		mapped_size = mapped;
+		return o;
+	}
+	//! size of the samples array if it is a mapped region, otherwise 0
+	size_t get_mapped_size() { return mapped_size; }
 
 	//! get the deltas (grid step size) for this Volume
 	void get_deltas(float &x, float &y, float &z) { x = deltas.x; y = deltas.y; z = deltas.z; }
@@ -216,11 +236,29 @@ public:
   //! Set the number of components
   void set_number_of_components(int n) { number_of_components = n; }
 
-  //! Interpolate an arbitrary point and return true if its in the local partition, otherwise false
-  bool Sample(vec3f& p, float* i);
+  //! Interpolate an arbitrary point and return true if its in the ghosted local partition, otherwise false
+  /*! i receives number_of_components values.   A point is inside if the whole cell containing
+   * it lies within the local partition including its ghost zone.
+   */
+  virtual bool Sample(vec3f& p, float* i);
   bool Sample(vec3f& p, vec3f& v);
   bool Sample(vec3f& p, float& v);
 
+  //! Interpolate a batch of points in the local partition
+  /*! results receives number_of_components values per point, exactly as the single-point
+   * Sample would give them; points outside the ghosted local partition get zeros and, if 
+   * inside is given, a 0 flag.   Large batches are split across the ThreadPool, so this 
+   * must not be called from a ThreadPool task.
+   * \returns the number of points inside the ghosted local partition
+   */
+  virtual int Sample(int n, vec3f *p, float *results, unsigned char *inside = NULL);
+
+  //! Size of the smallest edge of the cell containing p; used to size integration steps
+  virtual float CellSize(vec3f& p)
+  {
+    return (deltas.x < deltas.y) ? (deltas.x < deltas.z ? deltas.x : deltas.z) : (deltas.y < deltas.z ? deltas.y : deltas.z);
+  }
+
   //! Which process owns an arbitrary point in this global volume? -1 for outside
   int PointOwner(vec3f& p);
 
@@ -232,7 +270,7 @@ public:
 
   void Allocate()
   {
-    if (samples) free(samples);
+    free_samples();
     size_t sz = global_counts.x * global_counts.y * global_counts.z * number_of_components 
       * ((type == FLOAT) ? sizeof(float) : sizeof(unsigned char));
     samples = (unsigned char *)malloc(sz);
@@ -260,6 +298,9 @@ protected:
 	vec3i ghosted_local_offset;
 	vec3i ghosted_local_counts;
 	unsigned char *samples;
+	size_t mapped_size;
+
+	void free_samples();
 };
 
 } // namespace gxy
@@ -31,6 +31,7 @@
 
 #include "Application.h"
 #include "KeyedObject.h"
+#include "Metrics.h"
 #include "Threading.h"
 #include "Events.h"
 
@@ -72,11 +73,11 @@ Application::Application()
 
   quitting = false;
 
-  int n_threads =  getenv("GXY_NTHREADS") ?  atoi(getenv("GXY_NTHREADS")) : 5;
-  std::cerr << "Using " << n_threads << " threads in rendering thread pool." << std::endl;
-
   threadManager = new ThreadManager;
-  threadPool = new ThreadPool(n_threads);
+
+  // The pool is sized in Start, once MPI can tell us how many ranks share this node
+
+  threadPool = NULL;
 
 	theMessageManager = new MessageManager; 
 	theKeyedObjectFactory = new KeyedObjectFactory; 
@@ -116,6 +117,9 @@ Application::Application()
 	KeyedObject::Register();
 	KeyedObjectFactory::Register();
 
+	Metrics::Register();
+	EventTracker::Register();
+
   pthread_mutex_unlock(&lock);
 }
 
@@ -195,6 +199,34 @@ void Application::Start(bool with_mpi)
   GetTheMessageManager()->Start(with_mpi);
 }
 
+void Application::CreateThreadPool()
+{
+  // By default, leave a CPU each for the message, work and rayQ threads and 
+  // give the rest to the pool.   If the launcher didn't bind ranks to their 
+  // own CPUs, the ranks on this node share all of its CPUs.
+
+  int n_cpus = threadManager->number_of_cpus();
+  int n_local = GetTheMessageManager()->GetLocalSize();
+  if (n_local > 1 && n_cpus == sysconf(_SC_NPROCESSORS_ONLN))
+    n_cpus = n_cpus / n_local;
+
+  int n_threads = n_cpus - 3;
+  if (n_threads < 1) n_threads = 1;
+
+  if (getenv("GXY_NTHREADS"))
+    n_threads = atoi(getenv("GXY_NTHREADS"));
+
+  if (GetRank() == 0)
+  {
+    std::cerr << "Using " << n_threads << " threads in rendering thread pool";
+    if (threadManager->is_binding())
+      std::cerr << ", bound across " << threadManager->number_of_nodes() << " NUMA nodes";
+    std::cerr << "." << std::endl;
+  }
+
+  threadPool = new ThreadPool(n_threads);
+}
+
 void Application::Kill()
 {
 	pthread_mutex_lock(&lock);
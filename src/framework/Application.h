@@ -153,6 +153,13 @@ public:
    * \sa Message, MessageManager, Work
    */
   void Start(bool with_mpi = true);
+
+  //! create the rendering thread pool
+  /*! Called by the MessageManager's message thread once MPI is up (so the 
+   * number of ranks sharing this node is known) and before any Work can be 
+   * dispatched to the work thread.
+   */
+  void CreateThreadPool();
   //! notify the Application threads to terminate
   /*! This is used by QuitApplication to gracefully end processing and terminate
    * the Application.
@@ -21,6 +21,8 @@
 #include "galaxy.h"
 
 #include <limits>
+#include <sstream>
+#include <string.h>
 #include <time.h>
 #include <sys/time.h>
 
@@ -38,36 +40,72 @@ using namespace std;
 namespace gxy
 {
 
+WORK_CLASS_TYPE(EventTracker::EnableMsg)
+
 typedef numeric_limits< double > dbl;
 
 EventTracker *GetTheEventTracker() { return GetTheApplication()->GetTheThreadManager()->get_events(); }
 
 pthread_mutex_t EventsLock = PTHREAD_MUTEX_INITIALIZER;
 
-Event::Event()
-{
-	time = EventTracker::gettime();
-}
+#if defined(GXY_EVENT_TRACKING)
+std::atomic<bool> EventTracker::enabled(true);
+#else
+std::atomic<bool> EventTracker::enabled(false);
+#endif
 
-Event::~Event()
-{
-  cerr << "event dtor" << endl;
-}
+// Calibration of the event clock: a (ticks, realtime) pair taken at 
+// startup.  A second pair is taken when events are dumped, and the
+// rate between the two is used to convert ticks to realtime seconds.
+
+static uint64_t calibration_ticks = EventTracker::ticks();
+static double   calibration_time  = EventTracker::gettime();
+
+// This process' clock offset from rank 0 in seconds, as estimated by
+// AlignClocks; add it to a local time to get the corresponding rank-0 time.
+
+static double clock_offset = 0;
+static bool   clocks_aligned = false;
 
 void
 Event::print(ostream& o)
 {
-	o << fixed << time << ": ";
 }
 
-EventTracker::EventTracker()
+EventTracker::EventTracker() : ring(NULL), capacity(0), next(0)
 {
+	pthread_mutex_init(&lock, NULL);
 }
 
 EventTracker::~EventTracker()
 {
+	if (ring)
+		delete[] ring;
+	pthread_mutex_destroy(&lock);
 }
 
+void
+EventTracker::Register()
+{
+	EnableMsg::Register();
+
+	if (getenv("GXY_EVENTS"))
+		enabled = atoi(getenv("GXY_EVENTS")) != 0;
+}
+
+void
+EventTracker::allocate()
+{
+	pthread_mutex_lock(&lock);
+	if (! ring)
+	{
+		capacity = getenv("GXY_EVENTS_SIZE") ? atoi(getenv("GXY_EVENTS_SIZE")) : 16384;
+		if (capacity < 1)
+			capacity = 16384;
+		ring = new EventRecord[capacity];
+	}
+	pthread_mutex_unlock(&lock);
+}
 
 double
 EventTracker::gettime()
@@ -89,32 +127,135 @@ EventTracker::gettime()
 void
 EventTracker::DumpEvents()
 {
-#if defined(GXY_EVENT_TRACKING)
 	int rank = GetTheApplication()->GetTheMessageManager()->GetRank();
 	int tid = GetTheApplication()->GetTheThreadManager()->get_index();
 	fstream fs;
 	stringstream fname;
-	fname << "gxy_events_" << "_" << rank << "_" << tid;
+	fname << "gxy_events_" << rank << "_" << tid;
 	fs.open(fname.str().c_str(), fstream::out);
 	DumpEvents(fs);
 	fs.close();
-#endif
 }
 
 void
 EventTracker::DumpEvents(fstream& fs)
 {
-	for (auto e : events)
+	unsigned long n = next;
+	unsigned long first = (n > capacity) ? n - capacity : 0;
+
+	// If the run was too short to calibrate the counter against, fall back 
+	// to assuming a nanosecond clock
+
+	uint64_t t1 = ticks();
+	double   s1 = gettime();
+	double rate = (s1 - calibration_time > 0.001) ? (t1 - calibration_ticks) / (s1 - calibration_time) : 1e9;
+
+	fs << "rank: " << GetTheApplication()->GetRank() << "\n";
+	fs << "clock offset: " << fixed << clock_offset << "\n";
+	fs << "dropped: " << first << "\n";
+
+	fs.precision(dbl::max_digits10);
+
+	for (unsigned long i = first; i < n; i++)
 	{
-		e->Print(fs);
-		fs << "\n";
+		EventRecord *r = ring + (i % capacity);
+		double t = calibration_time + ((double)((int64_t)(r->ticks - calibration_ticks)) / rate);
+
+		fs << fixed << t << " " << r->phase << " ";
+		if (r->name)
+			fs << r->name << "\t" << r->a << "\t" << r->b << "\n";
+		else
+			fs << r->text << "\n";
 	}
 }
 
 void
 EventTracker::Add(Event *e)
 {
-	events.push_back(e);
+	if (Enabled())
+	{
+		uint64_t t = ticks();
+
+		stringstream ss;
+		e->Print(ss);
+
+		EventRecord *r = slot();
+		r->ticks = t;
+		r->name  = NULL;
+		r->phase = 'i';
+		strncpy(r->text, ss.str().c_str(), sizeof(r->text) - 1);
+		r->text[sizeof(r->text) - 1] = 0;
+	}
+
+	delete e;
+}
+
+// Cristian's algorithm: each rank in turn exchanges a few timestamps with 
+// rank 0 and keeps the estimate from the exchange with the shortest round trip.
+
+void
+EventTracker::AlignClocks(MPI_Comm comm)
+{
+	const int nexchanges = 8;
+
+	int rank, size;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+
+	for (int i = 1; i < size; i++)
+	{
+		if (rank == 0)
+		{
+			for (int j = 0; j < nexchanges; j++)
+			{
+				double t;
+				MPI_Recv(&t, 1, MPI_DOUBLE, i, 0, comm, MPI_STATUS_IGNORE);
+				t = gettime();
+				MPI_Send(&t, 1, MPI_DOUBLE, i, 0, comm);
+			}
+		}
+		else if (rank == i)
+		{
+			double best_rtt = -1;
+			for (int j = 0; j < nexchanges; j++)
+			{
+				double t0 = gettime(), t;
+				MPI_Send(&t0, 1, MPI_DOUBLE, 0, 0, comm);
+				MPI_Recv(&t, 1, MPI_DOUBLE, 0, 0, comm, MPI_STATUS_IGNORE);
+				double t1 = gettime();
+
+				if (best_rtt < 0 || (t1 - t0) < best_rtt)
+				{
+					best_rtt = t1 - t0;
+					clock_offset = t - (t0 + t1) / 2;
+				}
+			}
+		}
+	}
+
+	clocks_aligned = true;
+}
+
+void
+EventTracker::EnableAll(bool on)
+{
+	EnableMsg msg(sizeof(int));
+	*(int *)msg.get_contents() = on ? 1 : 0;
+	msg.Broadcast(true);
+}
+
+// Collective so that the clocks can be aligned the first time tracking is
+// turned on, if that wasn't done at startup.   clocks_aligned is only touched
+// on the message thread, so every process takes the same branch.
+
+bool
+EventTracker::EnableMsg::CollectiveAction(MPI_Comm comm, bool isRoot)
+{
+	bool on = *(int *)get() != 0;
+	if (on && ! clocks_aligned)
+		AlignClocks(comm);
+	Enable(on);
+	return false;
 }
 
 } // namespace gxy
@@ -25,39 +25,69 @@
  * \ingroup framework
  */
 
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <mpi.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <vector>
 
 #include "KeyedObject.h"
+#include "Work.h"
 
 namespace gxy
 {
 
-//! marks a point in time
-/*! \ingroup framework
+//! a descriptive event, captured as text when added to an EventTracker
+/*! Subclasses override print() to describe themselves.   The text is captured
+ * into the tracker's ring buffer by EventTracker::Add and the Event is then
+ * deleted, so these should be reserved for infrequent events; hot paths 
+ * should use the allocation-free EventTracker::Add(const char *, ...) instead.
+ * \ingroup framework
  * \sa EventTracker
  */
 class Event
 {
 public:
-	Event(); //!< default constructor
-	~Event(); //!< default destructor
+	Event() {}					//!< default constructor
+	virtual ~Event() {} //!< default destructor
 
-	//! print this event timestamp
+	//! print this event's description
 	void Print(std::ostream& o) { print(o); }
 
 protected:
 	virtual void print(std::ostream&);
-
-private:
-	double time;
 };
 
-//! manages timed events
+//! a fixed-size event record, as stored in an EventTracker's ring buffer
 /*! \ingroup framework
+ * \sa EventTracker
+ */
+struct EventRecord
+{
+	uint64_t    ticks;			//!< EventTracker::ticks() at the time of the event
+	const char *name;				//!< static string naming a lightweight event, NULL if the event has text
+	char        phase;			//!< Chrome trace phase: 'B' begin, 'E' end or 'i' instant
+	long        a, b;				//!< arguments of a lightweight event
+	char        text[56];		//!< captured description of an Event
+};
+
+//! records timed events in a fixed-size per-thread ring buffer
+/*! Each managed thread has its own EventTracker (see ThreadManager) holding
+ * the most recent GXY_EVENTS_SIZE records (default 16384); older records are 
+ * overwritten and counted as dropped.   Recording does not allocate and is 
+ * skipped entirely when tracking is disabled.  Tracking is enabled at startup 
+ * when Galaxy is built with GXY_EVENT_TRACKING or GXY_EVENTS is set in the 
+ * environment, and can be switched at runtime with Enable or EnableAll.
+ *
+ * Timestamps are taken from the processor's time stamp counter where 
+ * available (otherwise CLOCK_MONOTONIC), calibrated against CLOCK_REALTIME 
+ * when dumped.   Each tracker is dumped to `gxy_events_R_T` (`R` the rank, 
+ * `T` the thread index) along with this process' clock offset from rank 0; 
+ * `scripts/gxy-events2trace` merges those files into a Chrome trace.
+ * \ingroup framework
  * \sa Event
  */
 class EventTracker
@@ -71,18 +101,89 @@ public:
 	//! dump events to the given file stream
 	void DumpEvents(std::fstream& fs);
 
-	//! add an Event to this tracker
+	//! add an Event to this tracker, capturing its description and deleting it
 	void Add(Event *e);
 
+	//! add a lightweight event to this tracker
+	/*! \param name a static string naming the event; it is not copied
+	 * \param phase 'B' if this begins a span, 'E' if it ends one, 'i' otherwise
+	 * \param a first event-specific argument
+	 * \param b second event-specific argument
+	 */
+	void Add(const char *name, char phase = 'i', long a = 0, long b = 0)
+	{
+		if (Enabled())
+		{
+			EventRecord *r = slot();
+			r->ticks = ticks();
+			r->name  = name;
+			r->phase = phase;
+			r->a     = a;
+			r->b     = b;
+		}
+	}
+
 	//! get an architecture-appropriate representation of the current time in seconds
 	static double gettime();
 
+	//! get the raw event clock: the time stamp counter if available, else nanoseconds
+	static uint64_t ticks()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		uint32_t lo, hi;
+		__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+		return ((uint64_t)hi << 32) | lo;
+#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+	}
+
+	//! is event tracking enabled on this process?
+	static bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+
+	//! enable or disable event tracking on this process; use EnableAll if the clocks are to be aligned
+	static void Enable(bool on) { enabled = on; }
+
+	//! enable or disable event tracking on every process
+	static void EnableAll(bool on);
+
+	//! estimate this process' clock offset from rank 0. Collective over the given communicator
+	/*! Run at startup if tracking is enabled on any process, otherwise by EnableAll
+	 * the first time tracking is turned on.
+	 */
+	static void AlignClocks(MPI_Comm comm);
+
+	//! register the event tracker's Work classes and pick up the environment settings
+	static void Register();
+
 	//! false if any events have been added by Add
-	bool is_empty() { return events.size() == 0; }
+	bool is_empty() { return next == 0; }
 	
 private:
-	int event_dump_count;
-	std::vector<Event*> events;
+	EventRecord *slot()
+	{
+		if (! ring) allocate();
+		return ring + (next.fetch_add(1, std::memory_order_relaxed) % capacity);
+	}
+
+	void allocate();
+
+	static std::atomic<bool> enabled;
+
+	pthread_mutex_t lock;
+	EventRecord *ring;
+	size_t capacity;
+	std::atomic<unsigned long> next;
+
+	class EnableMsg : public Work
+	{
+		WORK_CLASS(EnableMsg, true);
+
+	public:
+		bool CollectiveAction(MPI_Comm comm, bool isRoot);
+	};
 };
 
 /*! \ingroup framework
@@ -18,6 +18,7 @@
 //                                                                            //
 // ========================================================================== //
 
+#include <sched.h>
 
 #include "Application.h"
 #include "KeyedObject.h"
@@ -77,7 +78,10 @@ static int ko_count = 0;
 static int get_ko_count() { return ko_count; }
 
 WORK_CLASS_TYPE(KeyedObject::CommitMsg)
+WORK_CLASS_TYPE(KeyedObject::CommitBatchMsg)
+WORK_CLASS_TYPE(KeyedObject::CommitDeltaMsg)
 WORK_CLASS_TYPE(KeyedObjectFactory::NewMsg)
+WORK_CLASS_TYPE(KeyedObjectFactory::NewBatchMsg)
 WORK_CLASS_TYPE(KeyedObjectFactory::DropMsg)
 
 KeyedObjectFactory* GetTheKeyedObjectFactory()
@@ -85,6 +89,15 @@ KeyedObjectFactory* GetTheKeyedObjectFactory()
   return GetTheApplication()->GetTheKeyedObjectFactory();
 }
 
+KeyedObjectFactory::KeyedObjectFactory()
+{
+  for (int i = 0; i < MAX_CHUNKS; i++)
+    chunks[i] = NULL;
+
+  next_slot = 0;
+  pthread_mutex_init(&lock, NULL);
+}
+
 int
 KeyedObjectFactory::register_class(KeyedObject *(*n)(Key), std::string s)
 {
@@ -99,6 +112,11 @@ KeyedObjectFactory::register_class(KeyedObject *(*n)(Key), std::string s)
 
   new_procs.push_back(n);
   class_names.push_back(s);
+
+  pthread_mutex_lock(&lock);
+  live_counts.push_back(0);
+  pthread_mutex_unlock(&lock);
+
   return new_procs.size() - 1;
 }
 
@@ -117,15 +135,39 @@ KeyedObjectFactory::NewMsg::CollectiveAction(MPI_Comm comm, bool isRoot)
 	return false;
 }
 
+bool
+KeyedObjectFactory::NewBatchMsg::CollectiveAction(MPI_Comm comm, bool isRoot)
+{
+	if (!isRoot)
+	{
+		unsigned char *p = (unsigned char *)get();
+		KeyedObjectClass c = *(KeyedObjectClass *)p;
+		p += sizeof(KeyedObjectClass);
+		int n = *(int *)p;
+		p += sizeof(int);
+		Key *keys = (Key *)p;
+		for (int i = 0; i < n; i++)
+			KeyedObjectP kop = GetTheKeyedObjectFactory()->New(c, keys[i]);
+	}
+
+	return false;
+}
+
 // Remove any objects references from the key map.
 void
 KeyedObjectFactory::Clear()
 {
   // Delete remote dependents of local *primary* objects.
 
-  for (auto i = smap.begin(); i != smap.end(); i++)
-    if (*i)
-      (*i)->Drop();
+  for (int i = 0; i < next_slot; i++)
+  {
+    Slot *slot = get_slot(i);
+    Entry e(-1, -1);
+    if (! slot || ! read_slot(slot, e)) continue;
+
+    if (e.strong)
+      e.strong->Drop();
+  }
 }
 
 void
@@ -147,39 +189,235 @@ KeyedObjectFactory::DropMsg::CollectiveAction(MPI_Comm comm, bool isRoot)
 	return false;
 }
 
-// Get an object by key... could be in either keymap
+Key
+KeyedObjectFactory::keygen()
+{
+  int s;
+
+  pthread_mutex_lock(&lock);
+  if (free_slots.size() > 0)
+  {
+    s = free_slots.back();
+    free_slots.pop_back();
+  }
+  else
+  {
+    if (next_slot > KEY_SLOT_MASK)
+    {
+      cerr << "ERROR: KeyedObjectFactory registry is full" << endl;
+      exit(1);
+    }
+    s = next_slot++;
+  }
+  pthread_mutex_unlock(&lock);
+
+  Slot *slot = make_slot(s);
+  return MakeKey(s, slot->generation.load(std::memory_order_acquire));
+}
+
+KeyedObjectFactory::Slot *
+KeyedObjectFactory::make_slot(int s)
+{
+  Slot *slot = get_slot(s);
+  if (! slot)
+  {
+    pthread_mutex_lock(&lock);
+    int c = s / SLOTS_PER_CHUNK;
+    if (! chunks[c].load(std::memory_order_relaxed))
+      chunks[c].store(new Slot[SLOTS_PER_CHUNK], std::memory_order_release);
+    pthread_mutex_unlock(&lock);
+    slot = get_slot(s);
+  }
+  return slot;
+}
+
+void
+KeyedObjectFactory::count(KeyedObjectClass c, int d)
+{
+  pthread_mutex_lock(&lock);
+  if (c >= 0 && c < live_counts.size())
+    live_counts[c] += d;
+  pthread_mutex_unlock(&lock);
+}
+
+bool
+KeyedObjectFactory::read_slot(Slot *slot, Entry& copy)
+{
+  int i = slot->epoch.load();
+  slot->readers[i].fetch_add(1);
+
+  Entry *e = slot->entry.load();
+  if (e)
+    copy = *e;
+
+  slot->readers[i].fetch_sub(1, std::memory_order_release);
+  return e != NULL;
+}
+
+KeyedObjectFactory::Entry *
+KeyedObjectFactory::publish(Slot *slot, Entry *e)
+{
+  Entry *old = slot->entry.exchange(e);
+
+  // Anyone who can have picked up the old Entry registered before the
+  // exchange, in one count or the other
+
+  for (int flip = 0; flip < 2; flip++)
+  {
+    int i = slot->epoch.load();
+    slot->epoch.store(1 - i);
+    while (slot->readers[i].load(std::memory_order_acquire))
+      sched_yield();
+  }
+
+  return old;
+}
+
+// Get an object by key... could be either a weak (primary) or strong (dependent) reference
 KeyedObjectP
 KeyedObjectFactory::get(Key k)
 {
-	KeyedObjectP kop = k >= smap.size() ? nullptr : smap[k];
-  if (kop == nullptr)
-		return k >= wmap.size() ? nullptr : wmap[k].lock();
-	else
-    return kop;
+  if (k < 0)
+    return nullptr;
+
+  Slot *slot = get_slot(KeySlot(k));
+  if (! slot || slot->generation.load(std::memory_order_acquire) != KeyGeneration(k))
+    return nullptr;
+
+  Entry e(-1, -1);
+  if (! read_slot(slot, e) || e.generation != KeyGeneration(k))
+    return nullptr;
+
+  return e.strong ? e.strong : e.weak.lock();
 }
 
 void
 KeyedObjectFactory::erase(Key k)
 {
-	if (k < smap.size()) smap[k] = nullptr;
+  Slot *slot = k < 0 ? NULL : get_slot(KeySlot(k));
+  if (! slot)
+    return;
+
+  // Release the reference outside the slot lock, since it may delete the object
+
+  Entry *doomed = NULL;
+
+  slot->Lock();
+  Entry *e = slot->entry.load();
+  if (e && e->generation == KeyGeneration(k) && e->strong)
+  {
+    Entry *n = new Entry(e->generation, e->klass);
+    n->weak = e->weak;
+    doomed = publish(slot, n);
+  }
+  slot->Unlock();
+
+  if (doomed)
+  {
+    count(doomed->klass, -1);
+    delete doomed;
+  }
+}
+
+void
+KeyedObjectFactory::release(Key k)
+{
+  Slot *slot = k < 0 ? NULL : get_slot(KeySlot(k));
+  if (! slot)
+    return;
+
+  int g = (KeyGeneration(k) + 1) & KEY_GENERATION_MASK;
+  Entry *doomed = NULL;
+
+  slot->Lock();
+  Entry *e = slot->entry.load();
+  if (e && e->generation == KeyGeneration(k))
+  {
+    doomed = publish(slot, new Entry(g, e->klass));
+    slot->generation.store(g, std::memory_order_release);
+  }
+  slot->Unlock();
+
+  if (doomed)
+  {
+    count(doomed->klass, -1);
+    delete doomed;
+
+    // If the generation has wrapped, reusing the slot could let a stale key
+    // resolve to its new occupant, so retire it instead
+
+    if (g != 0)
+    {
+      pthread_mutex_lock(&lock);
+      free_slots.push_back(KeySlot(k));
+      pthread_mutex_unlock(&lock);
+    }
+  }
 }
 
 void
 KeyedObjectFactory::add_weak(KeyedObjectP& p)
 {
-  for (int i = wmap.size(); i <= p->getkey(); i++)
-		wmap.push_back(KeyedObjectW());
+  Slot *slot = make_slot(KeySlot(p->getkey()));
 
-	wmap[p->getkey()] = p;
+  Entry *e = new Entry(KeyGeneration(p->getkey()), p->getclass());
+  e->weak = p;
+
+  slot->Lock();
+  Entry *old = publish(slot, e);
+  slot->generation.store(e->generation, std::memory_order_release);
+  slot->Unlock();
+
+  if (old)
+    delete old;
+
+  count(p->getclass(), 1);
 }
 
 void
 KeyedObjectFactory::add_strong(KeyedObjectP& p)
 {
-  for (int i = smap.size(); i <= p->getkey(); i++)
-		smap.push_back(NULL);
+  Slot *slot = make_slot(KeySlot(p->getkey()));
+
+  // A dependent slot may still hold an object from an earlier generation if
+  // its DropMsg hasn't arrived yet; release that reference outside the lock
+
+  Entry *e = new Entry(KeyGeneration(p->getkey()), p->getclass());
+  e->strong = p;
+
+  slot->Lock();
+  Entry *doomed = publish(slot, e);
+  slot->generation.store(e->generation, std::memory_order_release);
+  slot->Unlock();
+
+  if (doomed)
+  {
+    if (doomed->strong)
+      count(doomed->klass, -1);
+    delete doomed;
+  }
+
+  count(p->getclass(), 1);
+}
+
+int
+KeyedObjectFactory::GetNumberOfLiveObjects(KeyedObjectClass c)
+{
+  pthread_mutex_lock(&lock);
+  int n = (c >= 0 && c < live_counts.size()) ? live_counts[c] : 0;
+  pthread_mutex_unlock(&lock);
+  return n;
+}
 
-	smap[p->getkey()] = p;
+void
+KeyedObjectFactory::DumpCounts()
+{
+  pthread_mutex_lock(&lock);
+  cerr << "live objects (" << next_slot << " slots, " << free_slots.size() << " free)\n";
+  for (int i = 0; i < live_counts.size(); i++)
+    if (live_counts[i])
+      cerr << "  " << class_names[i] << " " << live_counts[i] << endl;
+  pthread_mutex_unlock(&lock);
 }
 
 void
@@ -192,14 +430,19 @@ KeyedObject::KeyedObject(KeyedObjectClass c, Key k) : keyedObjectClass(c), key(k
 {  
 	ko_count++;
   error = 0;
+  dirty = 0;
 	initialize();
 }
 
 KeyedObject::~KeyedObject()
 {  
-  // If this is the *primary* object, send out message to remove dependents
+  // If this is the *primary* object, send out message to remove dependents, 
+  // then recycle its slot
   if (!GetTheApplication()->IsQuitting() && primary)
+  {
     Drop();
+    GetTheKeyedObjectFactory()->release(getkey());
+  }
 
 	ko_count--;
 }
@@ -284,43 +527,257 @@ KeyedObject::CommitMsg::CollectiveAction(MPI_Comm c, bool isRoot)
   if (! isRoot)
     kop->deserialize(p);
 
-  return kop->local_commit(c);
+  bool r = kop->local_commit(c);
+  kop->dirty = 0;
+  return r;
 }
 
-void
-KeyedObjectFactory::Dump()
+bool
+KeyedObject::CommitBatch(vector<KeyedObjectP>& objects)
 {
-  cerr << "STRONG keymap (" << smap.size() << ")\n";
-	for (int i = 0; i < smap.size(); i++)
+  if (objects.size() == 0)
+    return true;
+
+  CommitBatchMsg msg(objects);
+  msg.Broadcast(true, true);
+
+  bool ok = true;
+  for (auto kop : objects)
+  {
+    kop->NotifyObservers(ObserverEvent::Updated, (void *)kop.get());
+    if (kop->get_error() != 0)
+      ok = false;
+  }
+
+  return ok;
+}
+
+static int
+batch_size(vector<KeyedObjectP>& objects)
+{
+  int sz = sizeof(int);
+  for (auto kop : objects)
+    sz += sizeof(int) + kop->SerialSize();
+  return sz;
+}
+
+// Layout is the object count followed by, for each object, the size of its
+// serialization and the serialization itself, so that the root (which doesn't
+// deserialize) can step over each one.
+
+KeyedObject::CommitBatchMsg::CommitBatchMsg(vector<KeyedObjectP>& objects) : KeyedObject::CommitBatchMsg::CommitBatchMsg(batch_size(objects))
+{
+	unsigned char *p = (unsigned char *)get();
+	*(int *)p = objects.size();
+	p += sizeof(int);
+
+	for (auto kop : objects)
 	{
-		KeyedObjectP kop = smap[i];
-		if (kop != NULL)
-			cerr << "key " << i << " " << GetClassName(kop->getclass()) << " count " << kop.use_count() << endl;
+		int sz = kop->SerialSize();
+		*(int *)p = sz;
+		p += sizeof(int);
+		kop->Serialize(p);
+		p += sz;
 	}
+}
+
+bool
+KeyedObject::CommitBatchMsg::CollectiveAction(MPI_Comm c, bool isRoot)
+{
+  unsigned char *p = (unsigned char *)get();
+  int n = *(int *)p;
+  p += sizeof(int);
+
+  bool kill_app = false;
+  for (int i = 0; i < n; i++)
+  {
+    int sz = *(int *)p;
+    p += sizeof(int);
+
+    Key k = *(Key *)p;
+    KeyedObjectP kop = GetTheKeyedObjectFactory()->get(k);
+
+    if (! isRoot)
+      kop->deserialize(p + sizeof(Key));
+
+    if (kop->local_commit(c))
+      kill_app = true;
+
+    kop->dirty = 0;
+
+    p += sz;
+  }
+
+  return kill_app;
+}
+
+int
+KeyedObject::deltaSize()
+{
+  return serialSize();
+}
+
+unsigned char *
+KeyedObject::serializeDelta(unsigned char *p)
+{
+  return serialize(p);
+}
+
+unsigned char *
+KeyedObject::deserializeDelta(unsigned char *p)
+{
+  return deserialize(p);
+}
+
+bool
+KeyedObject::local_commit_delta(MPI_Comm c)
+{
+  return local_commit(c);
+}
 
-  cerr << "WEAK keymap (" << wmap.size() << ")\n";
-	for (int i = 0; i < wmap.size(); i++)
+bool
+KeyedObject::CommitDeltas(vector<KeyedObjectP>& objects)
+{
+  vector<KeyedObjectP> changed;
+  for (auto kop : objects)
+    if (kop->dirty)
+      changed.push_back(kop);
+
+  if (changed.size() == 0)
+    return true;
+
+  CommitDeltaMsg msg(changed);
+  msg.Broadcast(true, true);
+
+  bool ok = true;
+  for (auto kop : changed)
+  {
+    kop->NotifyObservers(ObserverEvent::Updated, (void *)kop.get());
+    if (kop->get_error() != 0)
+      ok = false;
+  }
+
+  return ok;
+}
+
+static int
+delta_batch_size(vector<KeyedObjectP>& objects)
+{
+  int sz = sizeof(int);
+  for (auto kop : objects)
+    sz += 2*sizeof(int) + sizeof(Key) + kop->DeltaSize();
+  return sz;
+}
+
+// Layout is the object count followed by, for each object, the size of the
+// record, the object's key, its dirty mask and then the delta itself.  The
+// dirty mask goes first so the receivers know which groups follow.
+
+KeyedObject::CommitDeltaMsg::CommitDeltaMsg(vector<KeyedObjectP>& objects) : KeyedObject::CommitDeltaMsg::CommitDeltaMsg(delta_batch_size(objects))
+{
+	unsigned char *p = (unsigned char *)get();
+	*(int *)p = objects.size();
+	p += sizeof(int);
+
+	for (auto kop : objects)
 	{
-		KeyedObjectP kop = wmap[i].lock();
-		if (kop != NULL)
-			cerr << "key " << i << " " << GetClassName(kop->getclass()) << " count " << kop.use_count() << endl;
+		int sz = sizeof(Key) + sizeof(int) + kop->deltaSize();
+		*(int *)p = sz;
+		p += sizeof(int);
+
+		unsigned char *q = p;
+		*(Key *)q = kop->getkey();
+		q += sizeof(Key);
+		*(int *)q = kop->dirty;
+		q += sizeof(int);
+		kop->serializeDelta(q);
+
+		p += sz;
+	}
+}
+
+bool
+KeyedObject::CommitDeltaMsg::CollectiveAction(MPI_Comm c, bool isRoot)
+{
+  unsigned char *p = (unsigned char *)get();
+  int n = *(int *)p;
+  p += sizeof(int);
+
+  bool kill_app = false;
+  for (int i = 0; i < n; i++)
+  {
+    int sz = *(int *)p;
+    p += sizeof(int);
+
+    unsigned char *q = p;
+    Key k = *(Key *)q;
+    q += sizeof(Key);
+
+    KeyedObjectP kop = GetTheKeyedObjectFactory()->get(k);
+
+    kop->dirty = *(int *)q;
+    q += sizeof(int);
+
+    if (! isRoot)
+      kop->deserializeDelta(q);
+
+    if (kop->local_commit_delta(c))
+      kill_app = true;
+
+    kop->dirty = 0;
+
+    p += sz;
+  }
+
+  return kill_app;
+}
+
+void
+KeyedObjectFactory::Dump()
+{
+  cerr << "keymap (" << next_slot << " slots)\n";
+	for (int i = 0; i < next_slot; i++)
+	{
+		Slot *slot = get_slot(i);
+		Entry e(-1, -1);
+		if (! slot || ! read_slot(slot, e)) continue;
+
+		KeyedObjectP skop = e.strong;
+		KeyedObjectP wkop = e.weak.lock();
+
+		if (skop != NULL)
+			cerr << "STRONG key " << skop->getkey() << " " << GetClassName(skop->getclass()) << " count " << (skop.use_count() - 1) << endl;
+		if (wkop != NULL)
+			cerr << "WEAK key " << wkop->getkey() << " " << GetClassName(wkop->getclass()) << " count " << (wkop.use_count() - 1) << endl;
 	}
 }
 
 KeyedObjectFactory::~KeyedObjectFactory() 
 {
-  // No idea why this is necessary.   Without it, when the wmap vector is destroyed a 
+  // No idea why this is necessary.   Without it, when the weak references are destroyed a 
   // segfault occurs in the weak pointer part of the shared_ptr code.
 
-  void *d = wmap.data();
-  size_t s = wmap.size() * sizeof(wmap[0]);
-  memset(d, 0, s);
-
-	while (wmap.size() > 0)
-		wmap.pop_back();
+  for (int i = 0; i < MAX_CHUNKS; i++)
+  {
+    Slot *chunk = chunks[i].load();
+    if (chunk)
+    {
+      for (int j = 0; j < SLOTS_PER_CHUNK; j++)
+      {
+        Entry *e = chunk[j].entry.load();
+        if (e)
+        {
+          e->strong = nullptr;
+          memset((void *)&e->weak, 0, sizeof(e->weak));
+          delete e;
+        }
+      }
+      delete[] chunk;
+      chunks[i] = NULL;
+    }
+  }
 
-	while (smap.size() > 0)
-		smap.pop_back();
+  free_slots.clear();
 
   while (new_procs.size() > 0)
     new_procs.pop_back();
@@ -328,6 +785,8 @@ KeyedObjectFactory::~KeyedObjectFactory()
   while (class_names.size() > 0)
     class_names.pop_back();
 
+  pthread_mutex_destroy(&lock);
+
 	if (ko_count > 0)
   {
 		cerr << ko_count << " shared objects remain!!!" << endl;
@@ -99,8 +99,11 @@ causing them to actually be deleted.
 
 *********/
 
+#include <atomic>
+#include <cstring>
 #include <string>
 #include <iostream>
+#include <pthread.h>
 #include <vector>
 
 #include "GalaxyObject.h"
@@ -151,6 +154,8 @@ public:
 	static void Register()
 	{
 		CommitMsg::Register();
+		CommitBatchMsg::Register();
+		CommitDeltaMsg::Register();
 	};
 
   //! return the class identifier int
@@ -193,6 +198,35 @@ public:
   //! commit this object to the local registry
   virtual bool local_commit(MPI_Comm);
 
+  //! commit a set of objects to the global registry using a single collective message
+  /*! Each object's serialized state is packed into one CommitBatchMsg, so committing
+   * many objects costs one broadcast rather than one per object.  Only the object's
+   * own state is shipped: classes whose Commit() also commits contained objects
+   * (e.g. Visualization) should commit those separately.
+   * \param objects the objects to commit
+   * \returns true if every object committed without error
+   */
+  static bool CommitBatch(std::vector<KeyedObjectP>& objects);
+
+  //! commit only what has changed since the last commit of a set of objects using a single collective message
+  /*! Objects record which groups of their parameters have changed in their dirty mask.  Each
+   * object with a non-zero mask ships its serializeDelta() rather than its full serialization
+   * and is brought up to date by local_commit_delta() rather than local_commit(); objects with a
+   * clear mask are skipped entirely.  By default the delta is the full state, so this is only a
+   * saving for classes that override the delta methods.
+   * \param objects the objects to commit
+   * \returns true if every object committed without error
+   */
+  static bool CommitDeltas(std::vector<KeyedObjectP>& objects);
+
+  //! return the mask of parameter groups that have changed since this object was last committed
+  int get_dirty() { return dirty; }
+
+  //! return the byte size of the delta this object would ship in a CommitDeltas
+  /*! \warning derived classes should not overload this method. Instead, implement an override of deltaSize.
+   */
+  int DeltaSize() { return deltaSize(); }
+
 	// only concrete subclasses have static LoadToJSON at abstract layer
   //! construct object from a Galaxy JSON specification
   virtual bool LoadFromJSON(rapidjson::Value&) { std::cerr << "abstract KeyedObject LoadFromJSON" << std::endl; return false; }
@@ -210,11 +244,51 @@ public:
     bool CollectiveAction(MPI_Comm c, bool isRoot);
   };
 
+  //! a helper class for global messages to deserialize and commit a set of KeyedObjects in one collective
+  class CommitBatchMsg : public Work
+  {
+  public:
+    CommitBatchMsg(std::vector<KeyedObjectP>& objects);
+
+    // defined in Work.h
+    WORK_CLASS(CommitBatchMsg, false);
+
+  public:
+    bool CollectiveAction(MPI_Comm c, bool isRoot);
+  };
+
+  //! a helper class for global messages to apply parameter deltas to a set of KeyedObjects in one collective
+  class CommitDeltaMsg : public Work
+  {
+  public:
+    CommitDeltaMsg(std::vector<KeyedObjectP>& objects);
+
+    // defined in Work.h
+    WORK_CLASS(CommitDeltaMsg, false);
+
+  public:
+    bool CollectiveAction(MPI_Comm c, bool isRoot);
+  };
+
 protected:
   KeyedObjectClass keyedObjectClass;
   Key key;
   bool primary;
 
+  //! bitmask of parameter groups changed since the last commit; the meaning of each bit is up to the subclass
+  int dirty;
+  //! note that a group of parameters has changed
+  void mark_dirty(int bits) { dirty |= bits; }
+
+  //! return the byte size of the delta described by the dirty mask (default: serialSize())
+  virtual int deltaSize();
+  //! serialize the parameter groups named in the dirty mask (default: serialize())
+  virtual unsigned char *serializeDelta(unsigned char *);
+  //! deserialize the parameter groups named in the dirty mask (default: deserialize())
+  virtual unsigned char *deserializeDelta(unsigned char *);
+  //! update local state for the parameter groups named in the dirty mask (default: local_commit())
+  virtual bool local_commit_delta(MPI_Comm);
+
 private:
   //! remove this object from the global registry
 	virtual void Drop();
@@ -245,10 +319,28 @@ extern void aol(KeyedObjectP& p);
  * \sa KeyedObject, Work, OBJECT_POINTER_TYPES, KEYED_OBJECT, KEYED_OBJECT_SUBCLASS
  */
 
+/*
+ * The registry is a slot map.   A Key packs a slot index (low KEY_SLOT_BITS bits) 
+ * and a generation counter (the bits above).   When a primary object is
+ * destroyed its slot is recycled with an incremented generation, so stale keys 
+ * held elsewhere (e.g. in RayLists still in flight) resolve to NULL rather than 
+ * to whatever object next occupies the slot.   Once a slot's generation would
+ * wrap it is retired rather than reused, so that promise holds however long a
+ * server runs.   Keys stay below 2^31 since they are passed to clients as JSON ints.
+ *
+ * Slots live in fixed-size chunks that are allocated on demand and never move,
+ * so lookups need no lock at all: get() checks the slot's generation, then 
+ * registers in one of the slot's two reader counts, copies the reference out
+ * of the slot's current Entry and deregisters (see read_slot and publish below).
+ * Writers to a slot are serialized by a per-slot spinlock.   The registry lock 
+ * is only taken to allocate keys and chunks and to maintain the per-class live 
+ * object counts.
+ */
+
 class KeyedObjectFactory
 {
 public:
-	KeyedObjectFactory() { next_key = 0; } //!< constructor
+	KeyedObjectFactory(); //!< constructor
 	~KeyedObjectFactory(); //!< destructor
 
   //! add the class to the KeyedObject registry
@@ -279,6 +371,7 @@ public:
 	static void Register()
 	{
 		NewMsg::Register();
+		NewBatchMsg::Register();
 		DropMsg::Register();
 	}
 
@@ -300,6 +393,33 @@ public:
     return kop;
   }
 
+  //! create `n` new instances of a KeyedObject-derived class using a single broadcast
+  /*! \param c the KeyedObject class id, which is created using the OBJECT_CLASS_TYPE macro
+   * \param n the number of instances to create
+   * \param objects vector to which the new primary objects are appended
+   * \sa OBJECT_CLASS_TYPE
+   */
+  void New(KeyedObjectClass c, int n, std::vector<KeyedObjectP>& objects)
+  {
+    if (n <= 0)
+      return;
+
+    std::vector<Key> keys;
+    for (int i = 0; i < n; i++)
+    {
+      Key k = keygen();
+      KeyedObjectP kop = std::shared_ptr<KeyedObject>(new_procs[c](k));
+      kop->primary = true;
+      aol(kop);
+      add_weak(kop);
+      objects.push_back(kop);
+      keys.push_back(k);
+    }
+
+    NewBatchMsg msg(c, keys);
+    msg.Broadcast(true, true);
+  }
+
   //! create a new instance of a KeyedObject-derived class with a given Key
   /*! \param c the KeyedObject class id, which is created using the OBJECT_CLASS_TYPE macro
    * \param k the key id to use for this KeyedObject
@@ -356,21 +476,90 @@ public:
    */
   void erase(Key k);
 
-  //! generate a registration key for a KeyedObject
-  Key keygen()
+  //! return the slot of a primary KeyedObject to the free list for reuse
+  /*! Called when a primary object is destroyed, after its dependents have been dropped.
+   * A slot whose generation has run through KEY_GENERATION_MASK is retired instead.
+   * \param k the Key of the destroyed primary object
+   */
+  void release(Key k);
+
+  //! generate a registration key for a KeyedObject, reusing a free slot if one is available
+  Key keygen();
+
+  //! return the number of registered objects of the given class on this process
+  int GetNumberOfLiveObjects(KeyedObjectClass c);
+
+  //! print the number of registered objects of each class to std::cerr
+  void DumpCounts();
+
+  static const int KEY_SLOT_BITS = 22;                      //!< number of low-order Key bits holding the slot index
+  static const int KEY_GENERATION_MASK = 0x1ff;             //!< generation bits held above the slot index
+  static const int KEY_SLOT_MASK = (1 << KEY_SLOT_BITS) - 1;
+
+  static int  KeySlot(Key k) { return (int)(k & KEY_SLOT_MASK); }
+  static int  KeyGeneration(Key k) { return (int)((k >> KEY_SLOT_BITS) & KEY_GENERATION_MASK); }
+  static Key  MakeKey(int slot, int generation) { return ((Key)generation << KEY_SLOT_BITS) | (Key)slot; }
+
+private:
+
+  // A slot's contents are published as an immutable Entry so that lookups
+  // take no lock.  A reader registers in one of the slot's two reader counts,
+  // copies the reference out of the current Entry and deregisters.  Writers,
+  // serialized by the slot's spinlock, swap in a new Entry, then twice flip
+  // new readers over to the other count and wait for the old count to drain,
+  // after which no reader can still hold the old Entry.
+
+  struct Entry
+  {
+    Entry(int g, KeyedObjectClass c) : generation(g), klass(c) {}
+
+    int               generation;
+    KeyedObjectClass  klass;
+    KeyedObjectW      weak;       // primary objects
+    KeyedObjectP      strong;     // dependent objects
+  };
+
+  struct Slot
+  {
+    Slot() : generation(0), entry(NULL), epoch(0) { busy.clear(); readers[0] = 0; readers[1] = 0; }
+
+    void Lock()   { while (busy.test_and_set(std::memory_order_acquire)); }
+    void Unlock() { busy.clear(std::memory_order_release); }
+
+    std::atomic<int>     generation;
+    std::atomic<Entry *> entry;
+    std::atomic<int>     epoch;
+    std::atomic<int>     readers[2];
+    std::atomic_flag     busy;
+  };
+
+  //! copy the current contents of a slot without locking; returns false if it is empty
+  bool read_slot(Slot *slot, Entry& copy);
+
+  //! replace the contents of a slot whose lock is held, returning the old Entry once no reader can be using it
+  Entry *publish(Slot *slot, Entry *e);
+
+  static const int SLOTS_PER_CHUNK = 4096;
+  static const int MAX_CHUNKS = (1 << KEY_SLOT_BITS) / SLOTS_PER_CHUNK;
+
+  Slot *get_slot(int slot)
   {
-    return (Key)next_key++;
+    Slot *chunk = chunks[slot / SLOTS_PER_CHUNK].load(std::memory_order_acquire);
+    return chunk ? chunk + (slot % SLOTS_PER_CHUNK) : NULL;
   }
 
-private:
+  Slot *make_slot(int slot);
+  void  count(KeyedObjectClass c, int d);
 
   std::vector<KeyedObject*(*)(Key)> new_procs;
   std::vector<std::string> class_names;
 
-  std::vector<KeyedObjectW> wmap; // map of weak references
-  std::vector<KeyedObjectP> smap; // map of strong references
+  std::atomic<Slot *> chunks[MAX_CHUNKS];
+  std::vector<int> free_slots;
+  std::vector<int> live_counts;
+  int next_slot;
 
-	int next_key;
+  pthread_mutex_t lock;
 
 public:
 
@@ -393,6 +582,27 @@ public:
     bool CollectiveAction(MPI_Comm comm, bool isRoot);
   };
 
+  //! helper class to broadcast a set of new KeyedObject registrants of one class to all processes
+  class NewBatchMsg : public Work
+  {
+  public:
+
+    NewBatchMsg(KeyedObjectClass c, std::vector<Key>& keys) : NewBatchMsg(sizeof(KeyedObjectClass) + sizeof(int) + keys.size()*sizeof(Key))
+    {
+      unsigned char *p = (unsigned char *)get();
+      *(KeyedObjectClass *)p = c;
+      p += sizeof(KeyedObjectClass);
+      *(int *)p = keys.size();
+      p += sizeof(int);
+      memcpy(p, keys.data(), keys.size()*sizeof(Key));
+    }
+
+    WORK_CLASS(NewBatchMsg, false);
+
+  public:
+    bool CollectiveAction(MPI_Comm comm, bool isRoot);
+  };
+
   //! helper class to broadcast dropped KeyedObject instances to all processes
   class DropMsg : public Work
   {
@@ -451,6 +661,19 @@ public:
     return Cast(kop);                                                                           \
   }                                                                                             \
                                                                                                 \
+  static std::vector<typ ## P> NewP(int n)                                                      \
+  {                                                                                             \
+    std::vector<KeyedObjectP> kops;                                                             \
+    GetTheKeyedObjectFactory()->New(ClassType, n, kops);                                        \
+    std::vector<typ ## P> objects;                                                              \
+    for (auto kop : kops)                                                                       \
+    {                                                                                           \
+      aol(kop);                                                                                 \
+      objects.push_back(Cast(kop));                                                             \
+    }                                                                                           \
+    return objects;                                                                             \
+  }                                                                                             \
+                                                                                                \
   static void RegisterClass()                                                                   \
   {                                                                                             \
     typ::ClassType = GetTheKeyedObjectFactory()->register_class(typ::_New, std::string(#typ));  \
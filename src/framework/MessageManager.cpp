@@ -25,12 +25,14 @@
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <cstdlib>
 
 #include "Application.h"
 #include "Threading.h"
 #include "MessageManager.h"
 #include "Message.h"
 #include "MessageQ.h"
+#include "Metrics.h"
 
 #include <string>
 #include <fstream>
@@ -56,6 +58,7 @@ struct mpi_send_buffer
 	int n;
 	unsigned char *send_buffer;
 	int total_size;
+	double posted;		// when the send was posted, if metrics are enabled
 };
 
 vector<mpi_send_buffer *> mpi_in_flight;
@@ -83,6 +86,14 @@ purge_completed_mpi_buffers()
 			{
 				done = false;
 
+				if (Metrics::Enabled() && m->posted > 0)
+				{
+					double latency = Metrics::Now() - m->posted;
+					Metrics::Count(Metrics::SENDS_COMPLETED, 1);
+					Metrics::Time(Metrics::SEND_LATENCY, latency);
+					Metrics::Peak(Metrics::SEND_LATENCY_MAX, (long)(latency * 1000000.0));
+				}
+
 				mpi_in_flight.erase(i);
         free(m->send_buffer);
 
@@ -122,7 +133,6 @@ MessageManager::workThread(void *p)
 			break;
 
     Work *w = app->Deserialize(m);
-
     w->Action(m->GetSender());
     delete w;
 
@@ -175,6 +185,20 @@ void *MessageManager::messageThread(void *p)
 
 	setup_mpi(app, mm);	// just sets rank=0 and size=1 if no MPI
 
+	// For testing distributed termination, GXY_MESSAGE_DELAY=<usec> holds each 
+	// incoming point-to-point message for a random time up to the given number of
+	// microseconds before it becomes available to the work thread.  Since each
+	// message draws its own delay, later messages can overtake earlier ones.
+
+	mm->max_delay = getenv("GXY_MESSAGE_DELAY") ? atoi(getenv("GXY_MESSAGE_DELAY")) : 0;
+	mm->delay_seed = app->GetRank() + 1;
+
+	// The pool is sized by the number of ranks on this node, so it can't be
+	// made before setup_mpi; making it here, before the message loop starts,
+	// ensures it exists before the work thread sees any Work
+
+	app->CreateThreadPool();
+
 	mm->Lock();
   mm->wait--;
 	if (mm->wait == 0)
@@ -251,6 +275,9 @@ MessageManager::MessageManager()
 	clientserver_skt = -1;
 	message_tid = 0;
 	work_tid = 0;
+	max_delay = 0;
+	delay_seed = 1;
+	local_size = 1;
 
   pthread_mutex_init(&lock, NULL);
   pthread_cond_init(&cond, NULL);
@@ -354,23 +381,28 @@ MessageManager::Export(Message *m)
   if (m->HasContent())
     memcpy(msb->send_buffer + m->GetHeaderSize(), m->GetContent(), m->GetSize());
 
+	msb->posted = Metrics::Enabled() ? Metrics::Now() : 0;
+
   if (m->IsBroadcast())
 	{
     int l = (2 * d) + 1;
 		int destination = (root + l) % size;
 		MPI_Isend(msb->send_buffer, msb->total_size, MPI_UNSIGNED_CHAR, destination, tag, p2p_comm, &msb->lrq);
+		Metrics::SentTo(destination, msb->total_size);
 		k++;
 
 		if ((l + 1) < size)
 		{
 			destination = (root + l + 1) % size;
 			MPI_Isend(msb->send_buffer, msb->total_size, MPI_UNSIGNED_CHAR, destination, tag, p2p_comm, &msb->rrq);
+			Metrics::SentTo(destination, msb->total_size);
 			k++;
 		}
   }
 	else
 	{
 		MPI_Isend(msb->send_buffer, msb->total_size, MPI_UNSIGNED_CHAR, m->GetDestination(), tag, p2p_comm, &msb->lrq);
+		Metrics::SentTo(m->GetDestination(), msb->total_size);
 		k++;
 	}
 
@@ -399,6 +431,9 @@ MessageManager::check_mpi(MessageManager *mm)
 
 		Message *incoming_message = new Message(status);
 
+		Metrics::Count(Metrics::MESSAGES_RECEIVED, 1);
+		Metrics::Count(Metrics::BYTES_RECEIVED, incoming_message->GetHeaderSize() + (incoming_message->HasContent() ? incoming_message->GetSize() : 0));
+
 #if 0
 		double t1 = GetTheEventTracker()->gettime();
 #endif
@@ -421,12 +456,15 @@ MessageManager::check_mpi(MessageManager *mm)
 			else
 			{
 				mm->GetIncomingMessageQueue()->Enqueue(incoming_message);
+				Metrics::Peak(Metrics::MESSAGEQ_DEPTH, mm->GetIncomingMessageQueue()->size());
 			}
 
 		}
 		else
 		{
-			mm->GetIncomingMessageQueue()->Enqueue(incoming_message);
+			int delay = (mm->max_delay > 0) ? rand_r(&mm->delay_seed) % mm->max_delay : 0;
+			mm->GetIncomingMessageQueue()->Enqueue(incoming_message, delay);
+			Metrics::Peak(Metrics::MESSAGEQ_DEPTH, mm->GetIncomingMessageQueue()->size());
 		}
 	}
 
@@ -552,6 +590,21 @@ MessageManager::setup_mpi(Application *app, MessageManager *mm)
 		MPI_Comm_size(MPI_COMM_WORLD, &sz);
 		mm->SetSize(sz);
 
+		MPI_Comm node;
+		MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rs, MPI_INFO_NULL, &node);
+		MPI_Comm_size(node, &sz);
+		mm->local_size = sz;
+		MPI_Comm_free(&node);
+
+		// Clock alignment is O(size) round trips to rank 0, so only pay for 
+		// it if some process is tracking events; otherwise it is done when
+		// tracking is first turned on by EnableAll
+
+		int tracking = EventTracker::Enabled() ? 1 : 0, any;
+		MPI_Allreduce(&tracking, &any, 1, MPI_INT, MPI_MAX, coll);
+		if (any)
+			EventTracker::AlignClocks(coll);
+
 #if defined(GXY_EVENT_TRACKING)
 
     class PIDEvent : public Event
@@ -581,6 +634,7 @@ MessageManager::setup_mpi(Application *app, MessageManager *mm)
 	{
 		mm->SetRank(0);
 		mm->SetSize(1);
+		mm->local_size = 1;
 	}
 }
 
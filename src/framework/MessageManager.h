@@ -68,6 +68,9 @@ public:
   //! get the rank of this process in the associated MPI pool
   int GetRank() { return mpi_rank; }
 
+  //! get the number of processes in the MPI pool that share this node
+  int GetLocalSize() { return local_size; }
+
   //! set the size of the MPI pool associated with this MessageManager
   void SetSize(int s) { mpi_size = s; }
   //! set the rank of this process in the associated MPI pool
@@ -164,11 +167,15 @@ private:
   int wait;
   int mpi_rank;
   int mpi_size;
+  int local_size;
 
 	bool with_mpi;
 	bool pause;
 	bool quit;
 
+	int max_delay;								// GXY_MESSAGE_DELAY, in microseconds
+	unsigned int delay_seed;
+
 	MPI_Comm p2p_comm, coll_comm;
 };
 
@@ -21,6 +21,7 @@
 #include "MessageQ.h"
 
 #include <unistd.h>
+#include <time.h>
 #include <iostream>
 
 #include "Application.h"
@@ -30,11 +31,30 @@ using namespace std;
 
 namespace gxy
 {
+static double
+now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
 void
-MessageQ::Enqueue(Message *w)
+MessageQ::Enqueue(Message *w, int delay)
 {
   pthread_mutex_lock(&lock);
-  workq.push_back(w);
+
+  // Keep the queue sorted by release time.  Undelayed messages are released
+  // immediately, so they stay FIFO among themselves.
+
+  double t = now() + delay * 1e-6;
+  size_t i = workq.size();
+  while (i > 0 && release[i-1] > t)
+    i--;
+
+  workq.insert(workq.begin() + i, w);
+  release.insert(release.begin() + i, t);
+
   pthread_cond_signal(&signal);
   pthread_mutex_unlock(&lock);
 }
@@ -44,14 +64,29 @@ MessageQ::Dequeue()
 {
   pthread_mutex_lock(&lock);
 
-  while (workq.empty() && running)
-    pthread_cond_wait(&signal, &lock);
+  while (running)
+  {
+    if (workq.empty())
+      pthread_cond_wait(&signal, &lock);
+    else
+    {
+      double t = release.front();
+      if (t <= now())
+        break;
+
+      struct timespec ts;
+      ts.tv_sec = (time_t)t;
+      ts.tv_nsec = (long)((t - ts.tv_sec) * 1e9);
+      pthread_cond_timedwait(&signal, &lock, &ts);
+    }
+  }
 
   Message *r = NULL;
   if (! workq.empty())
 	{
     r = workq.front();
     workq.pop_front();
+    release.pop_front();
   }
 
   pthread_mutex_unlock(&lock);
@@ -65,10 +65,13 @@ public:
 
   //! add a Message to the queue
   /*! When the message is added, this method also signals the mutex that a message has arrived.
+   * \param w the Message to add
+   * \param delay microseconds before the Message may be dequeued.  Messages are dequeued in
+   *              order of release time, so a delayed Message can be overtaken by later ones.
    */
-  void Enqueue(Message *w);
+  void Enqueue(Message *w, int delay = 0);
   //! remove a Message from the queue
-  /*! If the queue is empty and the queue is running, a call to this method will block until a message is received.
+  /*! If no message is due and the queue is running, a call to this method will block until one is.
    * If a Kill has been issued to this queue, this method will not block and return the next message in the queue,
    * if any, or `NULL` if no messages are present.
    */
@@ -92,6 +95,7 @@ private:
   bool running;
 
   std::deque<Message *> workq;
+  std::deque<double> release;   // per-message release time, parallel to workq
 };
 
 } // namespace gxy
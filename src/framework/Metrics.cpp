@@ -0,0 +1,467 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <pthread.h>
+
+#include "Application.h"
+#include "Metrics.h"
+#include "Threading.h"
+
+using namespace std;
+
+namespace gxy
+{
+
+WORK_CLASS_TYPE(Metrics::EnableMsg)
+WORK_CLASS_TYPE(Metrics::ReportMsg)
+
+std::atomic<bool> Metrics::enabled(false);
+std::atomic<long> Metrics::counters[Metrics::N_COUNTERS];
+std::atomic<long> Metrics::timers[Metrics::N_TIMERS];
+std::atomic<long> Metrics::gauges[Metrics::N_GAUGES];
+
+static const char *counter_names[] = 
+{
+	"rays_traced", "samples", "rays_originated", "rays_secondary", "rays_sent", "rays_received",
+	"pixels_local", "pixels_sent", "messages_sent", "bytes_sent", "messages_received", "bytes_received",
+	"sends_completed", "rays_dropped_stale", "rays_traced_stale",
+	"lanes_active_sorted", "lane_slots_sorted", "lanes_active_unsorted", "lane_slots_unsorted"
+};
+
+static const char *gauge_names[] = 
+{
+	"max_ray_queue", "max_message_queue", "max_pool_queue", "max_send_latency_usec"
+};
+
+// Per-process frame state.  per_dest holds three arrays of
+// GetSize() entries: messages, bytes and rays sent to each process.
+// It is allocated the first time something is sent, since the size
+// isn't known until the MessageManager has started.
+
+static pthread_mutex_t metrics_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t dest_lock = PTHREAD_MUTEX_INITIALIZER;
+static std::atomic<std::atomic<long> *> per_dest(NULL);
+static int    dest_count = 0;
+static int    frame_seq = -1;
+static bool   frame_open = false;
+static double base_time = 0;
+static double frame_start = 0;
+static std::atomic<long> last_activity(0);   // usec since base_time
+
+// Rank 0's aggregation state: reports received for frames that not
+// every process has reported yet, and the output stream
+
+static std::string format = "json";
+static std::map<int, std::vector<SharedP>> pending;
+static std::fstream out;
+
+struct report
+{
+	int    rank;
+	int    frame;
+	int    size;
+	int    nthreads;
+	double t_start;
+	double t_end;
+	long   counters[Metrics::N_COUNTERS];
+	long   timers[Metrics::N_TIMERS];
+	long   gauges[Metrics::N_GAUGES];
+	// followed by messages[size], bytes[size], rays[size]
+};
+
+static std::atomic<long> *
+get_per_dest()
+{
+	std::atomic<long> *p = per_dest.load();
+	if (! p)
+	{
+		pthread_mutex_lock(&dest_lock);
+		p = per_dest.load();
+		if (! p)
+		{
+			dest_count = GetTheApplication()->GetSize();
+			p = new std::atomic<long>[3 * dest_count];
+			for (int i = 0; i < 3 * dest_count; i++)
+				p[i] = 0;
+			per_dest = p;
+		}
+		pthread_mutex_unlock(&dest_lock);
+	}
+	return p;
+}
+
+void
+Metrics::Register()
+{
+	EnableMsg::Register();
+	ReportMsg::Register();
+
+	for (int i = 0; i < N_COUNTERS; i++) counters[i] = 0;
+	for (int i = 0; i < N_TIMERS; i++) timers[i] = 0;
+	for (int i = 0; i < N_GAUGES; i++) gauges[i] = 0;
+
+	base_time = Now();
+
+	if (getenv("GXY_METRICS"))
+	{
+		std::string f = getenv("GXY_METRICS");
+		if (f == "chrome" || f == "json")
+			format = f;
+		else
+			std::cerr << "WARNING: GXY_METRICS should be json or chrome; using json" << std::endl;
+		enabled = true;
+	}
+}
+
+void
+Metrics::Enable(bool on, std::string f)
+{
+	EnableMsg msg(on, f);
+	msg.Broadcast(true, true);
+}
+
+void
+Metrics::SentTo(int dest, long bytes)
+{
+	if (! Enabled()) return;
+
+	std::atomic<long> *p = get_per_dest();
+	if (dest >= 0 && dest < dest_count)
+	{
+		p[dest].fetch_add(1, std::memory_order_relaxed);
+		p[dest_count + dest].fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	counters[MESSAGES_SENT].fetch_add(1, std::memory_order_relaxed);
+	counters[BYTES_SENT].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void
+Metrics::RaysTo(int dest, long n)
+{
+	if (! Enabled()) return;
+
+	std::atomic<long> *p = get_per_dest();
+	if (dest >= 0 && dest < dest_count)
+		p[2*dest_count + dest].fetch_add(n, std::memory_order_relaxed);
+
+	counters[RAYS_SENT].fetch_add(n, std::memory_order_relaxed);
+}
+
+void
+Metrics::Traced(long n, long s, double t0, double t1)
+{
+	if (! Enabled()) return;
+
+	counters[RAYS_TRACED].fetch_add(n, std::memory_order_relaxed);
+	counters[SAMPLES].fetch_add(s, std::memory_order_relaxed);
+	timers[TRACE_TIME].fetch_add((long)((t1 - t0) * 1000000.0), std::memory_order_relaxed);
+
+	long t = (long)((t1 - base_time) * 1000000.0);
+	long cur = last_activity.load(std::memory_order_relaxed);
+	while (t > cur && !last_activity.compare_exchange_weak(cur, t, std::memory_order_relaxed));
+}
+
+// Package up the current frame's counters, reset them and send them to
+// rank 0.  Called with metrics_lock held.
+
+void
+Metrics::ship()
+{
+	std::atomic<long> *p = get_per_dest();
+
+	ReportMsg msg(sizeof(report) + 3 * dest_count * sizeof(long));
+	report *r = (report *)msg.get_contents();
+
+	double now = Now();
+	double end = base_time + (last_activity.exchange(0) / 1000000.0);
+
+	r->rank     = GetTheApplication()->GetRank();
+	r->frame    = frame_seq;
+	r->size     = dest_count;
+	r->nthreads = GetTheApplication()->GetTheThreadPool()->GetNumberOfThreads();
+	r->t_start  = frame_start - base_time;
+	r->t_end    = ((end > frame_start) ? end : now) - base_time;
+
+	for (int i = 0; i < N_COUNTERS; i++) r->counters[i] = counters[i].exchange(0);
+	for (int i = 0; i < N_TIMERS; i++)   r->timers[i]   = timers[i].exchange(0);
+	for (int i = 0; i < N_GAUGES; i++)   r->gauges[i]   = gauges[i].exchange(0);
+
+	long *d = (long *)(r + 1);
+	for (int i = 0; i < 3 * dest_count; i++)
+		d[i] = p[i].exchange(0);
+
+	msg.Send(0);
+}
+
+void
+Metrics::BeginFrame()
+{
+	pthread_mutex_lock(&metrics_lock);
+
+	if (frame_open)
+		ship();
+
+	frame_seq++;
+	frame_open = Enabled();
+
+	if (frame_open)
+	{
+		// Drop anything that trickled in from a frame that wasn't being measured
+
+		if (per_dest.load())
+			for (int i = 0; i < 3 * dest_count; i++)
+				per_dest.load()[i] = 0;
+
+		for (int i = 0; i < N_COUNTERS; i++) counters[i] = 0;
+		for (int i = 0; i < N_TIMERS; i++)   timers[i] = 0;
+		for (int i = 0; i < N_GAUGES; i++)   gauges[i] = 0;
+		last_activity = 0;
+
+		frame_start = Now();
+	}
+
+	pthread_mutex_unlock(&metrics_lock);
+}
+
+void
+Metrics::Flush()
+{
+	pthread_mutex_lock(&metrics_lock);
+
+	if (frame_open)
+		ship();
+
+	frame_open = false;
+
+	pthread_mutex_unlock(&metrics_lock);
+}
+
+Metrics::EnableMsg::EnableMsg(bool on, std::string f) : EnableMsg(sizeof(int) + f.length() + 1)
+{
+	unsigned char *p = (unsigned char *)get();
+	*(int *)p = on ? 1 : 0;
+	memcpy(p + sizeof(int), f.c_str(), f.length() + 1);
+}
+
+bool
+Metrics::EnableMsg::CollectiveAction(MPI_Comm c, bool isRoot)
+{
+	unsigned char *p = (unsigned char *)get();
+	bool on = *(int *)p != 0;
+	std::string f((char *)(p + sizeof(int)));
+
+	if (f == "json" || f == "chrome")
+		format = f;
+
+	if (on && !Enabled())
+	{
+		// Reset the time base here so that, since this is collective, the 
+		// per-process timelines line up approximately in the report
+
+		base_time = Now();
+		enabled = true;
+	}
+	else if (!on && Enabled())
+	{
+		Flush();
+		enabled = false;
+	}
+
+	return false;
+}
+
+// Write the fields of one process' report as a comma-separated list 
+// of JSON key/value pairs
+
+static void
+write_fields(std::ostream& o, report *r)
+{
+	long *d = (long *)(r + 1);
+
+	double elapsed = r->t_end - r->t_start;
+	if (elapsed <= 0) elapsed = 1e-6;
+
+	double trace_time = r->timers[Metrics::TRACE_TIME] / 1000000.0;
+	double pool_time  = r->timers[Metrics::POOL_BUSY_TIME] / 1000000.0;
+	long   nsends     = r->counters[Metrics::SENDS_COMPLETED];
+
+	o << "\"rank\":" << r->rank
+		<< ",\"elapsed\":" << elapsed;
+
+	for (int i = 0; i < Metrics::N_COUNTERS; i++)
+		o << ",\"" << counter_names[i] << "\":" << r->counters[i];
+
+	for (int i = 0; i < Metrics::N_GAUGES; i++)
+		o << ",\"" << gauge_names[i] << "\":" << r->gauges[i];
+
+	o << ",\"useful_rays\":" << (r->counters[Metrics::RAYS_TRACED] - r->counters[Metrics::RAYS_TRACED_STALE])
+		<< ",\"rays_per_sec\":" << (r->counters[Metrics::RAYS_TRACED] / elapsed)
+		<< ",\"samples_per_sec\":" << (r->counters[Metrics::SAMPLES] / elapsed)
+		<< ",\"trace_seconds\":" << trace_time
+		<< ",\"trace_rays_per_thread_sec\":" << (trace_time > 0 ? r->counters[Metrics::RAYS_TRACED] / trace_time : 0)
+		<< ",\"pool_threads\":" << r->nthreads
+		<< ",\"pool_utilization\":" << (r->nthreads > 0 ? pool_time / (r->nthreads * elapsed) : 0)
+		<< ",\"avg_send_latency_usec\":" << (nsends > 0 ? (double)r->timers[Metrics::SEND_LATENCY] / nsends : 0);
+
+	long slots_sorted   = r->counters[Metrics::LANE_SLOTS_SORTED];
+	long slots_unsorted = r->counters[Metrics::LANE_SLOTS_UNSORTED];
+
+	o << ",\"lane_utilization_sorted\":" 
+			<< (slots_sorted > 0 ? (double)r->counters[Metrics::LANES_ACTIVE_SORTED] / slots_sorted : 0)
+		<< ",\"lane_utilization_unsorted\":" 
+			<< (slots_unsorted > 0 ? (double)r->counters[Metrics::LANES_ACTIVE_UNSORTED] / slots_unsorted : 0);
+
+	o << ",\"neighbors\":[";
+	bool first = true;
+	for (int i = 0; i < r->size; i++)
+		if (d[i] || d[r->size + i] || d[2*r->size + i])
+		{
+			o << (first ? "" : ",") << "{\"rank\":" << i 
+				<< ",\"messages\":" << d[i] 
+				<< ",\"bytes\":" << d[r->size + i] 
+				<< ",\"rays\":" << d[2*r->size + i] << "}";
+			first = false;
+		}
+	o << "]";
+}
+
+static void
+write_frame(int frame, std::vector<SharedP>& reports)
+{
+	if (! out.is_open())
+	{
+		std::string fname = getenv("GXY_METRICS_FILE") ? getenv("GXY_METRICS_FILE") : "gxy_metrics.json";
+		out.open(fname.c_str(), std::fstream::out);
+		if (out.fail())
+		{
+			std::cerr << "ERROR: unable to open metrics file " << fname << std::endl;
+			return;
+		}
+
+		// Chrome's trace viewer accepts an unterminated array, so we never
+		// need to go back and close it
+
+		if (format == "chrome")
+			out << "[\n";
+	}
+
+	if (format == "chrome")
+	{
+		for (auto s : reports)
+		{
+			report *r = (report *)s->get();
+			double elapsed = r->t_end - r->t_start;
+
+			out << "{\"name\":\"frame " << frame << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":" << r->rank
+					<< ",\"tid\":0,\"ts\":" << (long)(r->t_start * 1000000.0) << ",\"dur\":" << (long)(elapsed * 1000000.0) 
+					<< ",\"args\":{";
+			write_fields(out, r);
+			out << "}},\n";
+
+			if (elapsed <= 0) elapsed = 1e-6;
+
+			out << "{\"name\":\"rate\",\"ph\":\"C\",\"pid\":" << r->rank << ",\"ts\":" << (long)(r->t_start * 1000000.0)
+					<< ",\"args\":{\"rays_per_sec\":" << (r->counters[Metrics::RAYS_TRACED] / elapsed)
+					<< ",\"samples_per_sec\":" << (r->counters[Metrics::SAMPLES] / elapsed) << "}},\n";
+
+			out << "{\"name\":\"queues\",\"ph\":\"C\",\"pid\":" << r->rank << ",\"ts\":" << (long)(r->t_start * 1000000.0)
+					<< ",\"args\":{\"ray_queue\":" << r->gauges[Metrics::RAYQ_DEPTH]
+					<< ",\"message_queue\":" << r->gauges[Metrics::MESSAGEQ_DEPTH]
+					<< ",\"pool_queue\":" << r->gauges[Metrics::POOL_QUEUE_DEPTH] << "}},\n";
+		}
+	}
+	else
+	{
+		long rays = 0, samples = 0, bytes = 0;
+		double t0 = 0, t1 = 0;
+
+		for (int i = 0; i < reports.size(); i++)
+		{
+			report *r = (report *)reports[i]->get();
+			rays    += r->counters[Metrics::RAYS_TRACED];
+			samples += r->counters[Metrics::SAMPLES];
+			bytes   += r->counters[Metrics::BYTES_SENT];
+			if (i == 0 || r->t_start < t0) t0 = r->t_start;
+			if (i == 0 || r->t_end > t1) t1 = r->t_end;
+		}
+
+		double elapsed = (t1 > t0) ? t1 - t0 : 1e-6;
+
+		out << "{\"frame\":" << frame
+				<< ",\"reporting\":" << reports.size()
+				<< ",\"elapsed\":" << elapsed
+				<< ",\"rays_traced\":" << rays
+				<< ",\"samples\":" << samples
+				<< ",\"bytes_sent\":" << bytes
+				<< ",\"rays_per_sec\":" << (rays / elapsed)
+				<< ",\"samples_per_sec\":" << (samples / elapsed)
+				<< ",\"ranks\":[";
+
+		for (int i = 0; i < reports.size(); i++)
+		{
+			out << (i ? ",{" : "{");
+			write_fields(out, (report *)reports[i]->get());
+			out << "}";
+		}
+
+		out << "]}\n";
+	}
+
+	out.flush();
+}
+
+bool
+Metrics::ReportMsg::Action(int sender)
+{
+	report *r = (report *)get();
+
+	pthread_mutex_lock(&metrics_lock);
+
+	pending[r->frame].push_back(contents);
+
+	if (pending[r->frame].size() == r->size)
+	{
+		// Anything older than a complete frame is never going to be completed; write
+		// what there is of it so it isn't silently lost
+
+		int frame = r->frame;
+		while (pending.begin()->first != frame)
+		{
+			write_frame(pending.begin()->first, pending.begin()->second);
+			pending.erase(pending.begin());
+		}
+
+		write_frame(frame, pending[frame]);
+		pending.erase(frame);
+	}
+
+	pthread_mutex_unlock(&metrics_lock);
+	return false;
+}
+
+} // namespace gxy
@@ -0,0 +1,184 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file Metrics.h 
+ * \brief lightweight per-frame performance counters, aggregated to rank 0
+ * \ingroup framework
+ */
+
+#include <atomic>
+#include <string>
+#include <time.h>
+
+#include "Work.h"
+
+namespace gxy
+{
+
+//! lightweight per-frame performance counters, aggregated to rank 0
+/*! \ingroup framework
+ *
+ * Metrics is always compiled in; when it is disabled every probe is a single
+ * relaxed load of a flag.   It is enabled at startup by setting GXY_METRICS 
+ * to `json` or `chrome` (the report format) and can be turned on and off at 
+ * runtime with Enable(), which broadcasts the change to every process.
+ *
+ * Each process accumulates counters for the current frame.   When the next
+ * frame starts (see BeginFrame) or metrics are turned off, each process ships
+ * the completed frame's counters to rank 0, which writes one record per frame
+ * once every process has reported.   Rank 0 writes to GXY_METRICS_FILE, or
+ * `gxy_metrics.json` if that is not set.
+ */
+class Metrics
+{
+public:
+  //! summed counts
+	enum Counter
+	{
+		RAYS_TRACED,				//!< rays passed through the tracer
+		SAMPLES,						//!< volume sample points taken by the tracer
+		RAYS_ORIGINATED,		//!< camera rays generated here
+		RAYS_SECONDARY,			//!< AO and shadow rays spawned here
+		RAYS_SENT,					//!< rays shipped to other processes
+		RAYS_RECEIVED,			//!< rays arriving from other processes
+		PIXELS_LOCAL,				//!< terminated rays deposited into a local Rendering
+		PIXELS_SENT,				//!< terminated rays shipped to the owning process
+		MESSAGES_SENT,			//!< MPI sends posted (a broadcast hop counts once per child)
+		BYTES_SENT,					//!< bytes in those sends
+		MESSAGES_RECEIVED,	//!< MPI messages received
+		BYTES_RECEIVED,			//!< bytes in those messages
+		SENDS_COMPLETED,		//!< sends whose MPI request completed (denominator for SEND_LATENCY)
+		RAYS_DROPPED_STALE,	//!< rays discarded untraced because their frame was superseded
+		RAYS_TRACED_STALE,	//!< rays traced for a frame that was superseded while they were traced
+		LANES_ACTIVE_SORTED,		//!< active SIMD lane-steps marching sorted ray lists
+		LANE_SLOTS_SORTED,			//!< available SIMD lane-steps marching sorted ray lists
+		LANES_ACTIVE_UNSORTED,	//!< active SIMD lane-steps marching unsorted ray lists
+		LANE_SLOTS_UNSORTED,		//!< available SIMD lane-steps marching unsorted ray lists
+		N_COUNTERS
+	};
+
+  //! summed durations, in microseconds
+	enum Timer
+	{
+		TRACE_TIME,				//!< thread time spent in the tracer
+		POOL_BUSY_TIME,		//!< thread time spent running ThreadPool tasks
+		SEND_LATENCY,			//!< time from posting an MPI send until its completion is observed
+		N_TIMERS
+	};
+
+  //! high-water marks
+	enum Gauge
+	{
+		RAYQ_DEPTH,							//!< ray lists waiting in the RayQManager
+		MESSAGEQ_DEPTH,					//!< messages waiting in the incoming message queue
+		POOL_QUEUE_DEPTH,				//!< tasks waiting in the ThreadPool
+		SEND_LATENCY_MAX,				//!< longest send latency, in microseconds
+		N_GAUGES
+	};
+
+	//! register Metrics' Work classes and pick up the GXY_METRICS environment settings
+	static void Register();
+
+	//! are metrics being collected?
+	static bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+
+	//! turn metrics collection on or off on every process
+	/*! \param on collect metrics?
+	 * \param format report format, "json" or "chrome"; empty leaves the format unchanged
+	 */
+	static void Enable(bool on, std::string format = "");
+
+	//! add n to a counter
+	static void Count(Counter c, long n)
+	{
+		if (Enabled()) counters[c].fetch_add(n, std::memory_order_relaxed);
+	}
+
+	//! add a duration (in seconds) to a timer
+	static void Time(Timer t, double seconds)
+	{
+		if (Enabled()) timers[t].fetch_add((long)(seconds * 1000000.0), std::memory_order_relaxed);
+	}
+
+	//! raise a gauge to v if v is larger than its current value
+	static void Peak(Gauge g, long v)
+	{
+		if (Enabled())
+		{
+			long cur = gauges[g].load(std::memory_order_relaxed);
+			while (v > cur && !gauges[g].compare_exchange_weak(cur, v, std::memory_order_relaxed));
+		}
+	}
+
+	//! record a send of the given size to process `dest`
+	static void SentTo(int dest, long bytes);
+
+	//! record n rays sent to process `dest`
+	static void RaysTo(int dest, long n);
+
+	//! record a completed trace of n rays taking s samples between times t0 and t1
+	static void Traced(long n, long s, double t0, double t1);
+
+	//! start a new frame, shipping the previous frame's counters to rank 0
+	/*! Called on every process in the same order (in response to a collective 
+	 * render message), so the internal frame sequence numbers agree across ranks.
+	 */
+	static void BeginFrame();
+
+	//! ship the current frame's counters to rank 0 without starting a new frame
+	static void Flush();
+
+	//! current time in seconds
+	static double Now()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
+	}
+
+private:
+	static std::atomic<bool> enabled;
+	static std::atomic<long> counters[N_COUNTERS];
+	static std::atomic<long> timers[N_TIMERS];
+	static std::atomic<long> gauges[N_GAUGES];
+
+	static void ship();
+
+	class EnableMsg : public Work
+	{
+		WORK_CLASS(EnableMsg, true);
+
+	public:
+		EnableMsg(bool on, std::string format);
+		bool CollectiveAction(MPI_Comm coll_comm, bool isRoot);
+	};
+
+	class ReportMsg : public Work
+	{
+		WORK_CLASS(ReportMsg, false);
+
+	public:
+		bool Action(int sender);
+	};
+};
+
+} // namespace gxy
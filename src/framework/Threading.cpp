@@ -20,23 +20,33 @@
 
 #include <fstream>
 #include <sstream>
+#include <dirent.h>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
 
 #include "Application.h"
 #include "Threading.h"
 #include "Events.h"
+#include "Metrics.h"
 
 using namespace std;
 
 namespace gxy
 {
 
-ThreadManager::TLS::TLS(int i, pthread_key_t k, std::string n, void *(*s)(void *), void *a) : index(i), key(k), name(n), start(s), arg(a)
+ThreadManager::TLS::TLS(int i, pthread_key_t k, std::string n, void *(*s)(void *), void *a, int nd) : index(i), node(nd), key(k), name(n), start(s), arg(a)
 {
 }
 
 ThreadManager::TLS::~TLS()
 {
-#if defined(GXY_EVENT_TRACKING)
+  if (events.is_empty())
+    return;
+
   int rank = GetTheApplication()->GetTheMessageManager()->GetRank();
   fstream fs;
   stringstream fname;
@@ -45,7 +55,6 @@ ThreadManager::TLS::~TLS()
 	fs << "thread name: " << name << "\n";
   events.DumpEvents(fs);
   fs.close();
-#endif
 }
 
 ThreadManager::ThreadManager()
@@ -53,28 +62,189 @@ ThreadManager::ThreadManager()
 	pthread_key_create(&thr_id_key, DTOR);
 	pthread_mutex_init(&lock, NULL);
   index = 0;
+
+	discover_topology();
+
+	binding = node_cpus.size() > 1;
+	if (getenv("GXY_BIND"))
+		binding = std::string(getenv("GXY_BIND")) != "none";
 }
 
-ThreadManager::~ThreadManager()
+#ifdef __linux__
+// parse a sysfs cpu list, eg. "0-3,8-11"
+
+static std::vector<int>
+parse_cpulist(std::string s)
 {
-#if defined(GXY_EVENT_TRACKING)
-  int rank = GetTheApplication()->GetTheMessageManager()->GetRank();
-  fstream fs;
-  stringstream fname;
-  fname << "gxy_events" << "_" << rank << "_unmanaged";
-  fs.open(fname.str().c_str(), fstream::out);
-  fs << "thread name: unmanaged\n";
-  events.DumpEvents(fs);
-  fs.close();
+	std::vector<int> cpus;
+	std::stringstream ss(s);
+	std::string range;
+	while (std::getline(ss, range, ','))
+	{
+		int a, b;
+		int n = sscanf(range.c_str(), "%d-%d", &a, &b);
+		if (n == 1) b = a;
+		if (n >= 1)
+			for (int i = a; i <= b; i++)
+				cpus.push_back(i);
+	}
+	return cpus;
+}
+#endif
+
+void
+ThreadManager::discover_topology()
+{
+	node_cpus.clear();
+	node_ids.clear();
+
+#ifdef __linux__
+	// Only CPUs this process may run on count - the MPI launcher may
+	// have restricted us to a subset of the node
+
+	cpu_set_t mask;
+	CPU_ZERO(&mask);
+	if (sched_getaffinity(0, sizeof(mask), &mask))
+		for (int i = 0; i < CPU_SETSIZE; i++)
+			CPU_SET(i, &mask);
+
+	DIR *dir = opendir("/sys/devices/system/node");
+	if (dir)
+	{
+		std::vector<int> ids;
+		struct dirent *e;
+		while ((e = readdir(dir)) != NULL)
+		{
+			int id;
+			if (sscanf(e->d_name, "node%d", &id) == 1)
+				ids.push_back(id);
+		}
+		closedir(dir);
+
+		std::sort(ids.begin(), ids.end());
+
+		for (auto id : ids)
+		{
+			std::stringstream fname;
+			fname << "/sys/devices/system/node/node" << id << "/cpulist";
+
+			std::ifstream in(fname.str());
+			std::string line;
+			if (! std::getline(in, line))
+				continue;
+
+			std::vector<int> cpus;
+			for (auto c : parse_cpulist(line))
+				if (c < CPU_SETSIZE && CPU_ISSET(c, &mask))
+					cpus.push_back(c);
+
+			if (cpus.size() > 0)
+			{
+				node_cpus.push_back(cpus);
+				node_ids.push_back(id);
+			}
+		}
+	}
+
+	if (node_cpus.size() == 0)
+	{
+		std::vector<int> cpus;
+		for (int i = 0; i < CPU_SETSIZE; i++)
+			if (CPU_ISSET(i, &mask))
+				cpus.push_back(i);
+		node_cpus.push_back(cpus);
+		node_ids.push_back(0);
+	}
+#else
+	std::vector<int> cpus;
+	int n = sysconf(_SC_NPROCESSORS_ONLN);
+	for (int i = 0; i < n; i++)
+		cpus.push_back(i);
+	node_cpus.push_back(cpus);
+	node_ids.push_back(0);
 #endif
+}
+
+int
+ThreadManager::number_of_cpus()
+{
+	int n = 0;
+	for (auto& cpus : node_cpus)
+		n += cpus.size();
+	return n;
+}
+
+bool
+ThreadManager::bind_to_node(int n)
+{
+#ifdef __linux__
+	if (! binding || n < 0 || n >= (int)node_cpus.size())
+		return false;
+
+	cpu_set_t mask;
+	CPU_ZERO(&mask);
+	for (auto c : node_cpus[n])
+		CPU_SET(c, &mask);
+
+	if (pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask))
+	{
+		std::cerr << "WARNING: unable to bind thread to NUMA node " << node_ids[n] << std::endl;
+		return false;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+void
+ThreadManager::interleave(void *ptr, size_t sz)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+	if (! binding || node_cpus.size() < 2 || ! ptr)
+		return;
+
+	// mbind wants whole pages; the partial pages at either end are left alone
+
+	long page = sysconf(_SC_PAGESIZE);
+	unsigned long start = ((unsigned long)ptr + page - 1) & ~(page - 1);
+	unsigned long end   = ((unsigned long)ptr + sz) & ~(page - 1);
+	if (end <= start)
+		return;
+
+	unsigned long nodemask[16] = {0};
+	for (auto id : node_ids)
+		if (id < (int)(16 * 8 * sizeof(unsigned long)))
+			nodemask[id / (8 * sizeof(unsigned long))] |= 1UL << (id % (8 * sizeof(unsigned long)));
+
+	const int MPOL_INTERLEAVE = 3;
+	if (syscall(SYS_mbind, start, end - start, MPOL_INTERLEAVE, nodemask, 16 * 8 * sizeof(unsigned long), 0))
+		std::cerr << "WARNING: unable to interleave memory across NUMA nodes" << std::endl;
+#endif
+}
+
+ThreadManager::~ThreadManager()
+{
+  if (! events.is_empty())
+  {
+    int rank = GetTheApplication()->GetTheMessageManager()->GetRank();
+    fstream fs;
+    stringstream fname;
+    fname << "gxy_events" << "_" << rank << "_unmanaged";
+    fs.open(fname.str().c_str(), fstream::out);
+    fs << "thread name: unmanaged\n";
+    events.DumpEvents(fs);
+    fs.close();
+  }
 	pthread_mutex_destroy(&lock);
 }
 
 int
-ThreadManager::create_thread(std::string n, pthread_t *tid, const pthread_attr_t *a, void *(*s) (void *), void *arg)
+ThreadManager::create_thread(std::string n, pthread_t *tid, const pthread_attr_t *a, void *(*s) (void *), void *arg, int node)
 {
 	pthread_mutex_lock(&lock);
-	TLS *tls = new TLS(index++, thr_id_key, n, s, arg);
+	TLS *tls = new TLS(index++, thr_id_key, n, s, arg, binding ? node : -1);
 	pthread_mutex_unlock(&lock);
 	return pthread_create(tid, a, START, (void *)tls);
 }
@@ -93,12 +263,20 @@ ThreadPool::ThreadPool(int n)
 	pthread_cond_init(&wait, NULL);
 	pthread_cond_init(&wait_for_done, NULL);
 
+	ThreadManager *tm = GetTheApplication()->GetTheThreadManager();
+	int nnodes = tm->number_of_nodes();
+
 	for (int i = 0; i < n; i++)
 	{
 		pthread_t t;
 		char name[256];
 		sprintf(name, "pool_%d", i);
-		if (GetTheApplication()->GetTheThreadManager()->create_thread(std::string(name), &t, NULL, thread, (void *)this))
+
+		// consecutive pool threads share a node
+
+		int node = (i * nnodes) / n;
+
+		if (tm->create_thread(std::string(name), &t, NULL, thread, (void *)this, node))
 		{
 			std::cerr << "error creating thread pool" << std::endl;
 			exit(1);
@@ -156,6 +334,8 @@ ThreadPool::thread(void *d)
 			double tWorkEnd = pool->gettime();
 			delete task;
 
+			Metrics::Time(Metrics::POOL_BUSY_TIME, tWorkEnd - tWorkStart);
+
 			pool->PoolEvent(FINISH);
 
 			pthread_mutex_lock(&pool->lock);
@@ -226,6 +406,8 @@ ThreadPool::AddTask(ThreadPoolTask *task)
 	l->push_back(task);
 	number_of_tasks ++;
 
+	Metrics::Peak(Metrics::POOL_QUEUE_DEPTH, number_of_tasks);
+
 	pthread_cond_signal(&wait);
 	pthread_mutex_unlock(&lock);
 
@@ -52,11 +52,12 @@ private:
 
   struct TLS
   {
-    TLS(int i, pthread_key_t k, std::string n, void *(*s)(void *), void *a);
+    TLS(int i, pthread_key_t k, std::string n, void *(*s)(void *), void *a, int nd);
     ~TLS();
 
     pthread_key_t key;
 		int 					index;
+		int           node;
     void*         (*start)(void *);
     void*         arg;
     long          tid;
@@ -71,9 +72,13 @@ private:
     TLS *tls = (TLS *)v;
     tls->tid = ((long)pthread_self() & 0xffff);
     pthread_setspecific(tls->key, (void *)tls);
+    if (tls->node >= 0)
+      GetTheApplication()->GetTheThreadManager()->bind_to_node(tls->node);
     return tls->start(tls->arg);
   }
 
+  void discover_topology();
+
   TLS *get_tls() { return (TLS *)pthread_getspecific(thr_id_key); }
 
   pthread_key_t thr_id_key;
@@ -82,6 +87,13 @@ private:
 
 	EventTracker events; // event tracker for main thread and other non-managed threads 
 
+	// CPUs available to this process, grouped by NUMA node.  node_ids holds 
+	// the system's id for each node
+
+	std::vector< std::vector<int> > node_cpus;
+	std::vector<int> node_ids;
+	bool binding;
+
 public:
   ThreadManager();
   ~ThreadManager();
@@ -103,6 +115,35 @@ public:
 			return &get_tls()->events;
 	}
 
+	//! Get the NUMA node the current thread is bound to, or -1 if its not bound
+  int get_node() { return get_tls() ? get_tls()->node : -1; }
+
+	//! return the number of NUMA nodes with CPUs available to this process
+	int number_of_nodes() { return node_cpus.size(); }
+
+	//! return the number of CPUs available to this process
+	int number_of_cpus();
+
+	//! return the CPUs available to this process on (logical) NUMA node `n`
+	const std::vector<int>& get_node_cpus(int n) { return node_cpus[n]; }
+
+	//! return whether managed threads are bound to NUMA nodes
+	/*! Binding is on by default when the CPUs available to this process span 
+	 * more than one NUMA node.  Setting GXY_BIND=none in the environment turns 
+	 * it off, for example when the MPI launcher does its own binding.
+	 */
+	bool is_binding() { return binding; }
+
+	//! bind the current thread to the CPUs of (logical) NUMA node `n`
+	bool bind_to_node(int n);
+
+	//! spread the pages of a newly allocated region round-robin across the NUMA nodes
+	/*! Used for data that is read by threads on every node, like Volume samples.  
+	 * It must be called before the region is first touched; it does nothing unless 
+	 * there is more than one node.
+	 */
+	void interleave(void *ptr, size_t sz);
+
   //! create a new thread. 
 	/*! Corresponds to pthread_create
    * \param name name assigned to current thread
@@ -110,8 +151,9 @@ public:
 	 * \param attr attributes for thread generation (see pthread_create)
 	 * \param start_routine thread routine (see pthread_create)
 	 * \param arg argument for thread routine (see pthread_create)
+	 * \param node if non-negative, the NUMA node the thread is bound to when binding is on
 	 */
-  int create_thread(std::string name, pthread_t *tid, const pthread_attr_t *attr, void *(*start_routine) (void *), void *arg);
+  int create_thread(std::string name, pthread_t *tid, const pthread_attr_t *attr, void *(*start_routine) (void *), void *arg, int node = -1);
 };
 
 class ThreadPool;
@@ -190,6 +232,10 @@ public:
 	enum PoolEventType { WAKE, START, FINISH };
 
 	//! construct a thread pool with `n` threads
+	/*! When the ThreadManager is binding threads, the pool threads are divided
+	 * evenly among the NUMA nodes, so that the RayLists and framebuffer updates
+	 * each allocates are first-touched in memory local to the socket that uses them.
+	 */
 	ThreadPool(int n);
 
 	//! destroy this thread pool
@@ -213,11 +259,20 @@ public:
 	//! add an event noting an event (wake, start, finish task)
 	void PoolEvent(PoolEventType e)
 	{
-		GetTheEventTracker()->Add(new PoolThreadEvent(e));
+		if (EventTracker::Enabled())
+			switch(e)
+			{
+				case WAKE:   GetTheEventTracker()->Add("pool thread wakeup"); break;
+				case START:  GetTheEventTracker()->Add("pool task", 'B'); break;
+				case FINISH: GetTheEventTracker()->Add("pool task", 'E'); break;
+			}
 	}
 
 	int GetNumberOfTasks() { return number_of_tasks; }
 
+	//! return the number of threads in the pool
+	int GetNumberOfThreads() { return nPoolThreads; }
+
 private:
 	std::vector<pthread_t> thread_ids;
 
@@ -238,29 +293,6 @@ private:
     clock_gettime(CLOCK_REALTIME, &ts);
     return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
   }
-
-  class PoolThreadEvent : public Event
-  {
-  public:
-    PoolThreadEvent(PoolEventType e) : pe(e) {}
-
-  protected:
-    void print(std::ostream& o)
-    {
-      Event::print(o);
-
-			switch(pe)
-			{
-				case WAKE:   o << "pool thread wakeup"; break;
-				case START:  o << "pool thread start task"; break;
-				case FINISH: o << "pool thread finish task"; break;
-			}
-    }
-
-  private:
-    PoolEventType pe;
-  };
-
 };
 
 } // namespace gxy
@@ -326,6 +326,32 @@ GuiClientServer::handle(string line, string& reply)
     if (! clientWindow)
       HANDLED_BUT_ERROR_RETURN("initWindow: window has not been initialized");
 
+    // If the window already has a Visualization with the same Vis elements on
+    // the same data, just update its parameters and ship the changes
+
+    if (clientWindow->visualization && clientWindow->visualization->UpdateFromJSON(doc["Visualization"]))
+    {
+      bool same_data = true;
+      for (int i = 0; same_data && i < clientWindow->visualization->GetNumberOfVis(); i++)
+      {
+        auto v = clientWindow->visualization->GetVis(i);
+
+        KeyedDataObjectP kdop = temporaries->Find(v->GetName());
+        if (! kdop)
+          kdop = globals->Find(v->GetName());
+
+        same_data = (kdop == v->GetTheData());
+      }
+
+      if (same_data)
+      {
+        if (! clientWindow->visualization->CommitChanges())
+          HANDLED_BUT_ERROR_RETURN("visualization: error committing changes");
+
+        HANDLED_OK;
+      }
+    }
+
     clientWindow->visualization  = Visualization::NewP();
     clientWindow->datasets       = Datasets::NewP();
 
@@ -79,6 +79,7 @@ RaycastSampler::Sample(rapidjson::Document& doc, KeyedDataObjectP scalarVolume)
 #endif
 
   sleep(1);
+  sampler->CollectSamples();
   result->Commit();
 
   ParticlesP p = Particles::Cast(result);
@@ -29,8 +29,12 @@ using namespace std;
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 
 #include "KeyedObject.h"
+#include "Threading.h"
 #include "SocketConnector.hpp"
 #include "Volume.h"
 
@@ -52,7 +56,14 @@ SocketConnector::Register()
 
 KEYED_OBJECT_CLASS_TYPE(SocketConnector)
 
-SocketConnector::~SocketConnector() {}
+SocketConnector::~SocketConnector()
+{
+  for (auto b : back_buffers)
+    free(b.second);
+
+  for (auto m : retired)
+    munmap(m.first, m.second);
+}
 
 void
 SocketConnector::initialize()
@@ -73,7 +84,7 @@ SocketConnector::findVariable(std::string name)
 int
 SocketConnector::serialSize()
 {
-  return super::serialSize() + 2*sizeof(int);
+  return super::serialSize() + 3*sizeof(int);
 }
 
 unsigned char *
@@ -87,6 +98,9 @@ SocketConnector::serialize(unsigned char *p)
   *(int *)p = wait_time;
   p += sizeof(int);
 
+  *(int *)p = shared_memory ? 1 : 0;
+  p += sizeof(int);
+
   return p;
 }
 
@@ -101,6 +115,9 @@ SocketConnector::deserialize(unsigned char *p)
   wait_time = *(int *)p;
   p += sizeof(int);
 
+  shared_memory = *(int *)p != 0;
+  p += sizeof(int);
+
   return p;
 }
 
@@ -137,12 +154,25 @@ SocketConnector::local_open(MPI_Comm c)
   sskt = vtkServerSocket::New();
   sskt->CreateServer(port + GetTheApplication()->GetRank()) ;
 
+  running = true;
+  GetTheApplication()->GetTheThreadManager()->create_thread(std::string("socketReceiver"), &socket_t, NULL, receiver_thread, (void *)this);
+
   return false;
 }
 
 bool
 SocketConnector::local_close(MPI_Comm c)
 {
+  if (running)
+  {
+    pthread_mutex_lock(&rlock);
+    running = false;
+    pthread_cond_broadcast(&rcond);
+    pthread_mutex_unlock(&rlock);
+
+    pthread_join(socket_t, NULL);
+  }
+
   if (sskt)
   {
     sskt->CloseSocket();
@@ -162,43 +192,204 @@ SocketConnector::Accept(VolumeP var)
   msg.Broadcast(true, false);
 }
 
+void
+SocketConnector::commit_datasets()
+{
+  swapped.clear();
+
+  ConnectionMsg msg(this, ConnectionMsg::Swap);
+  msg.Broadcast(true, true);
+
+  for (auto v : swapped)
+    v->Commit();
+
+  swapped.clear();
+}
+
 bool SocketConnector::local_accept(MPI_Comm c, VolumeP volume)
 {
-  vtkClientSocket *cskt = sskt->WaitForConnection(wait_time);
+  // Just queue it; the receiver thread picks up the connection so the
+  // message loop (and rendering) can carry on while the data streams in
 
-  int allflag, flag = cskt == NULL  ? 0 : 1;
-  MPI_Allreduce(&flag, &allflag, 1, MPI_INT, MPI_MIN, c);
+  pthread_mutex_lock(&rlock);
+  pending.push_back({volume, NULL, 0, false});
+  pthread_cond_broadcast(&rcond);
+  pthread_mutex_unlock(&rlock);
 
-  if (allflag == 0)
-    return false;
+  return false;
+}
 
-  float min, max;
-  int point_count;
+bool SocketConnector::local_swap(MPI_Comm c)
+{
+  pthread_mutex_lock(&rlock);
 
-  int i,j,k;
-  volume->get_ghosted_local_counts(i, j, k);
+  while (pending.size() > 0 || receiving)
+    pthread_cond_wait(&rcond, &rlock);
 
-  int sz = i*j*k * (volume->isFloat() ? sizeof(float) : sizeof(unsigned char)) * volume->get_number_of_components();
+  std::vector<request> ready;
+  ready.swap(received);
 
-  if (! cskt->Receive(volume->get_samples(), sz, 1))
-  {
-    std::cerr << "error... unable to read time step\n";
-    exit(0);
-  }
+  pthread_mutex_unlock(&rlock);
+
+  // Every process queued the same accepts, so if any of them failed
+  // the time step is incomplete and nobody swaps
+
+  int allflag, flag = 1;
+  for (auto& r : ready)
+    if (! r.ok) flag = 0;
+
+  MPI_Allreduce(&flag, &allflag, 1, MPI_INT, MPI_MIN, c);
+
+  pthread_mutex_lock(&rlock);
 
-  int one = 1;
-  if (! cskt->Send(&one, sizeof(one)))
+  // Mappings retired by the previous swap have now been out of use for a
+  // whole time step
+
+  for (auto m : retired)
+    munmap(m.first, m.second);
+  retired.clear();
+
+  for (auto& r : ready)
   {
-    std::cerr << "error... sending ack\n";
-    exit(0);
+    if (allflag)
+    {
+      // The retired samples array becomes the volume's back buffer.  It
+      // isn't written again until the next time step is accepted
+
+      size_t old_mapped = r.volume->get_mapped_size();
+      unsigned char *old = r.volume->swap_samples(r.buffer, r.mapped);
+
+      if (old_mapped)
+        retired.push_back(std::pair<unsigned char *, size_t>(old, old_mapped));
+      else if (old)
+      {
+        if (back_buffers.find(r.volume->getkey()) == back_buffers.end())
+          back_buffers[r.volume->getkey()] = old;
+        else
+          free(old);
+      }
+
+      if (GetTheApplication()->GetRank() == 0)
+        swapped.push_back(r.volume);
+    }
+    else if (r.mapped)
+      munmap(r.buffer, r.mapped);
+    else if (r.buffer)
+      back_buffers[r.volume->getkey()] = r.buffer;
   }
 
-  cskt->CloseSocket();
-  cskt->Delete();
+  pthread_mutex_unlock(&rlock);
+
+  if (! allflag && GetTheApplication()->GetRank() == 0)
+    std::cerr << "SocketConnector: incomplete time step discarded\n";
 
   return false;
 }
 
+void *
+SocketConnector::receiver_thread(void *d)
+{
+  ((SocketConnector *)d)->receive_loop();
+  pthread_exit(NULL);
+  return NULL;
+}
+
+void
+SocketConnector::receive_loop()
+{
+  pthread_mutex_lock(&rlock);
+
+  while (true)
+  {
+    while (running && pending.size() == 0)
+      pthread_cond_wait(&rcond, &rlock);
+
+    if (! running)
+      break;
+
+    request r = pending.front();
+    pending.pop_front();
+    receiving = true;
+
+    int i,j,k;
+    r.volume->get_ghosted_local_counts(i, j, k);
+
+    size_t sz = size_t(i*j*k) * (r.volume->isFloat() ? sizeof(float) : sizeof(unsigned char)) * r.volume->get_number_of_components();
+
+    if (! shared_memory)
+    {
+      auto b = back_buffers.find(r.volume->getkey());
+      if (b != back_buffers.end())
+      {
+        r.buffer = b->second;
+        back_buffers.erase(b);
+      }
+      else
+        r.buffer = (unsigned char *)malloc(sz);
+    }
+
+    pthread_mutex_unlock(&rlock);
+
+    vtkClientSocket *cskt = sskt->WaitForConnection(wait_time);
+
+    if (cskt)
+    {
+      if (shared_memory)
+      {
+        // Only the descriptor comes over the socket.  The mapping is private
+        // so the producer can unlink the object as soon as we've acked
+
+        ShmDescriptor desc;
+        if (cskt->Receive(&desc, sizeof(desc), 1))
+        {
+          desc.name[sizeof(desc.name)-1] = 0;
+
+          int fd = shm_open(desc.name, O_RDONLY, 0);
+          if (fd < 0 || size_t(desc.size) != sz)
+            std::cerr << "error... unable to open shared time step " << desc.name << "\n";
+          else
+          {
+            void *ptr = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED)
+            {
+              r.buffer = (unsigned char *)ptr;
+              r.mapped = sz;
+              r.ok = true;
+            }
+            else
+              std::cerr << "error... unable to map shared time step " << desc.name << "\n";
+          }
+
+          if (fd >= 0) close(fd);
+        }
+        else
+          std::cerr << "error... unable to read shared memory descriptor\n";
+      }
+      else
+      {
+        r.ok = cskt->Receive(r.buffer, sz, 1);
+        if (! r.ok)
+          std::cerr << "error... unable to read time step\n";
+      }
+
+      int one = 1;
+      if (! cskt->Send(&one, sizeof(one)))
+        std::cerr << "error... sending ack\n";
+
+      cskt->CloseSocket();
+      cskt->Delete();
+    }
+
+    pthread_mutex_lock(&rlock);
+
+    received.push_back(r);
+    receiving = false;
+    pthread_cond_broadcast(&rcond);
+  }
+
+  pthread_mutex_unlock(&rlock);
+}
+
 SocketConnector::ConnectionMsg::ConnectionMsg(SocketConnector* s, VolumeP v, todo t) : ConnectionMsg(2*sizeof(Key) + sizeof(todo))
 {
   unsigned char *p = contents->get();
@@ -258,6 +449,10 @@ bool SocketConnector::ConnectionMsg::CollectiveAction(MPI_Comm comm, bool is_roo
       r = c->local_accept(comm, v);
       s = "accept";
       break;
+    case Swap:
+      r = c->local_swap(comm);
+      s = "swap";
+      break;
   }
 
   /*
@@ -30,7 +30,11 @@
 #include <sstream>
 
 #include <string.h>
+#include <stdint.h>
 #include <pthread.h>
+#include <deque>
+#include <map>
+#include <vector>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -62,6 +66,7 @@ class SocketConnector : public KeyedObject
   {
     void Wait()
     {
+      pthread_mutex_lock(&lock);
       while(busy)
         pthread_cond_wait(&cond, &lock);
       pthread_mutex_unlock(&lock);
@@ -73,6 +78,13 @@ class SocketConnector : public KeyedObject
   };
 
 public:
+  //! sent over the socket in place of the time step when the producer shares memory
+  struct ShmDescriptor
+  {
+    char    name[256];   // POSIX shared memory object holding the samples
+    int64_t size;        // number of bytes of samples in it
+  };
+
   virtual ~SocketConnector();
   virtual void initialize();
 
@@ -94,12 +106,22 @@ public:
   void set_wait(int w) { wait_time = w; }
   int get_wait() { return wait_time; }
 
+  //! if set, producers publish each time step in shared memory and send only a ShmDescriptor
+  void set_shared_memory(bool s) { shared_memory = s; }
+  bool get_shared_memory() { return shared_memory; }
+
   virtual int serialSize(); 
   virtual unsigned char *serialize(unsigned char *); 
   virtual unsigned char *deserialize(unsigned char *); 
 
   int getLocalPort() { return local_port; }
 
+  //! swap the time step received in the background into its volumes and commit them
+  /*! Accept only queues a volume for the per-process receiver thread, which reads the
+   * time step into a back buffer while rendering continues on the current one.   This
+   * waits for the outstanding receives to finish everywhere, then swaps the back buffers
+   * in - so the caller decides where the frame boundary lies.
+   */
   void commit_datasets();
 
 protected:
@@ -109,8 +131,32 @@ protected:
   bool local_open(MPI_Comm c);
   bool local_close(MPI_Comm c);
   bool local_accept(MPI_Comm c, VolumeP v);
+  bool local_swap(MPI_Comm c);
+
+  static void *receiver_thread(void *);
+  void receive_loop();
+
+  struct request
+  {
+    VolumeP volume;
+    unsigned char *buffer;
+    size_t mapped;              // size of buffer if it is a shared memory mapping
+    bool ok;
+  };
+
+  pthread_mutex_t rlock = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t rcond = PTHREAD_COND_INITIALIZER;
+
+  std::deque<request> pending;                  // accepted, not yet received
+  std::vector<request> received;                // received, waiting to be swapped in
+  bool receiving = false;                       // receiver thread is working on a request
+  bool running = false;                         // receiver thread should keep going
+  std::map<Key, unsigned char *> back_buffers;  // spare samples arrays, by volume key
+  std::vector<VolumeP> swapped;                 // volumes updated by the last swap (root only)
+  std::vector<std::pair<unsigned char *, size_t>> retired;  // mappings swapped out by the last swap
 
   int wait_time = 100000;  // msec
+  bool shared_memory = false;
 
   std::map<std::string, Volume*> variables;   // local partition
 
@@ -124,7 +170,7 @@ protected:
   class ConnectionMsg : public Work
   {
   public:
-    enum todo {Open, Close, Accept};
+    enum todo {Open, Close, Accept, Swap};
 
     ConnectionMsg(SocketConnector* s, todo t);
     ConnectionMsg(SocketConnector* s, VolumeP v, todo t);
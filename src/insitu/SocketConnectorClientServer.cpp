@@ -117,6 +117,11 @@ SocketConnectorClientServer::handle(string line, string& reply)
       if (! theDatasets->Find(a->first))
         theDatasets->Insert(a->first, a->second);
 
+    // Co-located producers can hand over time steps in shared memory
+
+    if (json.HasMember("shared memory"))
+      connector->set_shared_memory(json["shared memory"].GetBool());
+
     connector->set_wait(timeout * 1000);
     connector->Commit();
 
@@ -134,8 +139,9 @@ SocketConnectorClientServer::handle(string line, string& reply)
 
     if (connector)
     {
+      // The volume is committed when the time step is swapped in
+
       connector->Accept(variables[arg]);
-      variables[arg]->Commit();
       reply = "ok";
     }
     else
@@ -145,7 +151,7 @@ SocketConnectorClientServer::handle(string line, string& reply)
   } else if (cmd == "commit;") {
     if (connector)
     {
-      //connector->commit_datasets();
+      connector->commit_datasets();
       reply = "ok";
     }
     else
@@ -22,11 +22,45 @@
 #include "SocketHandler.h"
 #include "Datasets.h"
 
+#include <deque>
+#include <vector>
+#include <sstream>
+
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
 namespace gxy
 {
 
+/*! A ServerClientConnection reads commands from a client's control socket and
+ * hands them, in order, to a worker thread that runs them through the loaded
+ * MultiServerHandlers.   Replies go back on the control socket as they complete.
+ *
+ * Plain commands get a plain reply, so a client can use CSendRecv as before.
+ * A command sent as `async <id> <command>` gets no immediate reply; its reply
+ * comes back later as `async <id> <reply>`, so a client can pipeline a burst of
+ * commands rather than waiting out each round trip.   `batch c0; c1; ...` runs
+ * the commands in turn, stopping at the first error, and replies with `ok` or 
+ * `error` followed by a JSON array of the individual replies.   Semicolons 
+ * inside JSON objects, arrays or strings do not split the batch, and empty 
+ * commands are skipped.   Commands queued behind a `quit` are dropped.
+ */
 class ServerClientConnection : public SocketHandler
 {
+  struct command
+  {
+    int id;               // async request id, or -1 for a synchronous command
+    std::string line;
+  };
+
+  struct result
+  {
+    int id;
+    std::string reply;
+    bool quit;
+  };
+
 public:
   static void *
   thread(void *d)
@@ -36,8 +70,20 @@ public:
     return NULL;
   }
     
+  static void *
+  worker_thread(void *d)
+  {
+    ServerClientConnection *client_connection = (ServerClientConnection *)d;
+    client_connection->work();
+    return NULL;
+  }
+    
   ServerClientConnection(int cfd, int dfd, int efd) : SocketHandler(cfd, dfd, efd)
   {
+    if (pipe(wakeup))
+      std::cerr << "error creating client handler wakeup pipe";
+    fcntl(wakeup[0], F_SETFL, O_NONBLOCK);
+
     if (pthread_create(&tid, NULL, ServerClientConnection::thread, (void *)this))
       std::cerr << "error starting client handler thread";
   }
@@ -45,8 +91,6 @@ public:
   void
   run()
   {
-    std::vector<MultiServerHandler*> handlers;
-
     DatasetsP theDatasets = Datasets::Cast(MultiServer::Get()->GetGlobal("global datasets"));
     if (! theDatasets)
     {
@@ -54,78 +98,236 @@ public:
       MultiServer::Get()->SetGlobal("global datasets", theDatasets);
     }
 
+    if (pthread_create(&worker_tid, NULL, ServerClientConnection::worker_thread, (void *)this))
+      std::cerr << "error starting client worker thread";
+
     bool client_done = false;
     while (! client_done)
     {
-      std::string line, reply;
+      if (CWaitOrWakeup(wakeup[0]))
+      {
+        std::string line;
+        if (! CRecv(line))
+          break;
+
+        std::stringstream ss(line);
+
+        std::string cmd;
+        ss >> cmd;
+
+        if (cmd == "async")
+        {
+          int id;
+          std::string rest;
+          ss >> id;
+          std::getline(ss, rest);
+          enqueue({id, rest.erase(0, rest.find_first_not_of(" \t"))});
+        }
+        else
+          enqueue({-1, line});
+      }
+      else
+      {
+        char buf[64];
+        while (read(wakeup[0], buf, sizeof(buf)) > 0);
+      }
+
+      // Send whatever has completed
+
+      pthread_mutex_lock(&lock);
+      std::deque<result> done;
+      done.swap(results);
+      pthread_mutex_unlock(&lock);
+
+      for (auto& r : done)
+      {
+        std::string reply = (r.id == -1) ? r.reply : (std::string("async ") + std::to_string(r.id) + " " + r.reply);
+        CSend(reply.c_str(), reply.length()+1);
+        if (r.quit) client_done = true;
+      }
+    }
+
+    enqueue({-2, ""});
+    pthread_join(worker_tid, NULL);
+
+    close(wakeup[0]);
+    close(wakeup[1]);
+  }
+
+  void
+  work()
+  {
+    while (true)
+    {
+      pthread_mutex_lock(&lock);
+      while (commands.empty())
+        pthread_cond_wait(&cond, &lock);
+
+      command c = commands.front();
+      commands.pop_front();
+      pthread_mutex_unlock(&lock);
 
-      if (! CRecv(line))
+      if (c.id == -2)
         break;
 
-      std::stringstream ss(line);
+      result r;
+      r.id = c.id;
+      r.quit = execute(c.line, r.reply);
+
+      // Once the client has quit, nothing queued behind the quit is run
+
+      pthread_mutex_lock(&lock);
+      results.push_back(r);
+      if (r.quit)
+        commands.clear();
+      pthread_mutex_unlock(&lock);
+
+      if (write(wakeup[1], "x", 1) < 0)
+        std::cerr << "error writing client handler wakeup pipe";
+
+      if (r.quit)
+        break;
+    }
 
-      std::string cmd;
-      ss >> cmd;
-      
-      if (cmd == "load")
+    for (auto handler : handlers)
+      delete handler;
+  }
+
+private:
+  void
+  enqueue(command c)
+  {
+    pthread_mutex_lock(&lock);
+    commands.push_back(c);
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+  }
+
+  // Find the ';' ending the batch segment that starts at p, ignoring any
+  // inside JSON objects, arrays or strings.  Returns npos if there is none.
+
+  static size_t
+  end_of_segment(const std::string& s, size_t p)
+  {
+    int depth = 0;
+    bool quoted = false;
+    for (size_t i = p; i < s.size(); i++)
+    {
+      char c = s[i];
+      if (quoted)
       {
-        std::string libname;
-        ss >> libname;
+        if (c == '\\') i++;
+        else if (c == '"') quoted = false;
+      }
+      else if (c == '"') quoted = true;
+      else if (c == '{' || c == '[') depth++;
+      else if ((c == '}' || c == ']') && depth > 0) depth--;
+      else if (c == ';' && depth == 0) return i;
+    }
+    return std::string::npos;
+  }
+
+  // Run a single command; returns true if the client asked to quit
+
+  bool
+  execute(std::string line, std::string& reply)
+  {
+    std::stringstream ss(line);
 
-        std::cerr << line << "\n";
+    std::string cmd;
+    ss >> cmd;
+    
+    if (cmd == "load")
+    {
+      std::string libname;
+      ss >> libname;
+
+      std::cerr << line << "\n";
 
-        DynamicLibraryP dlp = MultiServer::Get()->getTheDynamicLibraryManager()->Load(libname);
-        if (! dlp)
-          reply = std::string("error loading ") + libname;
+      DynamicLibraryP dlp = MultiServer::Get()->getTheDynamicLibraryManager()->Load(libname);
+      if (! dlp)
+        reply = std::string("error loading ") + libname;
+      else
+      {
+        MultiServerHandler::new_handler new_handler = (MultiServerHandler::new_handler)dlp->GetSym("new_handler");
+        if (! new_handler)
+          reply = std::string("error retrieving new_handler from ") + libname;
         else
         {
-          MultiServerHandler::new_handler new_handler = (MultiServerHandler::new_handler)dlp->GetSym("new_handler");
-          if (! new_handler)
-            reply = std::string("error retrieving new_handler from ") + libname;
-          else
-          {
-            handlers.push_back(new_handler(this));
-            reply = "ok";
-          }
+          handlers.push_back(new_handler(this));
+          reply = "ok";
         }
       }
-      else if (cmd == "quit")
-      {
-        client_done = true;
-        reply = "ok";
-      }
-      else if (cmd == "clear") {
-        MultiServer::Get()->ClearGlobals();
-        reply = "ok";
-      }
-      else
+    }
+    else if (cmd == "quit")
+    {
+      reply = "ok";
+      return true;
+    }
+    else if (cmd == "clear") {
+      MultiServer::Get()->ClearGlobals();
+      reply = "ok";
+    }
+    else if (cmd == "batch")
+    {
+      std::string rest;
+      std::getline(ss, rest);
+
+      rapidjson::StringBuffer strbuf;
+      rapidjson::Writer<rapidjson::StringBuffer> writer(strbuf);
+
+      bool ok = true, quit = false;
+
+      writer.StartArray();
+      for (size_t p = 0, n; ok && ! quit && p < rest.size(); p = (n == std::string::npos) ? rest.size() : n+1)
       {
-        reply = std::string("no matches for ") + line;
-
-        bool found = false;
-        for (auto handler : handlers)
-          if (handler->handle(line, reply))
-          {
-            found = true;
-            break;
-          }
-
-        if (! found) 
-          reply = std::string("unrecognized: ") + line;
+        n = end_of_segment(rest, p);
+        std::string sub = rest.substr(p, (n == std::string::npos) ? n : n-p);
+        sub.erase(0, sub.find_first_not_of(" \t\n"));
+        sub.erase(sub.find_last_not_of(" \t\n") + 1);
+        if (sub.size() == 0)
+          continue;
+
+        std::string r;
+        quit = execute(sub, r);
+        ok = r.substr(0, 5) != "error";
+        writer.String(r.c_str());
       }
+      writer.EndArray();
 
-      CSend(reply.c_str(), reply.length()+1);
+      reply = std::string(ok ? "ok " : "error ") + strbuf.GetString();
+      return quit;
     }
+    else
+    {
+      reply = std::string("no matches for ") + line;
 
-    // for (auto it = handlers.begin(); it != handlers.end(); it++)
-      // delete *it;
+      bool found = false;
+      for (auto handler : handlers)
+        if (handler->handle(line, reply))
+        {
+          found = true;
+          break;
+        }
 
-    for (auto handler : handlers)
-      delete handler;
+      if (! found) 
+        reply = std::string("unrecognized: ") + line;
+    }
+
+    return false;
   }
 
-private:
   pthread_t tid;
+  pthread_t worker_tid;
+
+  int wakeup[2];                                  // worker pokes the connection thread when a reply is ready
+
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+  std::deque<command> commands;                   // waiting for the worker
+  std::deque<result> results;                     // waiting to be sent
+
+  std::vector<MultiServerHandler*> handlers;      // touched only by the worker
 };
 
 }
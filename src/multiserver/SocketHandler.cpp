@@ -264,6 +264,20 @@ SocketHandler::Wait(int fd, float sec)
   return select(fd+1, &fds, NULL, NULL, &tv) != 0;
 }
 
+bool
+SocketHandler::Wait(int fd, int other_fd)
+{
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(fd, &fds);
+  FD_SET(other_fd, &fds);
+
+  if (select(((fd > other_fd) ? fd : other_fd) + 1, &fds, NULL, NULL, NULL) < 0)
+    return false;
+
+  return FD_ISSET(fd, &fds);
+}
+
 void
 SocketHandler::Disconnect()
 {
@@ -112,6 +112,11 @@ public:
   //! \param sec max time to wait
   bool CWait(float sec) { bool b = Wait(fds[1], sec); return b; }
 
+  //! Wait until there's input on either the control socket or another file descriptor (eg. a wakeup pipe)
+  //! \param other_fd the other descriptor
+  //! \return true if the control socket is readable
+  bool CWaitOrWakeup(int other_fd) { bool b = Wait(fds[1], other_fd); return b; }
+
   //! Atomically send a message and receive a reply using the control socket
   bool CSendRecv(std::string& s)
   {
@@ -289,6 +294,7 @@ private:
     return true;
   }
   bool Wait(int fd, float sec);
+  bool Wait(int fd, int other_fd);
 
   int connect_fd(struct sockaddr*);
 
@@ -32,6 +32,8 @@ using namespace std;
 
 using namespace rapidjson;
 
+#include "Events.h"
+#include "Metrics.h"
 #include "ViewerClientServer.h"
 
 using namespace gxy;
@@ -59,6 +61,25 @@ ViewerClientServer::init()
   ServerRendering::RegisterClass();
 }
 
+bool
+ViewerClientServer::update_visualization(Value& v)
+{
+  if (! visualization->UpdateFromJSON(v))
+    return false;
+
+  // Same Vis elements by name, but the datasets may have been reloaded
+  // under those names since; if so a full commit is needed after all
+
+  for (int i = 0; i < visualization->GetNumberOfVis(); i++)
+  {
+    VisP vis = visualization->GetVis(i);
+    if (! vis->GetTheData() || datasets->FindKey(vis->GetName()) != vis->GetTheData()->getkey())
+      return false;
+  }
+
+  return true;
+}
+
 bool
 ViewerClientServer::handle(string line, string& reply)
 {
@@ -114,6 +135,47 @@ ViewerClientServer::handle(string line, string& reply)
     }
   }
 
+  else if (cmd == "metrics")
+  {
+    // metrics [on | off | json | chrome] - json and chrome turn metrics on
+    // and select the report format written by rank 0
+
+    std::string arg;
+    ss >> arg;
+    if (ss.fail() || arg == "on")
+      Metrics::Enable(true);
+    else if (arg == "off")
+      Metrics::Enable(false);
+    else if (arg == "json" || arg == "chrome")
+      Metrics::Enable(true, arg);
+    else
+    {
+      reply = "error arg to metrics must be on, off, json or chrome";
+      return true;
+    }
+
+    reply = "ok";
+    return true;
+  }
+
+  else if (cmd == "events")
+  {
+    std::string onoff;
+    ss >> onoff;
+    if (ss.fail() || onoff == "on")
+      EventTracker::EnableAll(true);
+    else if (onoff == "off")
+      EventTracker::EnableAll(false);
+    else
+    {
+      reply = "error arg to events must be on or off";
+      return true;
+    }
+
+    reply = "ok";
+    return true;
+  }
+
   else if (cmd == "commit")
   {
     Commit();
@@ -152,7 +214,15 @@ ViewerClientServer::handle(string line, string& reply)
       return true;
     }
 
-    if (doc.HasMember("Visualization"))
+    if (doc.HasMember("Visualization") && update_visualization(doc["Visualization"]))
+    {
+      if (! GetTheVisualization()->CommitChanges())
+      {
+        reply = "error committing visualization changes from json command";
+        return true;
+      }
+    }
+    else if (doc.HasMember("Visualization"))
     {
       GetTheVisualization()->Clear();
 
@@ -28,6 +28,8 @@
 #include "MultiServerHandler.h"
 #include "ServerRendering.h"
 
+#include "rapidjson/document.h"
+
 namespace gxy
 {
 
@@ -101,6 +103,9 @@ public:
   }
 
 private:
+  //! update the current Visualization in place if the new specification only changes parameters
+  bool update_visualization(rapidjson::Value&);
+
   bool first;
 
   DatasetsP        datasets;
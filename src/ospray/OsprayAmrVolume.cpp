@@ -0,0 +1,111 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#include <cmath>
+#include <vector>
+
+#include "OsprayAmrVolume.h"
+
+using namespace gxy;
+
+// Layout of the elements of OSPRay's brickInfo array.   The box is in
+// cells of the brick's own level; cellWidth is the size of those cells
+// in units of level 0 cells.
+
+struct AmrBrickInfo
+{
+  osp::vec3i lower, upper;
+  int level;
+  float cellWidth;
+};
+
+OsprayAmrVolume::OsprayAmrVolume(AmrVolumeP v)
+{
+  OSPVolume ospv = ospNewVolume("amr_volume");
+
+  int nGrids = v->get_number_of_grids();
+
+  vec3f origin0, spacing0; vec3i counts0; float *samples0;
+  v->get_grid(0, origin0, spacing0, counts0, samples0);
+
+  // OSPRay AMR data is cell-centered while our grids carry point samples,
+  // so each point is taken as the center of a cell of the dual grid.   This
+  // is exact on level 0; finer bricks are placed to the nearest fine cell.
+
+  osp::vec3f gridOrigin, gridSpacing;
+  gridOrigin.x = origin0.x - 0.5*spacing0.x;
+  gridOrigin.y = origin0.y - 0.5*spacing0.y;
+  gridOrigin.z = origin0.z - 0.5*spacing0.z;
+  gridSpacing.x = spacing0.x;
+  gridSpacing.y = spacing0.y;
+  gridSpacing.z = spacing0.z;
+
+  std::vector<AmrBrickInfo> info(nGrids);
+  std::vector<OSPData> bricks(nGrids);
+
+  for (int i = 0; i < nGrids; i++)
+  {
+    vec3f origin, spacing; vec3i counts; float *samples;
+    v->get_grid(i, origin, spacing, counts, samples);
+
+    AmrBrickInfo& b = info[i];
+    b.level = v->get_grid_level(i);
+    b.cellWidth = spacing.x / spacing0.x;
+
+    b.lower.x = (int)roundf((origin.x - 0.5*spacing.x - gridOrigin.x) / spacing.x);
+    b.lower.y = (int)roundf((origin.y - 0.5*spacing.y - gridOrigin.y) / spacing.y);
+    b.lower.z = (int)roundf((origin.z - 0.5*spacing.z - gridOrigin.z) / spacing.z);
+    b.upper.x = b.lower.x + counts.x;
+    b.upper.y = b.lower.y + counts.y;
+    b.upper.z = b.lower.z + counts.z;
+
+    bricks[i] = ospNewData((counts.x+1)*(counts.y+1)*(counts.z+1), OSP_FLOAT, (void *)samples, OSP_DATA_SHARED_BUFFER);
+    ospCommit(bricks[i]);
+  }
+
+  OSPData brickInfo = ospNewData(nGrids * sizeof(AmrBrickInfo), OSP_RAW, (void *)info.data());
+  ospCommit(brickInfo);
+
+  OSPData brickData = ospNewData(nGrids, OSP_DATA, (void *)bricks.data());
+  ospCommit(brickData);
+
+  ospSetObject(ospv, "brickInfo", brickInfo);
+  ospSetObject(ospv, "brickData", brickData);
+  ospSetVec3f(ospv, "gridOrigin", gridOrigin);
+  ospSetVec3f(ospv, "gridSpacing", gridSpacing);
+  ospSetString(ospv, "voxelType", "float");
+  ospSetString(ospv, "amrMethod", "finest");
+  ospSetf(ospv, "samplingRate", 1.0);
+
+  ospSetObject(ospv, "transferFunction", ospNewTransferFunction("piecewise_linear"));
+
+  ospCommit(ospv);
+
+  ospRelease(brickInfo);
+  ospRelease(brickData);
+  for (auto b : bricks)
+    ospRelease(b);
+
+  theOSPRayObject = ospv;
+}
+
+OsprayAmrVolume::~OsprayAmrVolume()
+{
+}
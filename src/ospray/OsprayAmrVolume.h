@@ -0,0 +1,56 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file OsprayAmrVolume.h 
+ * \brief translation class for Galaxy AmrVolume to OSPRay amr_volume
+ * \ingroup render
+ */
+
+#include "Application.h"
+#include "AmrVolume.h"
+#include "OsprayObject.h"
+
+namespace gxy
+{
+
+OBJECT_POINTER_TYPES(OsprayAmrVolume)
+
+//! translation class for Galaxy AmrVolume to OSPRay amr_volume
+/*! The grids of the AmrVolume are shared with OSPRay as bricks, so the 
+ * volume marching loop samples the hierarchy directly through OSPRay's 
+ * own AMR accelerator rather than through a resampled uniform grid.
+ * \ingroup render 
+ * \sa OsprayObject, OsprayVolume
+ */
+class OsprayAmrVolume : public OsprayObject
+{
+  GALAXY_OBJECT(OsprayAmrVolume)
+
+public:
+  static OsprayAmrVolumeP NewP(AmrVolumeP p) { return OsprayAmrVolume::Cast(std::shared_ptr<OsprayAmrVolume>(new OsprayAmrVolume(p))); }
+  ~OsprayAmrVolume();
+
+private:
+  OsprayAmrVolume(AmrVolumeP);
+};
+
+}
@@ -117,7 +117,13 @@ Camera::LoadCamerasFromJSON(Value& v, vector<CameraP>& cameras)
 bool 
 Camera::LoadFromPVCC(const char *filename)
 {
+  // Read into temporaries so a bad file leaves the camera as it was
+
+  float e[3] = {eye[0], eye[1], eye[2]};
+  float u[3] = {up[0], up[1], up[2]};
+  float a = aov;
   float center[3];
+  bool have_eye = false, have_center = false;
   pt::ptree tree;
 
   try {
@@ -140,28 +146,56 @@ Camera::LoadFromPVCC(const char *filename)
           }
         }
         if (propertyName == "CameraPosition")
+        {
           for (int i = 0; i < 3; i++)
-            eye[i] = values[i];
+            e[i] = values[i];
+          have_eye = true;
+        }
         else if (propertyName == "CameraFocalPoint")
+        {
           for (int i = 0; i < 3; i++)
             center[i] = values[i];
+          have_center = true;
+        }
         else if (propertyName == "CameraViewUp")
           for (int i = 0; i < 3; i++)
-            up[i] = values[i];
+            u[i] = values[i];
         else if (propertyName == "CameraViewAngle")
-          aov = values[0];
+          a = values[0];
       }
     }
   }
   catch(...) { return false; }
 
-  dir[0] = center[0] - eye[0];
-  dir[1] = center[1] - eye[1];
-  dir[2] = center[2] - eye[2];
+  if (! have_eye || ! have_center)
+    return false;
+
+  for (int i = 0; i < 3; i++)
+  {
+    eye[i] = e[i];
+    up[i] = u[i];
+    dir[i] = center[i] - e[i];
+  }
+  aov = a;
     
   return true;
 }
 
+// Is v[name] an array of at least three numbers?
+
+static bool
+is_vec3(Value& v, const char *name)
+{
+  if (! v.HasMember(name) || ! v[name].IsArray() || v[name].Size() < 3)
+    return false;
+
+  for (int i = 0; i < 3; i++)
+    if (! v[name][i].IsNumber())
+      return false;
+
+  return true;
+}
+
 bool 
 Camera::LoadFromJSON(Value& v)
 {
@@ -190,13 +224,18 @@ Camera::LoadFromJSON(Value& v)
       else return true;
     }
 
+    float e[3] = {eye[0], eye[1], eye[2]};
+    float u[3] = {up[0], up[1], up[2]};
+    float a = aov;
     float center[3];
+    bool have_eye = false, have_center = false;
 
     if (! doc.HasMember("PVCameraConfiguration") || 
         !doc["PVCameraConfiguration"].HasMember("Proxy") || 
         !doc["PVCameraConfiguration"]["Proxy"].HasMember("Property"))
     {
       std::cerr << "invalid Paraview camera file: " << v.GetString() << "\n";
+      set_error(1);
       return false;
     }
     
@@ -210,32 +249,63 @@ Camera::LoadFromJSON(Value& v)
         string name = p["@name"].GetString();
         if (name == "CameraPosition")
         {
-          eye[0] = atof(p["Element"][0]["@value"].GetString());
-          eye[1] = atof(p["Element"][1]["@value"].GetString());
-          eye[2] = atof(p["Element"][2]["@value"].GetString());
+          e[0] = atof(p["Element"][0]["@value"].GetString());
+          e[1] = atof(p["Element"][1]["@value"].GetString());
+          e[2] = atof(p["Element"][2]["@value"].GetString());
+          have_eye = true;
         }
         else if (name == "CameraFocalPoint")
         {
           center[0] = atof(p["Element"][0]["@value"].GetString());
           center[1] = atof(p["Element"][1]["@value"].GetString());
           center[2] = atof(p["Element"][2]["@value"].GetString());
+          have_center = true;
         }
         else if (name == "CameraViewUp")
         {
-          up[0] = atof(p["Element"][0]["@value"].GetString());
-          up[1] = atof(p["Element"][1]["@value"].GetString());
-          up[2] = atof(p["Element"][2]["@value"].GetString());
+          u[0] = atof(p["Element"][0]["@value"].GetString());
+          u[1] = atof(p["Element"][1]["@value"].GetString());
+          u[2] = atof(p["Element"][2]["@value"].GetString());
         }
         else if (name == "CameraViewAngle")
-          aov = atof(p["Element"]["@value"].GetString());
+          a = atof(p["Element"]["@value"].GetString());
       }
     }
-    dir[0] = center[0] - eye[0];
-    dir[1] = center[1] - eye[1];
-    dir[2] = center[2] - eye[2];
+
+    if (! have_eye || ! have_center)
+    {
+      std::cerr << "Paraview camera file needs CameraPosition and CameraFocalPoint: " << v.GetString() << "\n";
+      set_error(1);
+      return false;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+      eye[i] = e[i];
+      up[i] = u[i];
+      dir[i] = center[i] - e[i];
+    }
+    aov = a;
   }
   else
   {
+    // Check everything before changing anything, so a bad specification
+    // leaves the camera as it was
+
+    if (! is_vec3(v, "viewpoint") || ! is_vec3(v, "viewup") || ! v.HasMember("aov") || ! v["aov"].IsNumber())
+    {
+      std::cerr << "camera needs viewpoint, viewup and aov\n";
+      set_error(1);
+      return false;
+    }
+
+    if (! is_vec3(v, "viewdirection") && ! is_vec3(v, "viewcenter"))
+    {
+      std::cerr << "need either viewdirection or viewcenter\n";
+      set_error(1);
+      return false;
+    }
+
     if (v.HasMember("annotation"))
     {
       SetAnnotation(string(v["annotation"].GetString()));
@@ -251,18 +321,12 @@ Camera::LoadFromJSON(Value& v)
       dir[1] = v["viewdirection"][1].GetDouble();
       dir[2] = v["viewdirection"][2].GetDouble();
     }
-    else if (v.HasMember("viewcenter"))
+    else
     {
       dir[0] = v["viewcenter"][0].GetDouble() - eye[0];
       dir[1] = v["viewcenter"][1].GetDouble() - eye[1];
       dir[2] = v["viewcenter"][2].GetDouble() - eye[2];
     }
-    else
-    {
-      std::cerr << "need either viewdirection or viewcenter\n";
-      set_error(1);
-      return false;
-    }
 
     if (v.HasMember("dimensions"))
     {
@@ -0,0 +1,155 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#include <iostream>
+#include <pthread.h>
+
+#include "Application.h"
+#include "Threading.h"
+#include "ImageOutputQueue.h"
+#include "ImageWriter.h"
+
+using namespace std;
+
+namespace gxy 
+{
+
+void *
+ImageOutputQueue::theImageWorker(void *d)
+{
+	ImageOutputQueue *q = (ImageOutputQueue *)d;
+
+	register_thread("theImageWorker");
+
+	pthread_mutex_lock(&q->lock);
+
+	while (true)
+	{
+		while (!q->done && q->images.empty())
+			pthread_cond_wait(&q->wait, &q->lock);
+
+		if (q->images.empty())
+			break;
+
+		Image img = q->images.front();
+		q->images.pop_front();
+		q->active++;
+
+		pthread_mutex_unlock(&q->lock);
+
+		if (img.asFloat)
+		{
+			FloatImageWriter writer;
+			writer.Write(img.w, img.h, img.rgba.get(), img.name.c_str());
+		}
+		else
+		{
+			ColorImageWriter writer;
+			writer.Write(img.w, img.h, img.rgba.get(), img.name.c_str());
+		}
+
+		// Let go of the buffer before reporting idle, so that once Wait returns
+		// the owner is free to reuse it
+
+		img.rgba.reset();
+
+		pthread_mutex_lock(&q->lock);
+
+		q->active--;
+		if (q->active == 0 && q->images.empty())
+			pthread_cond_broadcast(&q->idle);
+	}
+
+	pthread_mutex_unlock(&q->lock);
+	pthread_exit(0);
+}
+
+ImageOutputQueue::ImageOutputQueue(int nthreads)
+{
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&wait, NULL);
+	pthread_cond_init(&idle, NULL);
+
+	active = 0;
+	done = false;
+
+	if (nthreads < 1)
+		nthreads = 1;
+
+	for (int i = 0; i < nthreads; i++)
+	{
+		pthread_t tid;
+		GetTheApplication()->GetTheThreadManager()->create_thread(string("imageWorker"), &tid, NULL, ImageOutputQueue::theImageWorker, this);
+		tids.push_back(tid);
+	}
+}
+
+ImageOutputQueue::~ImageOutputQueue()
+{
+	// Workers drain the queue before noticing that we're done
+
+	pthread_mutex_lock(&lock);
+	done = true;
+	pthread_cond_broadcast(&wait);
+	pthread_mutex_unlock(&lock);
+
+	for (auto tid : tids)
+		pthread_join(tid, NULL);
+
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&wait);
+	pthread_cond_destroy(&idle);
+}
+
+void
+ImageOutputQueue::Enqueue(int w, int h, shared_ptr<float> rgba, string name, bool asFloat)
+{
+	Image img;
+	img.w = w;
+	img.h = h;
+	img.rgba = rgba;
+	img.name = name;
+	img.asFloat = asFloat;
+
+	pthread_mutex_lock(&lock);
+	images.push_back(img);
+	pthread_cond_signal(&wait);
+	pthread_mutex_unlock(&lock);
+}
+
+void
+ImageOutputQueue::Wait()
+{
+	pthread_mutex_lock(&lock);
+	while (active > 0 || !images.empty())
+		pthread_cond_wait(&idle, &lock);
+	pthread_mutex_unlock(&lock);
+}
+
+int
+ImageOutputQueue::GetNumberOfPendingImages()
+{
+	pthread_mutex_lock(&lock);
+	int n = active + images.size();
+	pthread_mutex_unlock(&lock);
+	return n;
+}
+
+} // namespace gxy
@@ -0,0 +1,92 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file ImageOutputQueue.h 
+ * \brief writes rendered images on background threads
+ * \ingroup render
+ */
+
+#include <deque>
+#include <memory>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace gxy
+{
+
+//! writes rendered images on background threads
+/*! SaveImages normally encodes and writes each image inside a blocking collective.
+ * When images are saved asynchronously the owning process copies the framebuffer
+ * into a snapshot and queues it here, so the next RenderingSet can be traced while
+ * the images of the previous one are encoded and written.   Each Renderer creates
+ * its queue when it is first used.
+ *
+ * The number of writer threads is set by the GXY_IMAGE_THREADS environment variable 
+ * (default 2).
+ * \ingroup render 
+ * \sa Renderer::GetTheImageOutputQueue
+ */
+class ImageOutputQueue
+{
+public:
+	ImageOutputQueue(int nthreads); //!< constructor
+	~ImageOutputQueue(); //!< destructor, writes any queued images before returning
+
+	//! queue an image for output
+	/*! \param w the image width
+	 * \param h the image height
+	 * \param rgba a buffer of float RGBA values with size `4 * w * h`.  The queue holds a reference until the image is written.
+	 * \param name the filename base for the image
+	 * \param asFloat if true, write four-channel float FITS files; otherwise, write a PNG color image
+	 */
+	void Enqueue(int w, int h, std::shared_ptr<float> rgba, std::string name, bool asFloat);
+
+	//! wait until every queued image has been written
+	void Wait();
+
+	//! return the number of images queued or being written
+	int GetNumberOfPendingImages();
+
+private:
+	struct Image
+	{
+		int w, h;
+		std::shared_ptr<float> rgba;
+		std::string name;
+		bool asFloat;
+	};
+
+	static void *theImageWorker(void *);
+
+	std::deque<Image> images;
+	int  active;
+	bool done;
+
+	pthread_mutex_t lock;
+	pthread_cond_t  wait;
+	pthread_cond_t  idle;
+
+	std::vector<pthread_t> tids;
+};
+
+} // namespace gxy
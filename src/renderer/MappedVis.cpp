@@ -88,15 +88,23 @@ MappedVis::LoadFromJSON(Value& v)
 {
 	Vis::LoadFromJSON(v);
 
+  // Build the new maps and range aside and only install them once the
+  // whole specification has been read, so an error leaves them as they were
+
+  std::vector<vec4f> cmap = colormap;
+  std::vector<vec2f> omap = opacitymap;
+  float rmin = data_range_min, rmax = data_range_max;
+  bool range;
+
 	if (v.HasMember("data range"))
     {
-      data_range_min = v["data range"][0].GetDouble();
-      data_range_max = v["data range"][1].GetDouble();
-      data_range = true;
+      rmin = v["data range"][0].GetDouble();
+      rmax = v["data range"][1].GetDouble();
+      range = true;
     }
     else
     {
-        data_range = false;
+        range = false;
     }
 
 	if (v.HasMember("transfer function") || v.HasMember("colormap"))
@@ -132,32 +140,39 @@ MappedVis::LoadFromJSON(Value& v)
 
         doc.Parse(s.c_str());
 
-        Value& cmap = doc.IsArray() ? doc[0] : doc;
+        Value& tf = doc.IsArray() ? doc[0] : doc;
 
-        opacitymap.clear();
+        omap.clear();
 
-        if (cmap.HasMember("Points"))
+        if (tf.HasMember("Points"))
         {
-          Value& oa = cmap["Points"];
+          Value& oa = tf["Points"];
           for (int i = 0; i < oa.Size(); i += 4)
           {
             vec2f xo;
             xo.x = oa[i+0].GetDouble();
             xo.y = oa[i+1].GetDouble();
-            opacitymap.push_back(xo);
+            omap.push_back(xo);
           }
         }
         else
         {
           vec2f xo = {0.0, 1.0};
-          opacitymap.push_back(xo);
+          omap.push_back(xo);
           xo = {1.0, 1.0};
-          opacitymap.push_back(xo);
+          omap.push_back(xo);
+        }
+
+        if (! tf.HasMember("RGBPoints"))
+        {
+          std::cerr << "no RGBPoints in transfer function file: " << fname << "\n";
+          set_error(1);
+          return false;
         }
 
-        colormap.clear();
+        cmap.clear();
 
-        Value& rgba = cmap["RGBPoints"];
+        Value& rgba = tf["RGBPoints"];
         for (int i = 0; i < rgba.Size(); i += 4)
         {
           vec4f xrgb;
@@ -165,13 +180,13 @@ MappedVis::LoadFromJSON(Value& v)
           xrgb.y = rgba[i+1].GetDouble();
           xrgb.z = rgba[i+2].GetDouble();
           xrgb.w = rgba[i+3].GetDouble();
-          colormap.push_back(xrgb);
+          cmap.push_back(xrgb);
         }
       }
     }
     else
     {
-			colormap.clear();
+			cmap.clear();
 
 			for (int i = 0; i < m.Size(); i++)
 			{
@@ -180,12 +195,12 @@ MappedVis::LoadFromJSON(Value& v)
 				xrgb.y = m[i][1].GetDouble();
 				xrgb.z = m[i][2].GetDouble();
 				xrgb.w = m[i][3].GetDouble();
-				colormap.push_back(xrgb);
+				cmap.push_back(xrgb);
 			}
 
       if (v.HasMember("opacitymap"))
       {
-        opacitymap.clear();
+        omap.clear();
 
         Value& om = v["opacitymap"];
         for (int i = 0; i < om.Size(); i++)
@@ -193,22 +208,36 @@ MappedVis::LoadFromJSON(Value& v)
           vec2f xo;
           xo.x = om[i][0].GetDouble();
           xo.y = om[i][1].GetDouble();
-          opacitymap.push_back(xo);
+          omap.push_back(xo);
         }
       }
     }
   }
 
+  colormap = cmap;
+  opacitymap = omap;
+  data_range_min = rmin;
+  data_range_max = rmax;
+  data_range = range;
+
   return true;
 }
 
 void
 MappedVis::SetTheOsprayDataObject(OsprayObjectP o)
 {
+  // The transfer function only needs attaching when the OSPRay object is
+  // new; later edits are committed in place by update_transfer_function.
+
+  bool attached = (o == odata);
+
   super::SetTheOsprayDataObject(o);
 
-  ospSetObject(o->GetOSP(), "transferFunction", transferFunction);
-  ospCommit(o->GetOSP());
+  if (! attached)
+  {
+    ospSetObject(o->GetOSP(), "transferFunction", transferFunction);
+    ospCommit(o->GetOSP());
+  }
 }
 
 int
@@ -279,7 +308,14 @@ MappedVis::local_commit(MPI_Comm c)
 {
 	if(super::local_commit(c))  
     return true;
-  
+
+  update_transfer_function();
+  return false;
+}
+
+void
+MappedVis::update_transfer_function()
+{
   if (! transferFunction)
     transferFunction = ospNewTransferFunction("piecewise_linear");
 
@@ -334,6 +370,187 @@ MappedVis::local_commit(MPI_Comm c)
   ospCommit(transferFunction);
   
   ispc::MappedVis_set_transferFunction(ispc, ospray_util::GetIE(transferFunction));
+}
+
+template<typename T>
+static bool
+same(std::vector<T>& a, std::vector<T>& b)
+{
+  return a.size() == b.size() && memcmp(a.data(), b.data(), a.size()*sizeof(T)) == 0;
+}
+
+int
+MappedVis::mapping_changes(vector<vec4f>& cmap, vector<vec2f>& omap, bool range, float rmin, float rmax)
+{
+  int bits = 0;
+
+  if (! same(colormap, cmap))
+    bits |= DIRTY_COLORMAP;
+
+  if (! same(opacitymap, omap))
+    bits |= DIRTY_OPACITYMAP;
+
+  if (data_range != range || (data_range && (data_range_min != rmin || data_range_max != rmax)))
+    bits |= DIRTY_RANGE;
+
+  return bits;
+}
+
+bool
+MappedVis::UpdateFromJSON(Value& v)
+{
+  vector<unsigned char> before = SaveState();
+  int old_dirty = dirty;
+
+  vector<vec4f> old_colormap = colormap;
+  vector<vec2f> old_opacitymap = opacitymap;
+  bool old_data_range = data_range;
+  float old_data_range_min = data_range_min, old_data_range_max = data_range_max;
+
+  Key k = datakey;
+  if (! LoadFromJSON(v))
+  {
+    RestoreState(before);
+    return false;
+  }
+  datakey = k;
+
+  int bits = mapping_changes(old_colormap, old_opacitymap, old_data_range, old_data_range_min, old_data_range_max);
+
+  // Anything a subclass serializes beyond the mapping is untracked; see if
+  // it changed by comparing the whole state with the old mapping put back
+
+  colormap.swap(old_colormap);
+  opacitymap.swap(old_opacitymap);
+  std::swap(data_range, old_data_range);
+  std::swap(data_range_min, old_data_range_min);
+  std::swap(data_range_max, old_data_range_max);
+
+  dirty = old_dirty;
+  vector<unsigned char> after = SaveState();
+
+  colormap.swap(old_colormap);
+  opacitymap.swap(old_opacitymap);
+  std::swap(data_range, old_data_range);
+  std::swap(data_range_min, old_data_range_min);
+  std::swap(data_range_max, old_data_range_max);
+
+  if (before != after)
+    bits |= DIRTY_OTHER;
+
+  // LoadFromJSON may go through setters that mark groups dirty whether or
+  // not they changed; keep only what really did
+
+  dirty = old_dirty | bits;
+  return true;
+}
+
+// Deltas: when DIRTY_OTHER is set Vis ships the whole state and we add
+// nothing; otherwise each dirty mapping group follows in serialize() order.
+
+int
+MappedVis::deltaSize()
+{
+  int sz = super::deltaSize();
+  if (dirty & DIRTY_OTHER)
+    return sz;
+
+  if (dirty & DIRTY_COLORMAP)
+    sz += sizeof(int) + colormap.size()*sizeof(vec4f);
+
+  if (dirty & DIRTY_OPACITYMAP)
+    sz += sizeof(int) + opacitymap.size()*sizeof(vec2f);
+
+  if (dirty & DIRTY_RANGE)
+    sz += sizeof(float) + sizeof(float) + sizeof(bool);
+
+  return sz;
+}
+
+unsigned char *
+MappedVis::serializeDelta(unsigned char *ptr)
+{
+  ptr = super::serializeDelta(ptr);
+  if (dirty & DIRTY_OTHER)
+    return ptr;
+
+  if (dirty & DIRTY_COLORMAP)
+  {
+    *(int *)ptr = colormap.size();
+    ptr += sizeof(int);
+    memcpy(ptr, colormap.data(), colormap.size()*sizeof(vec4f));
+    ptr += colormap.size()*sizeof(vec4f);
+  }
+
+  if (dirty & DIRTY_OPACITYMAP)
+  {
+    *(int *)ptr = opacitymap.size();
+    ptr += sizeof(int);
+    memcpy(ptr, opacitymap.data(), opacitymap.size()*sizeof(vec2f));
+    ptr += opacitymap.size()*sizeof(vec2f);
+  }
+
+  if (dirty & DIRTY_RANGE)
+  {
+    *(float *)ptr = data_range_min;
+    ptr += sizeof(float);
+    *(float *)ptr = data_range_max;
+    ptr += sizeof(float);
+    *(bool *)ptr = data_range; 
+    ptr += sizeof(bool);
+  }
+
+  return ptr;
+}
+
+unsigned char *
+MappedVis::deserializeDelta(unsigned char *ptr)
+{
+  ptr = super::deserializeDelta(ptr);
+  if (dirty & DIRTY_OTHER)
+    return ptr;
+
+  if (dirty & DIRTY_COLORMAP)
+  {
+    int nc = *(int *)ptr;
+    ptr += sizeof(int);
+    SetColorMap(nc, (vec4f *)ptr);
+    ptr += nc * sizeof(vec4f);
+  }
+
+  if (dirty & DIRTY_OPACITYMAP)
+  {
+    int no = *(int *)ptr;
+    ptr += sizeof(int);
+    SetOpacityMap(no, (vec2f *)ptr);
+    ptr += no * sizeof(vec2f);
+  }
+
+  if (dirty & DIRTY_RANGE)
+  {
+    data_range_min = *(float *)ptr;
+    ptr += sizeof(float);
+    data_range_max = *(float *)ptr;
+    ptr += sizeof(float);
+    data_range = *(bool *)ptr;
+    ptr += sizeof(bool);
+  }
+
+  return ptr;
+}
+
+bool
+MappedVis::local_commit_delta(MPI_Comm c)
+{
+  if (dirty & DIRTY_OTHER)
+    return super::local_commit_delta(c);
+
+  // Only the transfer function needs rebuilding; the OSPRay volume or
+  // geometry it is attached to picks up the change when it is committed.
+
+  if (dirty & (DIRTY_COLORMAP | DIRTY_OPACITYMAP | DIRTY_RANGE))
+    update_transfer_function();
+
   return false;
 }
 
@@ -343,6 +560,7 @@ MappedVis::SetColorMap(int n, vec4f *ptr)
 	colormap.clear();
 	for (int i = 0; i < n; i++)
 		colormap.push_back(ptr[i]);
+  mark_dirty(DIRTY_COLORMAP);
 }      
 			 
 void 
@@ -351,6 +569,7 @@ MappedVis::SetOpacityMap(int n, vec2f *ptr)
 	opacitymap.clear();
 	for (int i = 0; i < n; i++)
 		opacitymap.push_back(ptr[i]);
+  mark_dirty(DIRTY_OPACITYMAP);
 }
 
 void
@@ -367,6 +586,8 @@ MappedVis::ScaleMaps(float xmin, float xmax)
 
   for (auto i = 0; i < opacitymap.size(); i++)
     opacitymap[i].x = xmin + ((opacitymap[i].x - x0)/(x1 - x0)) * (xmax - xmin);
+
+  mark_dirty(DIRTY_COLORMAP | DIRTY_OPACITYMAP);
 }
 
 
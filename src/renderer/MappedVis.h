@@ -69,6 +69,9 @@ public:
   //! construct a MappedVis from a Galaxy JSON specification
   virtual bool LoadFromJSON(rapidjson::Value&);
 
+  //! update in place, marking only the mapping groups that changed (DIRTY_OTHER for anything else)
+  virtual bool UpdateFromJSON(rapidjson::Value&);
+
   //! Set the vis' ownership of the OSPRay object and set any per-vis parameters on it
   virtual void SetTheOsprayDataObject(OsprayObjectP o);
 
@@ -78,10 +81,29 @@ public:
   //! scale mapping to a given range
   virtual void ScaleMaps(float xmin, float xmax);
 
+  //! dirty-mask bits for the mapping parameters of a MappedVis
+  enum
+  {
+    DIRTY_COLORMAP   = 0x02,
+    DIRTY_OPACITYMAP = 0x04,
+    DIRTY_RANGE      = 0x08
+  };
+
  protected:
   virtual void allocate_ispc();
   virtual void initialize_ispc();
 
+  //! rebuild the OSPRay transfer function from the color and opacity maps
+  void update_transfer_function();
+
+  //! dirty-mask bits for the mapping parameters that differ from those given
+  int mapping_changes(std::vector<vec4f>& cmap, std::vector<vec2f>& omap, bool range, float rmin, float rmax);
+
+  virtual int deltaSize();
+  virtual unsigned char *serializeDelta(unsigned char *);
+  virtual unsigned char *deserializeDelta(unsigned char *);
+  virtual bool local_commit_delta(MPI_Comm);
+
   float data_range_min, data_range_max;
   bool data_range;
  
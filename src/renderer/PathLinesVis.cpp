@@ -135,6 +135,7 @@ PathLinesVis::SetTheOsprayDataObject(OsprayObjectP o)
 
   ospSet1f(o->GetOSP(), "value1", v1);
   ospSet1f(o->GetOSP(), "radius1", r1);
+  ospCommit(o->GetOSP());
 }
 
 void
@@ -24,6 +24,7 @@
 
 #include "Application.h"
 #include "Threading.h"
+#include "Metrics.h"
 #include "Renderer.h"
 #include "RayQManager.h"
 #include "Rays.h"
@@ -139,51 +140,68 @@ RayList *
 RayQManager::Dequeue()
 {
 	RayList *r = NULL;
+	bool dropped;
 
 	Lock();
 
-#if defined(GXY_EVENT_TRACKING)
+	// If everything on the queue belonged to superseded frames, go back
+	// to waiting rather than returning NULL, which would end the thread
 
-	if (!done && rayQ.empty())
+	do
 	{
-		double t0 = EventTracker::gettime();
-
-		while (!paused && !done && rayQ.empty())
-			Wait();
+		dropped = false;
 
-		double t1 = EventTracker::gettime();
+#if defined(GXY_EVENT_TRACKING)
 
-		class WaitForRaysEvent : public Event
+		if (!done && rayQ.empty())
 		{
-			public:
-				WaitForRaysEvent(double t) : wait(t) {}
+			double t0 = EventTracker::gettime();
 
-			protected:
-				void print(ostream& o)
-				{
-					Event::print(o);
-					o << "waited " << wait << " for ray list or done signal";
-				}
+			while (!paused && !done && rayQ.empty())
+				Wait();
 
-		private:
-			double wait;
-		};
+			double t1 = EventTracker::gettime();
 
-		GetTheEventTracker()->Add(new WaitForRaysEvent(t1 - t0));
-	}
+			class WaitForRaysEvent : public Event
+			{
+				public:
+					WaitForRaysEvent(double t) : wait(t) {}
+
+				protected:
+					void print(ostream& o)
+					{
+						Event::print(o);
+						o << "waited " << wait << " for ray list or done signal";
+					}
+
+			private:
+				double wait;
+			};
+
+			GetTheEventTracker()->Add(new WaitForRaysEvent(t1 - t0));
+		}
 
 #else
 
-	while (!done && (paused || rayQ.empty()))
-		Wait();
+		while (!done && (paused || rayQ.empty()))
+			Wait();
 
 #endif
 
-	if (! rayQ.empty())
-	{
-		r = rayQ.front();
-		rayQ.pop_front();
-	}
+		while (! rayQ.empty())
+		{
+			r = rayQ.front();
+			rayQ.pop_front();
+
+			if (r->GetTheRenderingSet()->IsActive(r->GetFrame()))
+				break;
+
+			Metrics::Count(Metrics::RAYS_DROPPED_STALE, r->GetRayCount());
+			delete r;
+			r = NULL;
+			dropped = true;
+		}
+	} while (!r && dropped && !done);
 
   if (!r && !done)
      cerr << "R IS NULL, done is NOT DONE rayQ.empty is " << rayQ.empty() << " size is " << rayQ.size() << endl;
@@ -253,6 +271,7 @@ RayQManager::Enqueue(RayList *r)
 		Lock();
 
 		rayQ.push_back(r);
+		Metrics::Peak(Metrics::RAYQ_DEPTH, rayQ.size());
 
 		if (! paused)
 			Signal();
@@ -260,7 +279,10 @@ RayQManager::Enqueue(RayList *r)
 		Unlock();
 	}
 	else
+	{
+		Metrics::Count(Metrics::RAYS_DROPPED_STALE, r->GetRayCount());
     delete r;
+	}
 }
 
 } // namespace gxy
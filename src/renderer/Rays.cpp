@@ -25,6 +25,8 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <cstring>
 #include <pthread.h>
 
 #include "Application.h"
@@ -39,6 +41,8 @@ using namespace std;
 namespace gxy
 {
 
+bool RayList::packing = getenv("GXY_PACK_RAYS") ? atoi(getenv("GXY_PACK_RAYS")) != 0 : false;
+
 RayList::RayList(RendererP renderer, RenderingSetP rs, RenderingP r, int nrays, RayListType type) 
 	: RayList(renderer, rs, r, nrays, rs->GetCurrentFrame(), type) {}
 
@@ -65,6 +69,7 @@ RayList::RayList(RendererP renderer, RenderingSetP rs, RenderingP r, int nrays,
 	h->size 						= nrays;
 	h->aligned_size 		= nn;
 	h->type 						= type;
+	h->packed						= 0;
 
 	ispc = malloc(sizeof(ispc::RayList_ispc));
 	setup_ispc_pointers();
@@ -84,7 +89,191 @@ RayList::RayList(SharedP c)
 	theRendering = Rendering::GetByKey(h->renderingKey);
 
 	ispc = malloc(sizeof(ispc::RayList_ispc));
+
+	if (h->packed)
+		unpack(c);
+	else
+		setup_ispc_pointers();
+}
+
+// round-to-nearest-even float <-> IEEE half conversion
+
+static inline unsigned short
+float_to_half(float f)
+{
+	unsigned int x;
+	memcpy(&x, &f, sizeof(x));
+
+	unsigned int sign = (x >> 16) & 0x8000;
+	unsigned int mant = x & 0x7fffff;
+	int          fexp = (x >> 23) & 0xff;
+	int          exp  = fexp - 127 + 15;
+
+	if (fexp == 0xff)
+		return sign | 0x7c00 | (mant ? 0x200 : 0);
+
+	if (exp >= 31)
+		return sign | 0x7c00;
+
+	if (exp <= 0)
+	{
+		if (exp < -10)
+			return sign;
+
+		mant |= 0x800000;
+		int shift = 14 - exp;
+		unsigned int h = mant >> shift;
+		unsigned int rem = mant & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+		if (rem > halfway || (rem == halfway && (h & 1))) h++;
+		return sign | h;
+	}
+
+	// a carry out of the mantissa correctly bumps the exponent
+
+	unsigned int h = (exp << 10) | (mant >> 13);
+	unsigned int rem = mant & 0x1fff;
+	if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;
+	return sign | h;
+}
+
+static inline float
+half_to_float(unsigned short h)
+{
+	unsigned int sign = (h & 0x8000) << 16;
+	int          exp  = (h >> 10) & 0x1f;
+	unsigned int mant = h & 0x3ff;
+	unsigned int x;
+
+	if (exp == 0)
+	{
+		if (mant == 0)
+			x = sign;
+		else
+		{
+			exp = 1;
+			while (! (mant & 0x400)) { mant <<= 1; exp--; }
+			x = sign | ((exp + 127 - 15) << 23) | ((mant & 0x3ff) << 13);
+		}
+	}
+	else if (exp == 31)
+		x = sign | 0x7f800000 | (mant << 13);
+	else
+		x = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+
+	float f;
+	memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+SharedP
+RayList::Pack()
+{
+	hdr *h = (hdr *)contents->get();
+	int n  = h->size;
+
+	bool short_xy = theRendering->GetTheWidth() <= 65536 && theRendering->GetTheHeight() <= 65536;
+	size_t xy_sz  = short_xy ? sizeof(unsigned short) : sizeof(int);
+
+	SharedP p = smem::New(HDRSZ + n * (9*sizeof(float) + 3*sizeof(unsigned short) + 2*xy_sz + 1));
+
+	memcpy(p->get(), h, sizeof(hdr));
+	((hdr *)p->get())->packed = short_xy ? PACKED_SHORT_XY : PACKED_INT_XY;
+
+	float *f = (float *)(p->get() + HDRSZ);
+	float *full[] = {get_ox_base(), get_oy_base(), get_oz_base(), get_dx_base(), get_dy_base(), get_dz_base(), get_t_base(), get_tMax_base(), get_o_base()};
+	for (auto src : full)
+	{
+		memcpy(f, src, n*sizeof(float));
+		f += n;
+	}
+
+	unsigned short *c = (unsigned short *)f;
+	float *colors[] = {get_r_base(), get_g_base(), get_b_base()};
+	for (auto src : colors)
+		for (int i = 0; i < n; i++)
+			*c++ = float_to_half(src[i]);
+
+	unsigned char *ptr = (unsigned char *)c;
+	int *xy[] = {get_x_base(), get_y_base()};
+	for (auto src : xy)
+		if (short_xy)
+		{
+			unsigned short *s = (unsigned short *)ptr;
+			for (int i = 0; i < n; i++)
+				s[i] = (unsigned short)src[i];
+			ptr += n*sizeof(unsigned short);
+		}
+		else
+		{
+			memcpy(ptr, src, n*sizeof(int));
+			ptr += n*sizeof(int);
+		}
+
+	int *type = get_type_base();
+	for (int i = 0; i < n; i++)
+		*ptr++ = (unsigned char)type[i];
+
+	return p;
+}
+
+void
+RayList::unpack(SharedP packed)
+{
+	hdr *ph = (hdr *)packed->get();
+	int n   = ph->size;
+	int nn  = ROUND_UP_TO_MULTIPLE_OF_16(n);
+
+	contents = smem::New(HDRSZ + nn * (20*sizeof(float) + 5*sizeof(int)));
+
+	hdr *h = (hdr *)contents->get();
+	memcpy(h, ph, sizeof(hdr));
+	h->aligned_size = nn;
+	h->packed       = 0;
+
 	setup_ispc_pointers();
+
+	float *f = (float *)(packed->get() + HDRSZ);
+	float *full[] = {get_ox_base(), get_oy_base(), get_oz_base(), get_dx_base(), get_dy_base(), get_dz_base(), get_t_base(), get_tMax_base(), get_o_base()};
+	for (auto dst : full)
+	{
+		memcpy(dst, f, n*sizeof(float));
+		f += n;
+	}
+
+	unsigned short *c = (unsigned short *)f;
+	float *colors[] = {get_r_base(), get_g_base(), get_b_base()};
+	for (auto dst : colors)
+		for (int i = 0; i < n; i++)
+			dst[i] = half_to_float(*c++);
+
+	unsigned char *ptr = (unsigned char *)c;
+	int *xy[] = {get_x_base(), get_y_base()};
+	for (auto dst : xy)
+		if (ph->packed == PACKED_SHORT_XY)
+		{
+			unsigned short *s = (unsigned short *)ptr;
+			for (int i = 0; i < n; i++)
+				dst[i] = s[i];
+			ptr += n*sizeof(unsigned short);
+		}
+		else
+		{
+			memcpy(dst, ptr, n*sizeof(int));
+			ptr += n*sizeof(int);
+		}
+
+	int *type = get_type_base();
+	for (int i = 0; i < n; i++)
+		type[i] = *ptr++;
+
+	// The rest are outputs of the tracer, but start them clean
+
+	float *dead[] = {get_nx_base(), get_ny_base(), get_nz_base(), get_sample_base(), get_sr_base(), get_sg_base(), get_sb_base(), get_so_base()};
+	for (auto dst : dead)
+		memset(dst, 0, n*sizeof(float));
+
+	memset(get_term_base(), 0, n*sizeof(int));
+	memset(get_classification_base(), 0, n*sizeof(int));
 }
 
 RayList::~RayList()
@@ -170,6 +359,73 @@ void RayList::set_type(int i, int v)           { ((ispc::RayList_ispc *)ispc)->t
 void RayList::set_term(int i, int v)           { ((ispc::RayList_ispc *)ispc)->term[i] = v; }
 void RayList::set_classification(int i, int v) { ((ispc::RayList_ispc *)ispc)->classification[i] = v; }
 
+// spread the low 10 bits of v out to every third bit
+
+static inline unsigned int
+spread_bits(unsigned int v)
+{
+	v = (v | (v << 16)) & 0x030000FF;
+	v = (v | (v <<  8)) & 0x0300F00F;
+	v = (v | (v <<  4)) & 0x030C30C3;
+	v = (v | (v <<  2)) & 0x09249249;
+	return v;
+}
+
+void
+RayList::Sort()
+{
+	int n = GetRayCount();
+	if (n < 2)
+		return;
+
+	float *ox = get_ox_base(), *oy = get_oy_base(), *oz = get_oz_base();
+	float *dx = get_dx_base(), *dy = get_dy_base(), *dz = get_dz_base();
+
+	float lo[3] = {ox[0], oy[0], oz[0]};
+	float hi[3] = {ox[0], oy[0], oz[0]};
+	for (int i = 1; i < n; i++)
+	{
+		if (ox[i] < lo[0]) lo[0] = ox[i]; else if (ox[i] > hi[0]) hi[0] = ox[i];
+		if (oy[i] < lo[1]) lo[1] = oy[i]; else if (oy[i] > hi[1]) hi[1] = oy[i];
+		if (oz[i] < lo[2]) lo[2] = oz[i]; else if (oz[i] > hi[2]) hi[2] = oz[i];
+	}
+
+	float scale[3];
+	for (int j = 0; j < 3; j++)
+		scale[j] = (hi[j] > lo[j]) ? 1023.0 / (hi[j] - lo[j]) : 0.0;
+
+	// Key is the direction octant above a 30-bit Morton code, paired with 
+	// the ray's current index
+
+	std::vector< std::pair<unsigned long, int> > keys(n);
+	for (int i = 0; i < n; i++)
+	{
+		unsigned long octant = (dx[i] < 0 ? 1 : 0) | (dy[i] < 0 ? 2 : 0) | (dz[i] < 0 ? 4 : 0);
+		unsigned int  morton = (spread_bits((unsigned int)((ox[i] - lo[0]) * scale[0])) << 2) |
+													 (spread_bits((unsigned int)((oy[i] - lo[1]) * scale[1])) << 1) |
+														spread_bits((unsigned int)((oz[i] - lo[2]) * scale[2]));
+		keys[i] = std::pair<unsigned long, int>((octant << 30) | morton, i);
+	}
+
+	std::sort(keys.begin(), keys.end());
+
+	// All 25 per-ray arrays are 4-byte values laid out back to back, 
+	// aligned_size apart.   Gather each through the permutation.
+
+	hdr *h = (hdr *)contents->get();
+	int nn = h->aligned_size;
+	unsigned int *base = (unsigned int *)(contents->get() + HDRSZ);
+
+	std::vector<unsigned int> tmp(n);
+	for (int a = 0; a < 25; a++)
+	{
+		unsigned int *arr = base + a*nn;
+		for (int i = 0; i < n; i++)
+			tmp[i] = arr[keys[i].second];
+		memcpy(arr, tmp.data(), n*sizeof(unsigned int));
+	}
+}
+
 void
 RayList::setup_ispc_pointers()
 {
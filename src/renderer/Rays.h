@@ -56,8 +56,16 @@ private:
 		int aligned_size;
 		int id;
 	  RayListType type;
+		int packed;			// 0, or the encoding of packed contents
 	};
 
+	enum { PACKED_SHORT_XY = 1, PACKED_INT_XY = 2 };
+
+	// decode packed contents into a standard RayList
+	void unpack(SharedP packed);
+
+	static bool packing;
+
 public:
 	~RayList(); //!< default destructor
 
@@ -103,6 +111,22 @@ public:
 	int GetId() { return ((struct hdr *)contents->get())->id; } //!< return the pixel id this RayList renders into
 	SharedP get_ptr() { return contents; }; //!< returns a shared pointer to the ISPC contents of this ray list
 
+	//! return a compact encoding of this RayList for sending to another process
+	/*! Only what the receiving tracer reads is kept: origin, direction, t, tMax
+	 * and the accumulated opacity (which decides early termination) at full 
+	 * precision, the accumulated color as fp16, pixel coordinates as 16 bits when
+	 * they fit and the ray type as a byte.   Normals, surface colors, samples,
+	 * termination and classification are all written by the tracer before being
+	 * read, so they are dropped; this is less than half the size of the standard
+	 * layout.   The RayList(SharedP) constructor decodes packed contents.
+	 */
+	SharedP Pack();
+
+	//! send RayLists to other processes packed (initially set from GXY_PACK_RAYS, default off)
+	static void SetPacking(bool p) { packing = p; }
+	//! return whether RayLists are sent to other processes packed
+	static bool GetPacking() { return packing; }
+
 	//! returns a pointer to the header of the ISPC contents of this RayList
 	void *get_header_address() { return ((void *)(contents->get())); } 
 
@@ -122,6 +146,16 @@ public:
 	 */
 	void Split(std::vector<RayList*>& subsets);
 
+	//! reorder the rays in this RayList so that rays traced together in a SIMD gang are coherent
+	/*! Rays are binned by direction octant - which determines the faces of the 
+	 * local box through which they can enter and exit - and within each bin are 
+	 * ordered along a Morton curve through their origins, quantized to the 
+	 * bounding box of the origins in this RayList.   Nothing downstream of the 
+	 * tracer depends on the order of rays in a RayList, since each carries its 
+	 * own pixel.
+	 */
+	void Sort();
+
 	//! configure pointers for the ISPC representation of this RayList
 	void setup_ispc_pointers();
 
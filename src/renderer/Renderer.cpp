@@ -36,6 +36,7 @@
 #include "DataObjects.h"
 #include "Pixel.h"
 #include "RayFlags.h"
+#include "ImageOutputQueue.h"
 #include "RayQManager.h"
 #include "Renderer.h"
 #include "TraceRays.h"
@@ -126,6 +127,7 @@ Renderer::initialize()
 
   frame = 0;
   rayQmanager = new RayQManager(this);
+  imageOutputQueue = NULL;
   pthread_mutex_init(&lock, NULL);
 
   sent_to = new int[GetTheApplication()->GetSize()];
@@ -146,6 +148,22 @@ Renderer::initialize()
     SetPermutePixels(true);
 #endif
 
+  char *raySort = getenv("GXY_RAY_SORT");
+  if (raySort && std::string(raySort) == "measure")
+    SetRaySortMode(RAYSORT_MEASURE);
+  else if (raySort && atoi(raySort) > 0)
+    SetRaySortMode(RAYSORT_ON);
+  else
+    SetRaySortMode(RAYSORT_OFF);
+
+  char *aoSequence = getenv("GXY_AO_SEQUENCE");
+  if (aoSequence && std::string(aoSequence) == "r2")
+    SetAOSequence(TraceRays::AO_R2);
+  else if (aoSequence && std::string(aoSequence) == "progressive")
+    SetAOSequence(TraceRays::AO_PROGRESSIVE);
+  else
+    SetAOSequence(TraceRays::AO_HASH);
+
   char *ospMsgs = getenv("GXY_SHOW_OSPRAY_MESSAGES");
   if (ospMsgs && atoi(ospMsgs) > 0)
     ospDeviceSetStatusFunc(ospGetCurrentDevice(), print_ospray_error_messages);
@@ -155,6 +173,21 @@ Renderer::~Renderer()
 {
     rayQmanager->Kill();
     delete rayQmanager;
+    if (imageOutputQueue)
+      delete imageOutputQueue;
+}
+
+ImageOutputQueue *
+Renderer::GetTheImageOutputQueue()
+{
+  // Only renderers that save images asynchronously need the writer threads
+
+  pthread_mutex_lock(&lock);
+  if (! imageOutputQueue)
+    imageOutputQueue = new ImageOutputQueue(getenv("GXY_IMAGE_THREADS") ? atoi(getenv("GXY_IMAGE_THREADS")) : 2);
+  pthread_mutex_unlock(&lock);
+
+  return imageOutputQueue;
 }
 
 void 
@@ -198,6 +231,8 @@ Renderer::local_render(RendererP renderer, RenderingSetP renderingSet)
   for (int i = 0; i < GetTheApplication()->GetSize(); i++)
     sent_to[i] = 0, received_from[i] = 0;
 
+  Metrics::BeginFrame();
+
   // NeedInitialRays tells us whether we need to generate initial rays
   // for the current frame.  It is possible that this RenderingSet has
   // already seen a raylist from a later frame, in which case we won't
@@ -430,11 +465,21 @@ Renderer::AssignDestinations(RayList *raylist)
   {
     if (raylist->get_classification(i) == RAY_BOUNDARY)
     {
+      float t;
       int exit_face = box->exit_face(raylist->get_ox(i), raylist->get_oy(i), raylist->get_oz(i),
-                                   raylist->get_dx(i), raylist->get_dy(i), raylist->get_dz(i));
+                                   raylist->get_dx(i), raylist->get_dy(i), raylist->get_dz(i), t);
+
+      // With an irregular decomposition the face may border several
+      // partitions; the exit point picks which
+
+      vec3f exit_point(raylist->get_ox(i) + t*raylist->get_dx(i),
+                       raylist->get_oy(i) + t*raylist->get_dy(i),
+                       raylist->get_oz(i) + t*raylist->get_dz(i));
 
-      if (visualization->has_neighbor(exit_face)) 
-        raylist->set_classification(i, visualization->get_neighbor(exit_face));
+      int neighbor = visualization->neighbor_at(exit_face, exit_point);
+
+      if (neighbor >= 0)
+        raylist->set_classification(i, neighbor);
       else
       {
         int t = raylist->get_type(i);
@@ -466,7 +511,64 @@ Renderer::HandleTerminatedRays(RayList *raylist)
 
   if (terminated_count == 0) return;
 
-  if (rendering->IsLocal())
+  if (rendering->IsTiled())
+  {
+    // Route each pixel to the process holding its row of the framebuffer
+
+    int size = GetTheApplication()->GetSize();
+    int rank = GetTheApplication()->GetRank();
+
+    vector<int> knts(size, 0);
+    for (int i = 0; i < raylist->GetRayCount(); i++)
+      if (raylist->get_classification(i) == Renderer::TERMINATED)
+        knts[rendering->GetTileOwner(raylist->get_y(i))]++;
+
+    for (int dst = 0; dst < size; dst++)
+    {
+      if (knts[dst] == 0)
+        continue;
+
+      if (dst == rank)
+      {
+        Pixel *local_pixels = new Pixel[knts[dst]];
+
+        Pixel *p = local_pixels;
+        for (int i = 0; i < raylist->GetRayCount(); i++)
+          if (raylist->get_classification(i) == Renderer::TERMINATED && rendering->GetTileOwner(raylist->get_y(i)) == rank)
+          {
+            p->x = raylist->get_x(i);
+            p->y = raylist->get_y(i);
+            p->r = raylist->get_r(i);
+            p->g = raylist->get_g(i);
+            p->b = raylist->get_b(i);
+            p->o = raylist->get_o(i);
+            p++;
+          }
+
+        rendering->AddLocalPixels(local_pixels, knts[dst], raylist->GetFrame(), rank);
+        delete[] local_pixels;
+
+        Metrics::Count(Metrics::PIXELS_LOCAL, knts[dst]);
+      }
+      else
+      {
+        Renderer::SendPixelsMsg *spmsg = new Renderer::SendPixelsMsg(rendering, renderingSet, raylist->GetFrame(), knts[dst]);
+
+        for (int i = 0; i < raylist->GetRayCount(); i++)
+          if (raylist->get_classification(i) == Renderer::TERMINATED && rendering->GetTileOwner(raylist->get_y(i)) == dst)
+            spmsg->StashPixel(raylist, i);
+
+        if (renderingSet->IsActive(raylist->GetFrame()))
+        {
+          spmsg->Send(dst);
+          Metrics::Count(Metrics::PIXELS_SENT, knts[dst]);
+        }
+
+        delete spmsg;
+      }
+    }
+  }
+  else if (rendering->IsLocal() || Rendering::GetCompositing())
   {
     Pixel *local_pixels = new Pixel[terminated_count];
 
@@ -485,6 +587,8 @@ Renderer::HandleTerminatedRays(RayList *raylist)
 
     rendering->AddLocalPixels(local_pixels, terminated_count, raylist->GetFrame(), GetTheApplication()->GetRank());
     delete[] local_pixels;
+
+    Metrics::Count(Metrics::PIXELS_LOCAL, terminated_count);
   }
   else
   {
@@ -495,7 +599,10 @@ Renderer::HandleTerminatedRays(RayList *raylist)
         spmsg->StashPixel(raylist, i);
 
     if (renderingSet->IsActive(raylist->GetFrame()))
+    {
       spmsg->Send(rendering->GetTheOwner());
+      Metrics::Count(Metrics::PIXELS_SENT, terminated_count);
+    }
 
     delete spmsg;
   }
@@ -537,6 +644,7 @@ public:
 			if (! renderingSet->IsActive(raylist->GetFrame()))
 		  {
 				// std::cerr << GetTheApplication()->GetRank() << " dropping raylist (" << raylist->GetFrame() << ", " <<  renderingSet->GetCurrentFrame() << ")\n";
+				Metrics::Count(Metrics::RAYS_DROPPED_STALE, raylist->GetRayCount());
 				delete raylist;
 				return 0;
 		  }
@@ -546,6 +654,16 @@ public:
 			// This may put secondary lists on the ray queue
 			renderer->Trace(raylist);
 
+			// If the frame was superseded while we were tracing, there's no
+			// point classifying and shipping the results
+
+			if (! renderingSet->IsActive(raylist->GetFrame()))
+			{
+				Metrics::Count(Metrics::RAYS_TRACED_STALE, raylist->GetRayCount());
+				delete raylist;
+				return 0;
+			}
+
       // Classify annotated rays
       renderer->Classify(raylist);
 
@@ -670,10 +788,29 @@ Renderer::Trace(RayList *raylist)
   // until we actually are.
 
   TraceRays tracer(GetEpsilon());
+  tracer.SetAOSequence(ao_sequence);
+
+  bool sorted = (ray_sort_mode == RAYSORT_ON) || 
+                (ray_sort_mode == RAYSORT_MEASURE && (raylist->GetId() & 1));
+
+  double t0 = Metrics::Enabled() ? Metrics::Now() : 0;
+
+  if (sorted)
+    raylist->Sort();
 
   RayList *out = tracer.Trace(rendering->GetLighting(), visualization, raylist);
+
+  if (Metrics::Enabled())
+  {
+    Metrics::Traced(raylist->GetRayCount(), tracer.GetSampleCount(), t0, Metrics::Now());
+    Metrics::Count(sorted ? Metrics::LANES_ACTIVE_SORTED : Metrics::LANES_ACTIVE_UNSORTED, tracer.GetSampleCount());
+    Metrics::Count(sorted ? Metrics::LANE_SLOTS_SORTED : Metrics::LANE_SLOTS_UNSORTED, tracer.GetLaneSlots());
+  }
+
   if (out)
   {
+    Metrics::Count(Metrics::RAYS_SECONDARY, out->GetRayCount());
+
     if (out->GetRayCount() > renderer->GetMaxRayListSize())
     {
       vector<RayList*> rayLists;
@@ -726,6 +863,7 @@ Renderer::StatisticsMsg::CollectiveAction(MPI_Comm c, bool is_root)
   Key key = *(Key *)ptr;
   RendererP r = GetByKey(key);
   r->_dumpStats();
+  Metrics::Flush();
   return false;
 }
 
@@ -734,13 +872,23 @@ Renderer::SendRays(RayList *rays, int destination)
 {
 #ifdef GXY_WRITE_IMAGES
   rays->GetTheRenderingSet()->IncrementInFlightCount();
+  rays->GetTheRenderingSet()->CountRayListSent();
 #endif
 
   int nReceived = rays->GetRayCount();
   _sent_to(destination, nReceived);
+  Metrics::RaysTo(destination, nReceived);
 
-  SendRaysMsg msg(rays);
-  msg.Send(destination);
+  if (RayList::GetPacking())
+  {
+    SendRaysMsg msg(rays->Pack());
+    msg.Send(destination);
+  }
+  else
+  {
+    SendRaysMsg msg(rays);
+    msg.Send(destination);
+  }
 }
 
 bool
@@ -750,6 +898,7 @@ Renderer::SendRaysMsg::Action(int sender)
 
   int nReceived = rayList->GetRayCount();
   rayList->GetTheRenderer()->_received_from(sender, nReceived);
+  Metrics::Count(Metrics::RAYS_RECEIVED, nReceived);
 
   RenderingP rendering = rayList->GetTheRendering();
   RenderingSetP renderingSet = rendering ? rayList->GetTheRenderingSet() : NULL;
@@ -760,6 +909,17 @@ Renderer::SendRaysMsg::Action(int sender)
     return false;
   }
 
+#ifdef GXY_WRITE_IMAGES
+  renderingSet->CountRayListReceived();
+#endif
+
+  if (! renderingSet->IsActive(rayList->GetFrame()))
+  {
+    Metrics::Count(Metrics::RAYS_DROPPED_STALE, nReceived);
+    delete rayList;
+    return false;
+  }
+
 #ifdef GXY_EVENT_TRACKING
   class ReceiveRaysEvent : public Event
   {
@@ -861,7 +1021,20 @@ Renderer::Start(RenderingSetP rs)
   GetTheEventTracker()->Add(new StartRenderingEvent(rs->getkey()));
 #endif
 
-  RenderMsg msg(this, rs);
+  // The frame number is assigned here rather than by each process when the
+  // RenderMsg is handled, so that a Start issued while an earlier RenderMsg
+  // is still queued really does supersede it
+
+  int frame = rs->StartFrame();
+
+#ifndef GXY_WRITE_IMAGES
+  // Cancel whatever is still in flight for earlier frames before the
+  // render message itself, which may queue behind their ray traffic
+
+  rs->AdvanceEpoch(frame);
+#endif
+
+  RenderMsg msg(this, rs, frame);
   msg.Broadcast(false, true);
 }
 
@@ -875,14 +1048,16 @@ Renderer::RenderMsg::~RenderMsg()
 {
 }
 
-Renderer::RenderMsg::RenderMsg(Renderer* r, RenderingSetP rs) :
-  Renderer::RenderMsg(sizeof(Key) + r->SerialSize() + sizeof(Key))
+Renderer::RenderMsg::RenderMsg(Renderer* r, RenderingSetP rs, int frame) :
+  Renderer::RenderMsg(sizeof(Key) + r->SerialSize() + sizeof(Key) + sizeof(int))
 {
   unsigned char *p = contents->get();
   *(Key *)p = r->getkey();
   p = p + sizeof(Key);
   p = r->Serialize(p);
   *(Key *)p = rs->getkey();
+  p = p + sizeof(Key);
+  *(int *)p = frame;
 }
 
 bool
@@ -896,6 +1071,9 @@ Renderer::RenderMsg::Action(int sender)
   p = renderer->Deserialize(p);
 
   RenderingSetP rs = RenderingSet::GetByKey(*(Key *)p);
+  p += sizeof(Key);
+
+  rs->SetFrameToRender(*(int *)p);
 
   renderer->local_render(renderer, rs);
 
@@ -31,9 +31,11 @@
 
 #include "dtypes.h"
 #include "KeyedObject.h"
+#include "Metrics.h"
 #include "Datasets.h"
 #include "pthread.h"
 #include "Rays.h"
+#include "TraceRays.h"
 #include "Visualization.h"
 #include "Rendering.h"
 #include "RenderingEvents.h"
@@ -44,6 +46,7 @@ namespace gxy
 
 class Camera;
 class RayQManager;
+class ImageOutputQueue;
 class Pixel;
 class RayList;
 
@@ -73,6 +76,8 @@ public:
   float GetEpsilon(); //!< get the epsilon distance for the Renderer to avoid exact comparison in certain tests
 
   RayQManager *GetTheRayQManager() { return rayQmanager; }
+  //! return this Renderer's ImageOutputQueue, starting its writer threads on first use
+  ImageOutputQueue *GetTheImageOutputQueue();
 
   //! load a Renderer object from a Galaxy JSON document
   virtual bool LoadStateFromDocument(rapidjson::Document&);
@@ -123,6 +128,7 @@ public:
 		pthread_mutex_lock(&lock);
 		originated_ray_count += n;
 		pthread_mutex_unlock(&lock);
+		Metrics::Count(Metrics::RAYS_ORIGINATED, n);
 	}
 
   //! Set the maximum number of rays allowed in each RayList
@@ -137,6 +143,25 @@ public:
   //! get permute_pixels
   bool GetPermutePixels() { return permute_pixels; }
 
+  //! how RayLists are ordered before tracing
+  /*! RAYSORT_MEASURE sorts every other RayList so that the per-frame metrics 
+   * report SIMD lane utilization for sorted and unsorted RayLists side by side
+   * \sa RayList::Sort
+   */
+  enum RaySortMode { RAYSORT_OFF, RAYSORT_ON, RAYSORT_MEASURE };
+
+  //! set how RayLists are ordered before tracing (initially set from GXY_RAY_SORT=0|1|measure)
+  void SetRaySortMode(RaySortMode m) { ray_sort_mode = m; }
+
+  //! get how RayLists are ordered before tracing
+  RaySortMode GetRaySortMode() { return ray_sort_mode; }
+
+  //! set how AO ray directions are sampled (initially set from GXY_AO_SEQUENCE=hash|r2|progressive)
+  void SetAOSequence(TraceRays::AOSequence s) { ao_sequence = s; }
+
+  //! get how AO ray directions are sampled
+  TraceRays::AOSequence GetAOSequence() { return ao_sequence; }
+
   // These defines categorize rays after a pass through the tracer
   // TODO: reimplement as enum
   static int TERMINATED;  //!< mark that this ray has been terminated
@@ -183,6 +208,8 @@ private:
 
 	int max_rays_per_packet;
   bool permute_pixels;
+  RaySortMode ray_sort_mode;
+  TraceRays::AOSequence ao_sequence;
 
 	int sent_ray_count;
 	int terminated_ray_count;
@@ -196,6 +223,7 @@ private:
 
   float epsilon;
   RayQManager *rayQmanager;
+  ImageOutputQueue *imageOutputQueue;
 
   pthread_mutex_t lock;
   pthread_cond_t cond; 
@@ -343,15 +371,12 @@ public:
   class RenderMsg : public Work
   {
   public:
-    RenderMsg(Renderer *, RenderingSetP);
+    RenderMsg(Renderer *, RenderingSetP, int frame);
     ~RenderMsg();
 
     WORK_CLASS(RenderMsg, true);
 
     bool Action(int sender);
-
-	private:
-		int frame;
   };
 };
 
@@ -22,6 +22,7 @@
 
 #include "Application.h"
 #include "Camera.h"
+#include "ImageOutputQueue.h"
 #include "ImageWriter.h"
 #include "KeyedObject.h"
 #include "Rays.h"
@@ -38,10 +39,22 @@ namespace gxy
 
 KEYED_OBJECT_CLASS_TYPE(Rendering)
 
+bool Rendering::compositing = false;
+
 void
 Rendering::Register()
 {
   RegisterClass();
+
+  if (getenv("GXY_COMPOSITE") && atoi(getenv("GXY_COMPOSITE")) > 0)
+  {
+#ifdef GXY_WRITE_IMAGES
+    compositing = true;
+#else
+    if (GetTheApplication()->GetRank() == 0)
+      cerr << "WARNING: GXY_COMPOSITE requires a GXY_WRITE_IMAGES build; ignored" << endl;
+#endif
+  }
 }
 
 void
@@ -52,6 +65,10 @@ Rendering::initialize()
   height = -1;
   owner = -1;
   framebuffer = NULL;
+  snapshot_size = 0;
+  tiled = false;
+  fb_row0 = 0;
+  fb_rows = 0;
 	frame = -1;
 
 #ifndef GXY_WRITE_IMAGES
@@ -90,7 +107,7 @@ Rendering::IsLocal()
 
 #define ACCUMULATE_PIXEL(X, Y, R, G, B, O)                            	 \
 {                                                                        \
-	int offset = Y*width + X;																							 \
+	int offset = (Y - fb_row0)*width + X;																	 \
   float *ptr = framebuffer + (offset<<2);                                \
   *ptr++ += R;                                                           \
   *ptr++ += G;                                                           \
@@ -103,7 +120,7 @@ Rendering::IsLocal()
     
 #define ACCUMULATE_PIXEL(f, X, Y, R, G, B, O)                            \
 {     	                                                                 \
-	int offset = Y*width + X;																							 \
+	int offset = (Y - fb_row0)*width + X;																	 \
   float *ptr = framebuffer + (offset<<2);                                \
 	if (kbuffer[offset] < f)																							 \
 	{																																			 \
@@ -218,11 +235,28 @@ Rendering::resolve_lights(RendererP renderer)
 bool
 Rendering::local_commit(MPI_Comm c)
 {
-  if (IsLocal())
+  if (IsTiled())
   {
+    int size = GetTheApplication()->GetSize();
+    int band = (GetTheApplication()->GetRank() - owner + size) % size;
+
     if (framebuffer)
       delete[] framebuffer;
 
+    fb_row0 = tile_start(band);
+    fb_rows = tile_start(band + 1) - fb_row0;
+
+    framebuffer = new float[(fb_rows ? fb_rows : 1)*width*4];
+    memset(framebuffer, 0, fb_rows*width*4*sizeof(float));
+  }
+  else if (IsLocal() || compositing)
+  {
+    if (framebuffer)
+      delete[] framebuffer;
+
+    fb_row0 = 0;
+    fb_rows = height;
+
     framebuffer = new float[width*height*4];
     memset(framebuffer, 0, width*height*4*sizeof(float));
 
@@ -241,14 +275,14 @@ Rendering::local_commit(MPI_Comm c)
 void
 Rendering::local_reset()
 {
-  if (IsLocal())
+  if (IsLocal() || compositing || IsTiled())
   {
     if (! framebuffer)
     {
       cerr << "ERROR: Rendering::local_reset IsLocal but no framebuffer present" << endl;
       exit(1);
     }
-    for (float *p = framebuffer; p < framebuffer + width*height*4; *p++ = 0.0);
+    for (float *p = framebuffer; p < framebuffer + fb_rows*width*4; *p++ = 0.0);
 
 #ifndef GXY_WRITE_IMAGES
 		memset(kbuffer, 0, width*height*sizeof(int));
@@ -256,6 +290,79 @@ Rendering::local_reset()
   }
 }
 
+// Bands are as even as possible; row y is in band (y * size) / height
+
+int
+Rendering::tile_start(int k)
+{
+  int size = GetTheApplication()->GetSize();
+  return (int)(((long)k * height + size - 1) / size);
+}
+
+int
+Rendering::GetTileOwner(int y)
+{
+  if (! IsTiled())
+    return owner;
+
+  int size = GetTheApplication()->GetSize();
+  int band = (int)(((long)y * size) / height);
+  return (owner + band) % size;
+}
+
+float *
+Rendering::GatherTiles(MPI_Comm c)
+{
+  int size = GetTheApplication()->GetSize();
+
+  std::vector<int> counts(size), displacements(size);
+  for (int r = 0; r < size; r++)
+  {
+    int band = (r - owner + size) % size;
+    displacements[r] = tile_start(band) * width * 4;
+    counts[r] = (tile_start(band + 1) - tile_start(band)) * width * 4;
+  }
+
+  float *image = IsLocal() ? new float[width*height*4] : NULL;
+
+  if (size == 1 || ! GetTheApplication()->GetTheMessageManager()->UsingMPI())
+    memcpy(image, framebuffer, width*height*4*sizeof(float));
+  else
+    MPI_Gatherv(framebuffer, fb_rows*width*4, MPI_FLOAT, image, counts.data(), displacements.data(), MPI_FLOAT, owner, c);
+
+  return image;
+}
+
+void
+Rendering::Composite(MPI_Comm c)
+{
+  int size = GetTheApplication()->GetSize();
+  if (size == 1 || ! GetTheApplication()->GetTheMessageManager()->UsingMPI())
+    return;
+
+  // Each process sums one slice of every process' framebuffer, and the 
+  // owner then gathers the slices.   MPI implements the reduce-scatter
+  // by recursive halving, ie. binary swap, for commutative operations.
+
+  int rank  = GetTheApplication()->GetRank();
+  int total = width*height*4;
+
+  std::vector<int> counts(size), displacements(size);
+  for (int i = 0; i < size; i++)
+  {
+    counts[i] = (total / size) + ((i < (total % size)) ? 1 : 0);
+    displacements[i] = i ? displacements[i-1] + counts[i-1] : 0;
+  }
+
+  std::vector<float> slice(counts[rank] ? counts[rank] : 1);
+
+  MPI_Reduce_scatter(framebuffer, slice.data(), counts.data(), MPI_FLOAT, MPI_SUM, c);
+  MPI_Gatherv(slice.data(), counts[rank], MPI_FLOAT, framebuffer, counts.data(), displacements.data(), MPI_FLOAT, owner, c);
+
+  if (! IsLocal())
+    memset(framebuffer, 0, total*sizeof(float));
+}
+
 CameraP Rendering::GetTheCamera() { return camera; }
 void Rendering::SetTheCamera(CameraP c) 
 { 
@@ -269,7 +376,7 @@ void Rendering::SetTheDatasets(DatasetsP ds) { datasets = ds; }
 VisualizationP Rendering::GetTheVisualization() { return visualization; }
 void Rendering::SetTheVisualization(VisualizationP dm) { visualization = dm; }
 
-void Rendering::SaveImage(string filename, int indx, bool asFloat)
+string Rendering::image_name(string filename, int indx)
 {
   if ((strlen(GetTheVisualization()->GetAnnotation()) > 0) || (strlen(GetTheCamera()->GetAnnotation()) > 0))
     filename = filename + GetTheVisualization()->GetAnnotation() + GetTheCamera()->GetAnnotation();
@@ -280,23 +387,59 @@ void Rendering::SaveImage(string filename, int indx, bool asFloat)
     filename = filename + '_' + istr + GetTheVisualization()->GetAnnotation() + GetTheCamera()->GetAnnotation();
   }
 
+  return filename;
+}
+
+void Rendering::SaveImage(string filename, int indx, bool asFloat, float *image)
+{
+  filename = image_name(filename, indx);
+
+  if (! image)
+    image = framebuffer;
+
   if (asFloat)
   {
     FloatImageWriter writer;
-    writer.Write(width, height, framebuffer, filename.c_str());
+    writer.Write(width, height, image, filename.c_str());
   }
   else
   {
     ColorImageWriter writer;
-    writer.Write(width, height, framebuffer, filename.c_str());
+    writer.Write(width, height, image, filename.c_str());
+  }
+}
+
+void Rendering::SaveImageAsync(ImageOutputQueue *queue, string filename, int indx, bool asFloat, float *image)
+{
+  // The snapshot is the second buffer; the framebuffer itself is free to be
+  // reset for the next render as soon as this returns.  A gathered image 
+  // already is a separate buffer.
+
+  shared_ptr<float> rgba;
+  if (image)
+    rgba = shared_ptr<float>(image, default_delete<float[]>());
+  else
+  {
+    // Reuse the last snapshot unless the queue still holds it
+
+    if (! snapshot || snapshot.use_count() > 1 || snapshot_size != width*height)
+    {
+      snapshot = shared_ptr<float>(new float[width*height*4], default_delete<float[]>());
+      snapshot_size = width*height;
+    }
+
+    memcpy(snapshot.get(), framebuffer, width*height*4*sizeof(float));
+    rgba = snapshot;
   }
+
+  queue->Enqueue(width, height, rgba, image_name(filename, indx), asFloat);
 }
 
 int
 Rendering::serialSize()
 {
   // return KeyedObject::serialSize() + 3*sizeof(int) + 4*sizeof(Key);
-  return KeyedObject::serialSize() + 3*sizeof(int) + 3*sizeof(Key);
+  return KeyedObject::serialSize() + 4*sizeof(int) + 3*sizeof(Key);
 }
 
 unsigned char *
@@ -308,6 +451,8 @@ Rendering::serialize(unsigned char *p)
   p += sizeof(int);
   *(int *)p = height;
   p += sizeof(int);
+  *(int *)p = tiled ? 1 : 0;
+  p += sizeof(int);
   *(Key *)p = GetTheVisualization()->getkey();
   p += sizeof(Key);
   *(Key *)p = GetTheCamera()->getkey();
@@ -326,6 +471,8 @@ Rendering::deserialize(unsigned char *p)
   p += sizeof(int);
   height = *(int *)p;
   p += sizeof(int);
+  tiled = *(int *)p != 0;
+  p += sizeof(int);
   visualization = Visualization::GetByKey(*(Key *)p);
   p += sizeof(Key);
   camera = Camera::GetByKey(*(Key *)p);
@@ -43,6 +43,8 @@
 namespace gxy
 {
 
+class ImageOutputQueue;
+
 OBJECT_POINTER_TYPES(Rendering)
 
 class Ray;
@@ -89,6 +91,8 @@ public:
 	{
 		if (framebuffer) delete[] framebuffer;
 		framebuffer = new float[width * height * 4];
+		fb_row0 = 0;
+		fb_rows = height;
 #ifndef GXY_WRITE_IMAGES
 		if (kbuffer) delete[] kbuffer;
 #endif
@@ -103,12 +107,67 @@ public:
 	virtual void AddLocalPixels(Pixel *p, int n, int f, int sender = -1);	// Add to local FB from received send buffer
 
 	bool IsLocal(); //!< returns true if the calling process owns this Rendering (i.e. if the process rank matches the owner tag)
-	void SaveImage(std::string, int, bool asFloat); //!< save the current framebuffer to a color or float image file using the given filename base and index increment
+	//! save the current framebuffer (or the given full image) to a color or float image file using the given filename base and index increment
+	void SaveImage(std::string, int, bool asFloat, float *image = NULL);
+	//! copy the current framebuffer and queue it to be written by the given ImageOutputQueue; a given full image is queued without copying, and is freed by the queue
+	/*! The copy goes to a second buffer that is kept and reused once the queue has written it
+	 */
+	void SaveImageAsync(ImageOutputQueue *, std::string, int, bool asFloat, float *image = NULL);
 
 	virtual int serialSize(); //!< returns the size in bytes for the serialization of this Rendering
 	virtual unsigned char *serialize(unsigned char *); //!< serialize this Rendering to the given byte array
 	virtual unsigned char *deserialize(unsigned char *); //!< deserialize a Rendering from the given byte array into this Rendering
 
+	//! split (or not) the framebuffer of this Rendering into tiles owned by different processes
+	/*! A tiled Rendering's framebuffer is divided into horizontal bands, one per
+	 * process, starting with the owner at the top.   Each process holds only its
+	 * own band, terminated rays are sent to the process owning their pixel's band,
+	 * and the bands are only gathered into a full image on the owner when images
+	 * are saved.   This spreads the memory and pixel traffic of large images 
+	 * across the processes.   Only available in GXY_WRITE_IMAGES builds, and 
+	 * ignored when compositing is on.   Must be set before the Rendering is committed.
+	 */
+	void SetTiled(bool t) { tiled = t; }
+
+	//! return whether the framebuffer of this Rendering is split into tiles
+	bool IsTiled()
+	{
+#ifdef GXY_WRITE_IMAGES
+		return tiled && !compositing;
+#else
+		return false;
+#endif
+	}
+
+	//! return the process that holds pixel row `y` of this Rendering's framebuffer
+	int GetTileOwner(int y);
+
+	//! gather the tiles of a tiled Rendering into a full image on its owner
+	/*! Collective over `c`.   Returns a new[]'d width x height RGBA image on the 
+	 * owner (which the caller is responsible for) and NULL elsewhere.
+	 */
+	float *GatherTiles(MPI_Comm c);
+
+	//! turn sort-last compositing on or off (initially set from GXY_COMPOSITE)
+	/*! By default each terminated ray is shipped as a Pixel to the process 
+	 * that owns its Rendering.   With compositing on, every process 
+	 * accumulates the rays that terminate there into a full-size framebuffer 
+	 * of its own, and when the RenderingSet's frame is complete the partial
+	 * framebuffers are summed into the owner's by a reduce-scatter and gather
+	 * (see Composite).   Since contributions are additive this gives the same
+	 * image while sending each process' image once rather than every pixel 
+	 * contribution.   Only available in GXY_WRITE_IMAGES builds, which know 
+	 * when a frame is complete; must be set the same on every process.
+	 */
+	static void SetCompositing(bool c) { compositing = c; }
+	//! return whether sort-last compositing is on
+	static bool GetCompositing() { return compositing; }
+
+	//! sum the partial framebuffers of all processes into the owner's framebuffer
+	/*! Collective over `c`; non-owners' framebuffers are cleared for the next frame
+	 */
+	void Composite(MPI_Comm c);
+
 	//! return a pointer to the framebuffer for this Rendering
 	float *GetPixels() { return framebuffer; }
 	//! return a pointer to the Lighting singleton for this rendering
@@ -117,9 +176,21 @@ public:
 	void resolve_lights(RendererP);
 	
 protected:
+	std::string image_name(std::string, int);
+
 	Lighting lights;
 	int frame;
 
+	static bool compositing;
+
+	// Whether the framebuffer is split across processes, and the rows of 
+	// the image this process' framebuffer holds
+
+	bool tiled;
+	int fb_row0, fb_rows;
+
+	int tile_start(int k); 		// first row of the k'th band
+
 	VisualizationP visualization;
 	CameraP    		 camera;
 	DatasetsP  		 datasets;
@@ -132,6 +203,11 @@ protected:
   int *kbuffer;
 #endif
 
+	// The framebuffer copy most recently queued by SaveImageAsync
+
+	std::shared_ptr<float> snapshot;
+	int snapshot_size;
+
 	int width, height;
 };
 
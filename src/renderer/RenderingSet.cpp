@@ -19,7 +19,10 @@
 // ========================================================================== //
 
 #include "Application.h"
+#include "Metrics.h"
+#include "ImageOutputQueue.h"
 #include "RayQManager.h"
+#include "Renderer.h"
 #include "RenderingSet.h"
 
 using namespace std;
@@ -28,12 +31,19 @@ namespace gxy
 {
 
 WORK_CLASS_TYPE(RenderingSet::SaveImagesMsg);
+WORK_CLASS_TYPE(RenderingSet::FlushImagesMsg);
+WORK_CLASS_TYPE(RenderingSet::EpochMsg);
 
 #ifdef GXY_WRITE_IMAGES
 WORK_CLASS_TYPE(RenderingSet::PropagateStateMsg);
 WORK_CLASS_TYPE(RenderingSet::SynchronousCheckMsg);
 WORK_CLASS_TYPE(RenderingSet::ResetMsg);
 WORK_CLASS_TYPE(RenderingSet::DumpStateMsg);
+WORK_CLASS_TYPE(RenderingSet::WaveMsg);
+WORK_CLASS_TYPE(RenderingSet::WaveReplyMsg);
+WORK_CLASS_TYPE(RenderingSet::WaveDoneMsg);
+
+bool RenderingSet::wave_termination = false;
 #endif // GXY_WRITE_IMAGES
 
 KEYED_OBJECT_CLASS_TYPE(RenderingSet)
@@ -44,12 +54,20 @@ RenderingSet::Register()
   RegisterClass();
 
 	SaveImagesMsg::Register();
+	FlushImagesMsg::Register();
+	EpochMsg::Register();
 
 #ifdef GXY_WRITE_IMAGES
 	PropagateStateMsg::Register();
 	SynchronousCheckMsg::Register();
 	ResetMsg::Register();
 	DumpStateMsg::Register();
+	WaveMsg::Register();
+	WaveReplyMsg::Register();
+	WaveDoneMsg::Register();
+
+	if (getenv("GXY_TERMINATION"))
+		wave_termination = std::string(getenv("GXY_TERMINATION")) == "wave";
 #endif // GXY_WRITE_IMAGES
 }
 
@@ -60,6 +78,7 @@ RenderingSet::~RenderingSet()
 	pthread_mutex_destroy(&lck);
 	pthread_cond_destroy(&w8);
 	pthread_mutex_destroy(&local_lock);
+	pthread_mutex_destroy(&wave_lock);
 #endif // GXY_WRITE_IMAGES
 }
 
@@ -81,6 +100,7 @@ RenderingSet::initialize()
 
 	current_frame = -1;
 	next_frame = 0;
+	started_frame = 0;
 
 #ifdef GXY_WRITE_IMAGES
 
@@ -108,6 +128,13 @@ RenderingSet::initialize()
   local_raylist_count  = 0;
   local_inflight_count  = 0;
 
+	pthread_mutex_init(&wave_lock, NULL);
+	ray_lists_sent = ray_lists_received = 0;
+	wave_active = false;
+	wave_id = 0;
+	wave_pending = 0;
+	last_wave_sent = last_wave_received = -1;
+
 	local_reset();
 
 #ifdef GXY_PRODUCE_STATUS_MESSAGES
@@ -320,8 +347,13 @@ RenderingSet::CheckLocalState()
       GetTheEventTracker()->Add(new CheckStateActionEvent(CheckStateActionEvent::INIT_SYNC_CHECK));
 #endif
 
-			SynchronousCheckMsg *msg = new SynchronousCheckMsg(getkey());
-			msg->Broadcast(true, true);
+			if (wave_termination)
+				StartWave();
+			else
+			{
+				SynchronousCheckMsg *msg = new SynchronousCheckMsg(getkey());
+				msg->Broadcast(true, true);
+			}
     }
     else if (parent != -1)
     {
@@ -472,6 +504,207 @@ RenderingSet::DecrementRayListCount()
 	pthread_mutex_unlock(&local_lock);
 }
 
+void
+RenderingSet::CountRayListSent()
+{
+	pthread_mutex_lock(&local_lock);
+	ray_lists_sent++;
+	pthread_mutex_unlock(&local_lock);
+}
+
+void
+RenderingSet::CountRayListReceived()
+{
+	pthread_mutex_lock(&local_lock);
+	ray_lists_received++;
+	pthread_mutex_unlock(&local_lock);
+}
+
+void
+RenderingSet::Composite(MPI_Comm c)
+{
+	if (Rendering::GetCompositing())
+		for (auto r : renderings)
+			r->Composite(c);
+}
+
+void
+RenderingSet::StartWave()
+{
+	pthread_mutex_lock(&wave_lock);
+
+	// If a wave is already out, it'll be followed by another if the root 
+	// still thinks everything is idle when it completes
+
+	if (wave_active)
+	{
+		pthread_mutex_unlock(&wave_lock);
+		return;
+	}
+
+	wave_active = true;
+	int id = ++wave_id;
+
+	pthread_mutex_unlock(&wave_lock);
+
+	BeginWave(id);
+}
+
+void
+RenderingSet::BeginWave(int id)
+{
+	pthread_mutex_lock(&wave_lock);
+
+	wave_id       = id;
+	wave_pending  = ((left_id != -1) ? 1 : 0) + ((right_id != -1) ? 1 : 0);
+	wave_sent     = 0;
+	wave_received = 0;
+	wave_busy     = false;
+
+	bool leaf = wave_pending == 0;
+
+	pthread_mutex_unlock(&wave_lock);
+
+	if (leaf)
+		CompleteWave();
+	else
+	{
+		if (left_id != -1)
+		{
+			WaveMsg msg(this, id);
+			msg.Send(left_id);
+		}
+
+		if (right_id != -1)
+		{
+			WaveMsg msg(this, id);
+			msg.Send(right_id);
+		}
+	}
+}
+
+void
+RenderingSet::WaveReply(int id, long s, long r, bool b)
+{
+	pthread_mutex_lock(&wave_lock);
+
+	// Replies to superseded waves are dropped
+
+	if (id != wave_id || wave_pending == 0)
+	{
+		pthread_mutex_unlock(&wave_lock);
+		return;
+	}
+
+	wave_sent     += s;
+	wave_received += r;
+	wave_busy     = wave_busy || b;
+
+	bool complete = --wave_pending == 0;
+
+	pthread_mutex_unlock(&wave_lock);
+
+	if (complete)
+		CompleteWave();
+}
+
+void
+RenderingSet::CompleteWave()
+{
+	// Add in this process' state as of now, after all the children have 
+	// answered.
+
+	pthread_mutex_lock(&local_lock);
+	long s = ray_lists_sent;
+	long r = ray_lists_received;
+	bool b = (local_raylist_count != 0) || CameraIsActive();
+	pthread_mutex_unlock(&local_lock);
+
+	pthread_mutex_lock(&wave_lock);
+
+	int  id = wave_id;
+	long S  = wave_sent + s;
+	long R  = wave_received + r;
+	bool B  = wave_busy || b;
+
+	if (parent != -1)
+	{
+		pthread_mutex_unlock(&wave_lock);
+
+		WaveReplyMsg msg(this, id, S, R, B);
+		msg.Send(parent);
+		return;
+	}
+
+	// On the root.  Rendering is complete if this wave and the one before it 
+	// found every process idle and the same number of ray lists sent and received.
+	// The first idle, balanced wave just arms the check; a message in flight 
+	// during it would have to show up as a change in the counts in the second.
+
+	bool done = !B && S == R && S == last_wave_sent && R == last_wave_received;
+
+	if (!B && S == R)
+		last_wave_sent = S, last_wave_received = R;
+	else
+		last_wave_sent = last_wave_received = -1;
+
+	wave_active = false;
+
+	pthread_mutex_unlock(&wave_lock);
+
+	if (done)
+	{
+		pthread_mutex_lock(&wave_lock);
+		last_wave_sent = last_wave_received = -1;
+		pthread_mutex_unlock(&wave_lock);
+
+		WaveDoneMsg *msg = new WaveDoneMsg(getkey());
+		msg->Broadcast(true, true);
+	}
+	else if (! last_busy)
+	{
+		// The root still thinks everything is idle, so nothing else will
+		// prompt another wave
+
+		StartWave();
+	}
+}
+
+bool
+RenderingSet::WaveMsg::Action(int sender)
+{
+	unsigned char *ptr = (unsigned char *)contents->get();
+	RenderingSetP rs = GetByKey(*(Key *)ptr);
+	if (rs)
+		rs->BeginWave(*(int *)(ptr + sizeof(Key)));
+	return false;
+}
+
+bool
+RenderingSet::WaveReplyMsg::Action(int sender)
+{
+	reply *rp = (reply *)contents->get();
+	RenderingSetP rs = GetByKey(rp->rskey);
+	if (rs)
+		rs->WaveReply(rp->id, rp->sent, rp->received, rp->busy);
+	return false;
+}
+
+bool
+RenderingSet::WaveDoneMsg::CollectiveAction(MPI_Comm c, bool isRoot)
+{
+	RenderingSetP rs = GetByKey(*(Key *)contents->get());
+	if (rs)
+	{
+		rs->first_async_completion_test_done = true;
+		rs->Composite(c);
+		rs->Lock();
+		rs->Finalize();
+		rs->Unlock();
+	}
+	return false;
+}
+
 void
 RenderingSet::CheckGlobalState()
 {
@@ -504,6 +737,7 @@ RenderingSet::SynchronousCheckMsg::CollectiveAction(MPI_Comm c, bool isRoot)
   // if (global_counts[0] == 0 && (global_counts[1] == global_counts[2]) && global_counts[3] == 0)
   if (global_counts[0] == 0 && global_counts[3] == 0)
 	{
+		rs->Composite(c);
 		rs->Finalize();
   }
   else
@@ -638,16 +872,32 @@ RenderingSet::serialize(unsigned char *ptr)
 void
 RenderingSet::SaveImages(string basename, bool asFloat)
 {
-	SaveImagesMsg *msg = new SaveImagesMsg(this, basename, asFloat);
+	SaveImagesMsg *msg = new SaveImagesMsg(this, -1, basename, asFloat);
 	msg->Broadcast(true, true);
 }
 
-RenderingSet::SaveImagesMsg::SaveImagesMsg(RenderingSet *r, string basename, bool asFloat) 
-		: SaveImagesMsg(sizeof(Key) + sizeof(bool) + basename.length() + 1)
+void
+RenderingSet::SaveImagesAsync(RendererP renderer, string basename, bool asFloat)
+{
+	SaveImagesMsg *msg = new SaveImagesMsg(this, renderer->getkey(), basename, asFloat);
+	msg->Broadcast(true, true);
+}
+
+void
+RenderingSet::FlushImages(RendererP renderer)
+{
+	FlushImagesMsg msg(renderer.get());
+	msg.Broadcast(true, true);
+}
+
+RenderingSet::SaveImagesMsg::SaveImagesMsg(RenderingSet *r, Key renderer, string basename, bool asFloat) 
+		: SaveImagesMsg(2*sizeof(Key) + sizeof(bool) + basename.length() + 1)
 {
 	unsigned char *p = (unsigned char *)contents->get();
 	*(Key *)p = r->getkey();
 	p += sizeof(Key);
+	*(Key *)p = renderer;
+	p += sizeof(Key);
 	*(bool *)p = asFloat;
 	p += sizeof(bool);
 	memcpy(p, basename.c_str(), basename.length()+1);
@@ -659,19 +909,59 @@ RenderingSet::SaveImagesMsg::CollectiveAction(MPI_Comm c, bool isRoot)
 	char *ptr = (char *)contents->get();
 	Key key = *(Key *)ptr;
 	ptr += sizeof(Key);
+	Key rkey = *(Key *)ptr;
+	ptr += sizeof(Key);
   bool asFloat = *(bool *)ptr;
   ptr += sizeof(bool);
 	string basename(ptr);
 
 	RenderingSetP rs = GetByKey(key);
+
+	// Asynchronous saves go to the renderer's queue.  Bound the pending
+	// snapshots to one set by finishing the previous set first
+
+	ImageOutputQueue *queue = NULL;
+	if (rkey != -1)
+	{
+		queue = Renderer::GetByKey(rkey)->GetTheImageOutputQueue();
+		queue->Wait();
+	}
 	
 	for (int i = 0; i < rs->GetNumberOfRenderings(); i++)
-		if (rs->GetRendering(i)->IsLocal())
-			rs->GetRendering(i)->SaveImage(basename, i, asFloat);
+	{
+		RenderingP r = rs->GetRendering(i);
+
+		// Tiled renderings are only assembled now, on the owner
+
+		float *image = r->IsTiled() ? r->GatherTiles(c) : NULL;
+
+		if (r->IsLocal())
+		{
+			if (queue)
+				r->SaveImageAsync(queue, basename, i, asFloat, image);
+			else
+			{
+				r->SaveImage(basename, i, asFloat, image);
+				if (image) delete[] image;
+			}
+		}
+	}
 
 	return false;
 }
 
+RenderingSet::FlushImagesMsg::FlushImagesMsg(Renderer *renderer) : FlushImagesMsg(sizeof(Key))
+{
+	*(Key *)contents->get() = renderer->getkey();
+}
+
+bool
+RenderingSet::FlushImagesMsg::CollectiveAction(MPI_Comm c, bool isRoot)
+{
+	Renderer::GetByKey(*(Key *)contents->get())->GetTheImageOutputQueue()->Wait();
+	return false;
+}
+
 #ifdef GXY_WRITE_IMAGES
 
 RenderingSet::ResetMsg::ResetMsg(RenderingSet *r) : ResetMsg(sizeof(Key))
@@ -733,6 +1023,7 @@ RenderingSet::Enqueue(RayList *rl, bool silent)
 	else
 	{
 		// cerr << "RenderingSet::Enqueue: dropping ray list from wrong frame" << endl;
+		Metrics::Count(Metrics::RAYS_DROPPED_STALE, rl->GetRayCount());
 		delete rl;
 	}
 }
@@ -740,7 +1031,7 @@ RenderingSet::Enqueue(RayList *rl, bool silent)
 int
 RenderingSet::NeedInitialRays()
 {
-	if (IsActive(++next_frame))
+	if (IsActive(next_frame))
 		return next_frame;
 	else
 		return -1;
@@ -749,15 +1040,40 @@ RenderingSet::NeedInitialRays()
 bool 
 RenderingSet::IsActive(int fnum)
 {
-	if (fnum > current_frame)
-		current_frame = fnum;
-#if 0
-	return fnum == current_frame;
-#else
+	int cur = current_frame;
+	while (fnum > cur && !current_frame.compare_exchange_weak(cur, fnum));
+
+#ifdef GXY_WRITE_IMAGES
 	return  true;
+#else
+	return fnum >= current_frame;
 #endif
 }
 
+void
+RenderingSet::AdvanceEpoch(int fnum)
+{
+	EpochMsg msg(this, fnum);
+	msg.Broadcast(true, false);
+}
+
+RenderingSet::EpochMsg::EpochMsg(RenderingSet *r, int fnum) : EpochMsg(sizeof(Key) + sizeof(int))
+{
+	unsigned char *p = (unsigned char *)contents->get();
+	*(Key *)p = r->getkey();
+	*(int *)(p + sizeof(Key)) = fnum;
+}
+
+bool
+RenderingSet::EpochMsg::CollectiveAction(MPI_Comm c, bool isRoot)
+{
+	unsigned char *p = (unsigned char *)contents->get();
+	RenderingSetP rs = RenderingSet::GetByKey(*(Key *)p);
+	if (rs)
+		rs->IsActive(*(int *)(p + sizeof(Key)));
+	return false;
+}
+
 #ifdef GXY_WRITE_IMAGES
 
 #ifdef GXY_PRODUCE_STATUS_MESSAGES
@@ -25,6 +25,7 @@
  * \ingroup render
  */
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -74,6 +75,16 @@ public:
 	//! save images for this RenderingSet using the supplied base name for the image files.  If asFLoat is true, then save four-channel fload images in fits format; otherwise, write a png color image.
 	void SaveImages(std::string basename, bool asFloat=false); 
 
+	//! as SaveImages, but each owner copies its framebuffers and queues them on the renderer's ImageOutputQueue rather than writing them before returning
+	/*! Any images queued by a previous SaveImagesAsync are written first, so at most one set 
+	 * of snapshots is pending per process.
+	 * \sa FlushImages
+	 */
+	void SaveImagesAsync(RendererP renderer, std::string basename, bool asFloat=false); 
+
+	//! wait on all processes until every image queued on the renderer's ImageOutputQueue has been written
+	static void FlushImages(RendererP renderer);
+
 	//! Add the given RayList to be processed against this RenderingSet
 	/*! Add a raylist to the queue of raylists to be processed
 	 * Go through the RenderingSet so we can manage the number
@@ -138,6 +149,24 @@ public:
 	 * process' RayQ so it needs to be accessible.
 	 */
 	void IncrementRayListCount(bool silent = false);
+
+	//! count a ray list sent to another process, for wave termination detection
+	void CountRayListSent();
+	//! count a ray list received from another process, for wave termination detection
+	void CountRayListReceived();
+
+	//! select how the root detects that rendering is complete
+	/*! By default, when the root's view of the busy/idle tree goes idle it broadcasts
+	 * a SynchronousCheckMsg that does an MPI_Allreduce of the global state.   If 
+	 * waves are selected (or GXY_TERMINATION=wave is set in the environment) the 
+	 * root instead sends a four-counter wave down the process tree: each process 
+	 * reports the number of ray lists it has sent and received and whether it is 
+	 * busy, and rendering is complete when two consecutive waves find everyone 
+	 * idle with identical, matching totals.   Only the root's setting matters.
+	 */
+	static void SetWaveTermination(bool w) { wave_termination = w; }
+	//! return whether termination is detected using four-counter waves
+	static bool GetWaveTermination() { return wave_termination; }
 	//! set initial state to begin rendering this RenderingSet
 	void SetInitialState(int local_ray_count, int left_state, int right_state);
 	//! return parent, left and right ids in the process tree
@@ -216,6 +245,22 @@ protected:
 	// that the whole ball of wax might be done.   Calls the synchronous test
 
 	void CheckGlobalState();
+
+	// If sort-last compositing is on, composite each Rendering's partial
+	// framebuffers into its owner's.   Collective; called on frame completion.
+
+	void Composite(MPI_Comm c);
+
+	// Four-counter wave termination detection.  StartWave is called on the
+	// root; BeginWave passes a wave to a process' children (or answers it 
+	// immediately if it has none), WaveReply accumulates a child's answer and
+	// CompleteWave answers the parent - or, on the root, decides whether 
+	// rendering is complete.
+
+	void StartWave();
+	void BeginWave(int id);
+	void WaveReply(int id, long sent, long received, bool busy);
+	void CompleteWave();
 	
 	int get_local_raylist_count() { return local_raylist_count; }
 	void get_local_raylist_count(int &k) { k = local_raylist_count; }
@@ -238,27 +283,43 @@ public:
 	//! return the current frame being rendered in this RenderingSet
 	int  GetCurrentFrame() { return current_frame; }
 
-  //! set the the next frame to render
-  void SetRenderFrame(int n) { next_frame = n; }
+  //! set the number of the last frame rendered; the next Start renders frame n+1
+  void SetRenderFrame(int n) { next_frame = n; started_frame = n; }
+
+	//! assign the number of a new frame.  Called on the root by Renderer::Start
+	int StartFrame() { return ++started_frame; }
+
+	//! set the frame the next local render is for, as carried by the RenderMsg
+	void SetFrameToRender(int n) { next_frame = n; }
 
 	//! returns the frame number of the next frame to render, or -1 if no next frame exists
 	/*! Called from Renderer::localRendering.  We won't generate initial rays
 	 * for is call to localRendering IF we've already seen a ray list from a 
 	 * subsequent frame and NeedInitialRays will return -1.   Otherwise, 
-	 * NeedInitialRays returns the new frame number;
+	 * NeedInitialRays returns the frame number set by SetFrameToRender;
 	 */
 	int  NeedInitialRays();
 
 	//! returns whether the given frame number is an active frame for this RenderingSet
 	/*! Returns true of false depending on whether fnum is an active frame.
-	 * Just what an active frame is depends.   If we are in asyncronous mode,
-	 * we might consider only the latest frame active - in which case, if 
-	 * fnum > current_frame, then current_frame gets bumped and we return 
-	 * fnum == current_frame.   If we don't want ALL frames to be considered
-	 * active we just return true.
+	 * If fnum > current_frame, then current_frame gets bumped.   In interactive
+	 * rendering only the latest frame is active, so work belonging to a superseded
+	 * frame can be dropped.   When writing images (GXY_WRITE_IMAGES) each frame
+	 * runs to completion and every ray list must be accounted for, so ALL frames
+	 * are considered active and we just return true.
 	 */
 	bool IsActive(int fnum);
 
+	//! announce to all processes that frame `fnum` supersedes all earlier frames
+	/*! Broadcasts a small collective EpochMsg, without waiting for it, that is 
+	 * handled in each process' messaging thread as soon as it arrives rather 
+	 * than queueing behind the ray traffic of the frame it cancels.
+	 */
+	void AdvanceEpoch(int fnum);
+
+	//! return the number of the last frame for which initial rays were requested
+	int GetRenderFrame() { return next_frame; }
+
   //! Set the datasets this rendering set will refer to
   void SetTheDatasets(DatasetsP d) { datasets = d; }
   
@@ -270,14 +331,26 @@ private:
   DatasetsP datasets;
   std::map<Key, OsprayObjectP> ospray_object_map;
 
-	int current_frame;
+	std::atomic<int> current_frame;
 	int next_frame;
+	std::atomic<int> started_frame;
   int spawnedRayCount;
 
+  class EpochMsg : public Work
+  {
+  public:
+		EpochMsg(RenderingSet *r, int fnum);
+
+    WORK_CLASS(EpochMsg, true);
+
+  public:
+    bool CollectiveAction(MPI_Comm c, bool);
+  };
+
   class SaveImagesMsg : public Work
   {
   public:
-		SaveImagesMsg(RenderingSet *r, std::string basename, bool isFloat);
+		SaveImagesMsg(RenderingSet *r, Key renderer, std::string basename, bool isFloat);
 
     WORK_CLASS(SaveImagesMsg, true);
 
@@ -285,6 +358,17 @@ private:
     bool CollectiveAction(MPI_Comm c, bool);
   };
 
+  class FlushImagesMsg : public Work
+  {
+  public:
+		FlushImagesMsg(Renderer *renderer);
+
+    WORK_CLASS(FlushImagesMsg, true);
+
+  public:
+    bool CollectiveAction(MPI_Comm c, bool);
+  };
+
 #ifdef GXY_WRITE_IMAGES
 
 	bool done;
@@ -303,6 +387,81 @@ private:
 	pthread_mutex_t lck;
 	pthread_cond_t w8;
 
+	static bool wave_termination;
+
+	// Cumulative counts of ray lists exchanged with other processes.  These are 
+	// never reset, since a process may receive the next frame's rays before it 
+	// learns the previous frame is complete; they balance at every termination.
+
+	long ray_lists_sent, ray_lists_received;
+
+	pthread_mutex_t wave_lock;
+	bool wave_active;										// root: a wave is out
+	int  wave_id;												// current wave
+	int  wave_pending;									// replies still expected from children
+	long wave_sent, wave_received;			// subtree totals for the current wave
+	bool wave_busy;
+	long last_wave_sent;								// root: totals from the previous wave, or -1
+	long last_wave_received;
+
+  class WaveMsg : public Work
+  {
+  public:
+    WaveMsg(RenderingSet *rs, int id) : WaveMsg(sizeof(Key) + sizeof(int))
+    {
+			unsigned char *ptr = (unsigned char *)contents->get();
+      *(Key *)ptr = rs->getkey();
+      *(int *)(ptr + sizeof(Key)) = id;
+    }
+
+    WORK_CLASS(WaveMsg, false);
+
+  public:
+    bool Action(int sender);
+  };
+
+  class WaveReplyMsg : public Work
+  {
+		struct reply
+		{
+			Key  rskey;
+			int  id;
+			long sent;
+			long received;
+			bool busy;
+		};
+
+  public:
+    WaveReplyMsg(RenderingSet *rs, int id, long s, long r, bool b) : WaveReplyMsg(sizeof(reply))
+    {
+			reply *rp = (reply *)contents->get();
+			rp->rskey    = rs->getkey();
+			rp->id       = id;
+			rp->sent     = s;
+			rp->received = r;
+			rp->busy     = b;
+    }
+
+    WORK_CLASS(WaveReplyMsg, false);
+
+  public:
+    bool Action(int sender);
+  };
+
+  class WaveDoneMsg : public Work
+  {
+  public:
+		WaveDoneMsg(Key k) : WaveDoneMsg(sizeof(Key))
+		{
+			*(Key *)contents->get() = k;
+		}
+
+    WORK_CLASS(WaveDoneMsg, true);
+
+  public:
+    bool CollectiveAction(MPI_Comm c, bool);
+  };
+
   class PropagateStateMsg : public Work
   {
   public:
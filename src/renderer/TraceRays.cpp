@@ -65,81 +65,43 @@ TraceRays::destroy_ispc()
   ispc::TraceRays_destroy(GetIspc());
 }
 
+void
+TraceRays::SetAOSequence(AOSequence s)
+{
+  ispc::TraceRays_SetAOSequence(GetIspc(), (int)s);
+}
+
+int
+TraceRays::GetSampleCount()
+{
+  return ispc::TraceRays_GetSampleCount(GetIspc());
+}
+
+int
+TraceRays::GetLaneSlots()
+{
+  return ispc::TraceRays_GetLaneSlots(GetIspc());
+}
+
 RayList *
 TraceRays::Trace(Lighting* lights, VisualizationP visualization, RayList *raysIn)
 {
   ispc::TraceRays_TraceRays(GetIspc(), visualization->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), epsilon);
 	RayList *raysOut = NULL;
 
-	int nl, *t; float *l;
-	lights->GetLights(nl, l, t);
-
-	int *ao_offsets = new int[raysIn->GetRayCount()];
-	int *shadow_offsets = new int[raysIn->GetRayCount()];
-
-  int nAO; float aoRadius;
-  lights->GetAO(nAO, aoRadius);
-          
-  bool do_shadows;
-  lights->GetShadowFlag(do_shadows);
-  
-  int nLights; float *lightVectors; int *types;
-  lights->GetLights(nLights, lightVectors, types);
-
-	int nOutputRays = 0; 
-	for (int i = 0; i < raysIn->GetRayCount(); i++)
-	{
-		ao_offsets[i] = nOutputRays;
-
-		if (raysIn->get_type(i) == RAY_PRIMARY)
-		{
-			if (raysIn->get_term(i) & RAY_SURFACE)
-				nOutputRays += nAO;
-		}
-	}
-
-	int ao_ray_knt = nOutputRays;
-
-	if (do_shadows)
-	{
-		for (int i = 0; i < raysIn->GetRayCount(); i++)
-		{
-			if ((raysIn->get_type(i) == RAY_PRIMARY) && (raysIn->get_term(i) & RAY_SURFACE))
-			{
-				shadow_offsets[i] = nOutputRays;
-				nOutputRays += (do_shadows ? nLights : 0);
-			}
-			else
-				shadow_offsets[i] = -1;
-		}
-	}
-
-	int shadow_ray_knt = nOutputRays - ao_ray_knt;
+	// The offsets of each input ray's secondary rays in the output list are
+	// kept in a per-thread buffer that only grows, rather than allocated per call
+
+	static thread_local std::vector<int> offsets;
+	if (offsets.size() < (size_t)raysIn->GetRayCount())
+		offsets.resize(raysIn->GetRayCount());
+
+	int nOutputRays = ispc::TraceRays_secondaryRayOffsets(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), offsets.data());
 
   if (nOutputRays)
-  {
     raysOut = new RayList(raysIn->GetTheRenderer(), raysIn->GetTheRenderingSet(), raysIn->GetTheRendering(), nOutputRays, raysIn->GetFrame(), RayList::SECONDARY);
-  }
-  
-#ifdef GXY_REVERSE_LIGHTING
-	ispc::TraceRays_ambientLighting(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(),  raysIn->GetIspc());
-	if (ao_ray_knt)
-		ispc::TraceRays_generateAORays(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), ao_offsets, raysOut->GetIspc(), epsilon);
-	
-	ispc::TraceRays_diffuseLighting(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc());
-	if (shadow_ray_knt)
-		ispc::TraceRays_generateShadowRays(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), shadow_offsets, raysOut->GetIspc(), epsilon);
-#else
-	if (ao_ray_knt)
-		ispc::TraceRays_generateAORays(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), ao_offsets, raysOut->GetIspc(), epsilon);
-	else
-		ispc::TraceRays_ambientLighting(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(),  raysIn->GetIspc());
-	
-	if (shadow_ray_knt)
-		ispc::TraceRays_generateShadowRays(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), shadow_offsets, raysOut->GetIspc(), epsilon);
-	else
-		ispc::TraceRays_diffuseLighting(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc());
-#endif
+
+	ispc::TraceRays_shadeSurfaces(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), offsets.data(), raysOut ? raysOut->GetIspc() : NULL, epsilon, raysIn->GetFrame());
 
 	return raysOut;
 
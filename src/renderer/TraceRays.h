@@ -50,6 +50,18 @@ public:
   TraceRays(float epsilon = 0.001);
   ~TraceRays(); //!< default destructor
 
+  //! how the directions of AO rays are sampled
+  /*! AO_HASH is the original 8-bit hash of pixel and AO ray index into fixed
+   * tables.   AO_R2 uses the R2 low-discrepancy sequence with a per-pixel 
+   * Cranley-Patterson rotation, so AO converges with fewer rays.   AO_PROGRESSIVE
+   * is AO_R2 with each frame continuing the sequence from the previous one, for
+   * progressive accumulation across frames.
+   */
+  enum AOSequence { AO_HASH, AO_R2, AO_PROGRESSIVE };
+
+  //! set how the directions of AO rays are sampled (default AO_HASH)
+  void SetAOSequence(AOSequence s);
+
   //! trace a given RayList against the given Visualization using the given Lighting
   /*! \returns a RayList pointer to rays spawned during this trace
    * \param lights a pointer to the Lighting object to use during this trace
@@ -58,6 +70,14 @@ public:
    */
   RayList *Trace(Lighting* lights, VisualizationP visualization, RayList * raysIn);
 
+  //! return the number of volume sample points taken by Trace calls on this tracer
+  int GetSampleCount();
+
+  //! return the number of SIMD lane-steps available while marching rays in Trace calls on this tracer
+  /*! GetSampleCount() / GetLaneSlots() is the SIMD lane utilization of the ray marching loop
+   */
+  int GetLaneSlots();
+
 protected:
   virtual void allocate_ispc();
   virtual void initialize_ispc();
@@ -145,6 +145,47 @@ Vis::LoadFromJSON(Value& v)
 	}
 }
 
+vector<unsigned char>
+Vis::SaveState()
+{
+  vector<unsigned char> state(sizeof(int) + serialSize());
+  *(int *)state.data() = dirty;
+  serialize(state.data() + sizeof(int));
+  return state;
+}
+
+void
+Vis::RestoreState(vector<unsigned char>& state)
+{
+  deserialize(state.data() + sizeof(int));
+  dirty = *(int *)state.data();
+}
+
+bool
+Vis::UpdateFromJSON(Value& v)
+{
+  vector<unsigned char> before = SaveState();
+
+  Key k = datakey;
+  if (! LoadFromJSON(v))
+  {
+    RestoreState(before);
+    return false;
+  }
+  datakey = k;
+
+  // LoadFromJSON may go through setters that mark groups dirty whether or
+  // not they changed; only a real change counts
+
+  dirty = *(int *)before.data();
+  vector<unsigned char> after = SaveState();
+
+  if (before != after)
+    mark_dirty(DIRTY_OTHER);
+
+  return true;
+}
+
 void
 Vis::SetTheOsprayDataObject(OsprayObjectP o)
 {
@@ -180,6 +221,30 @@ Vis::serialize(unsigned char *ptr)
 	return ptr;
 }
 
+int
+Vis::deltaSize()
+{
+  return (dirty & DIRTY_OTHER) ? serialSize() : 0;
+}
+
+unsigned char *
+Vis::serializeDelta(unsigned char *ptr)
+{
+  return (dirty & DIRTY_OTHER) ? serialize(ptr) : ptr;
+}
+
+unsigned char *
+Vis::deserializeDelta(unsigned char *ptr)
+{
+  return (dirty & DIRTY_OTHER) ? deserialize(ptr) : ptr;
+}
+
+bool
+Vis::local_commit_delta(MPI_Comm c)
+{
+  return (dirty & DIRTY_OTHER) ? local_commit(c) : false;
+}
+
 bool 
 Vis::local_commit(MPI_Comm c)
 {
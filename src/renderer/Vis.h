@@ -81,6 +81,25 @@ public:
     //! construct a Vis from a Galaxy JSON specification
     virtual bool LoadFromJSON(rapidjson::Value&);
 
+    //! update an already-committed Vis in place from a Galaxy JSON specification
+    /*! The Vis stays bound to its current data; the dirty mask is set for whatever
+     * parameters the specification changed so that a KeyedObject::CommitDeltas ships
+     * only those.  The base class can't tell its parameters apart, so any change is
+     * recorded as DIRTY_OTHER.   If the specification is rejected the Vis is left as it was.
+     */
+    virtual bool UpdateFromJSON(rapidjson::Value&);
+
+    //! capture this Vis' parameters and dirty mask so that an abandoned update can be undone
+    std::vector<unsigned char> SaveState();
+    //! put back the parameters and dirty mask captured by SaveState
+    void RestoreState(std::vector<unsigned char>&);
+
+    //! dirty-mask bits for Vis objects.  Subclasses add finer-grained bits above these.
+    enum
+    {
+      DIRTY_OTHER = 0x01   //!< untracked parameters changed: ship the full state and do a full local_commit
+    };
+
     //! set the name of this Vis
     void SetName(std::string n) { name = n; }
 
@@ -99,6 +118,11 @@ protected:
     virtual unsigned char *serialize(unsigned char *);
     virtual unsigned char *deserialize(unsigned char *);
 
+    virtual int deltaSize();
+    virtual unsigned char *serializeDelta(unsigned char *);
+    virtual unsigned char *deserializeDelta(unsigned char *);
+    virtual bool local_commit_delta(MPI_Comm);
+
     std::string name;
     Key datakey;
     KeyedDataObjectP data;
@@ -59,6 +59,9 @@ Visualization::~Visualization()
 {
   //std::cerr << "Visualization dtor " << std::hex << ((long)this) << "\n";
   Visualization::destroy_ispc();
+
+  if (ospModel)
+    ospRelease(ospModel);
 }
 
 void 
@@ -151,6 +154,8 @@ Visualization::LoadVisualizationsFromJSON(Value& v)
                                                                                 \
       for (int i = 0; i < 6; i++)                                                \
         neighbors[i] = kdop->get_neighbor(i);                                    \
+                                                                                \
+      partitioning = *kdop->get_partitioning();                                  \
     }                                                                            \
     else                                                                        \
     {                                                                            \
@@ -195,6 +200,10 @@ Visualization::local_commit(MPI_Comm c)
 {
   bool first = true;
 
+  // the set of Vis may have changed; rebuild the model on the next render
+
+  model_objects.clear();
+
   for (auto v : vis)
     v->local_commit(c);
 
@@ -223,13 +232,11 @@ Visualization::SetOsprayObjects(std::map<Key, OsprayObjectP>& ospray_object_map)
     initialize_ispc();
   }
 
-  // Model for stuff that we'll be rtcIntersecting; lists of mappedvis and 
-  // volumevis - NULL unless there's some model data
+  // Bring each Vis' OSPRay object up to date.  Only the data objects that have
+  // been modified are recreated; parameter-only changes have already been
+  // applied to the Vis' own ISPC and transfer function state.
 
-  OSPModel ospModel = ospNewModel();
-
-  void *mispc[vis.size()]; int nmispc = 0;
-  void *vispc[vis.size()]; int nvispc = 0;
+  std::vector<OsprayObjectP> objects;
 
   for (auto v : vis)
   {
@@ -243,55 +250,43 @@ Visualization::SetOsprayObjects(std::map<Key, OsprayObjectP>& ospray_object_map)
     }
 
     v->SetTheOsprayDataObject(op);
+    objects.push_back(op);
+  }
 
-#if 0
-#if 0
-    op = v->GetTheOsprayDataObject();
-    if (! op)
-    {
-      op = kdop->CreateTheOSPRayEquivalent(kdop);
-      if (! op)
-      {
-        cerr << "no OSPRay equivalent for this data object\n";
-        exit(1);
-      }
-    }
+  // If the model was built from exactly these objects there's nothing more to do
 
-    v->SetTheOsprayDataObject(op);
-#else
-    op = v->GetTheOsprayDataObject();
-    if (!op || kdop->hasBeenModified())
-    {
-      op = kdop->CreateTheOSPRayEquivalent(kdop);
-      v->SetTheOsprayDataObject(op);
-      kdop->setModified(false);
-    }
-    else
-      op = v->GetTheOsprayDataObject();
-#endif
-#endif
+  if (ospModel && objects == model_objects)
+    return;
 
-#if 0
-   std::cerr << "vis: " << v.get() << "\n";
-   std::cerr << "vol: " << kdop.get();
-   std::cerr << " op: " << op.get() << " vis isp: " << v->GetIspc() << " osp: " << op->GetOSP() << " IE: " << op->GetOSP_IE() << "\n";
-#endif
-    
-    if (GeometryVis::IsA(v))
-      ospAddGeometry(ospModel, (OSPGeometry)op->GetOSP());
+  // Model for stuff that we'll be rtcIntersecting; lists of mappedvis and 
+  // volumevis - NULL unless there's some model data
+
+  if (ospModel)
+    ospRelease(ospModel);
+
+  ospModel = ospNewModel();
+
+  void *mispc[vis.size()]; int nmispc = 0;
+  void *vispc[vis.size()]; int nvispc = 0;
+
+  for (int i = 0; i < vis.size(); i++)
+  {
+    if (GeometryVis::IsA(vis[i]))
+      ospAddGeometry(ospModel, (OSPGeometry)objects[i]->GetOSP());
     else
-      vispc[nvispc++] = v->GetIspc();
+      vispc[nvispc++] = vis[i]->GetIspc();
   }
 
-  if (ospModel)
-    ospCommit(ospModel);
+  ospCommit(ospModel);
    
   ispc::Visualization_commit(ispc, 
-          ospModel ? ospray_util::GetIE(ospModel) : NULL,
+          ospray_util::GetIE(ospModel),
           nvispc, vispc,
           nmispc, mispc,
           global_box.get_min(), global_box.get_max(),
           local_box.get_min(), local_box.get_max());
+
+  model_objects = objects;
 }
 
 void
@@ -300,6 +295,16 @@ Visualization::AddVis(VisP o)
   vis.push_back(o);
 }
 
+// The JSON type of a Vis may leave off the "Vis" suffix of its class name
+
+static string
+vis_class_name(string t)
+{
+  if (t.size() < 3 || t.substr(t.size() - 3) != "Vis")
+    t = t + "Vis";
+  return t;
+}
+
 bool 
 Visualization::LoadFromJSON(Value& v)
 {
@@ -325,9 +330,7 @@ Visualization::LoadFromJSON(Value& v)
       exit(1);
     }
 
-    string t = string(vv["type"].GetString());
-    if (t.substr(t.size() - 3) != "Vis")
-      t = t + "Vis";
+    string t = vis_class_name(vv["type"].GetString());
 
     VisP vp = Vis::Cast(GetTheKeyedObjectFactory()->NewP(t));
     if (vp)
@@ -349,6 +352,84 @@ Visualization::LoadFromJSON(Value& v)
   return true;
 }
 
+bool
+Visualization::UpdateFromJSON(Value& v)
+{
+  if (! v.HasMember("operators"))
+    return false;
+
+  Value& ops = v["operators"];
+  if (ops.Size() != vis.size())
+    return false;
+
+  // Check the structure before touching anything, so a mismatch leaves this
+  // Visualization as it was
+
+  for (int i = 0; i < ops.Size(); i++)
+  {
+    Value& vv = ops[i];
+
+    if (! vv.HasMember("type") || ! vv["type"].IsString() || ! vv.HasMember("dataset") || ! vv["dataset"].IsString())
+      return false;
+
+    string t = vis_class_name(vv["type"].GetString());
+
+    if (t != GetTheKeyedObjectFactory()->GetClassName(vis[i]->getclass()) || string(vv["dataset"].GetString()) != vis[i]->GetName())
+      return false;
+  }
+
+  // A Vis that rejects its update restores itself; put back the ones
+  // already updated too, so the Visualization is never left half-updated
+
+  vector<vector<unsigned char>> saved;
+  for (int i = 0; i < ops.Size(); i++)
+  {
+    saved.push_back(vis[i]->SaveState());
+    if (! vis[i]->UpdateFromJSON(ops[i]))
+    {
+      for (int j = 0; j < i; j++)
+        vis[j]->RestoreState(saved[j]);
+
+      set_error(1);
+      return false;
+    }
+  }
+
+  vector<unsigned char> before(lighting.SerialSize());
+  lighting.Serialize(before.data());
+  string old_annotation = annotation;
+
+  if (v.HasMember("annotation"))
+    SetAnnotation(string(v["annotation"].GetString()));
+
+  if (v.HasMember("Lighting"))
+    lighting.LoadStateFromValue(v["Lighting"]);
+
+  else if (v.HasMember("lighting"))
+    lighting.LoadStateFromValue(v["lighting"]);
+
+  vector<unsigned char> after(lighting.SerialSize());
+  lighting.Serialize(after.data());
+
+  if (before != after || annotation != old_annotation)
+    mark_dirty(DIRTY_SETTINGS);
+
+  return true;
+}
+
+bool
+Visualization::CommitChanges()
+{
+  vector<KeyedObjectP> objects;
+
+  for (auto v : vis)
+    objects.push_back(v);
+
+  objects.push_back(GetTheKeyedObjectFactory()->get(getkey()));
+
+  return KeyedObject::CommitDeltas(objects);
+}
+
 int 
 Visualization::serialSize()
 {
@@ -395,6 +476,7 @@ Visualization::deserialize(unsigned char *p)
   int n = *(int *)p;
   p += sizeof(int);
 
+  vis.clear();
   for (int i = 0; i < n; i++)
   {
     Key k = *(Key *)p;
@@ -405,6 +487,53 @@ Visualization::deserialize(unsigned char *p)
   return p;
 }
 
+// A settings delta is the lighting and the annotation; the Vis list can't
+// change without a full commit.
+
+int
+Visualization::deltaSize()
+{
+  return lighting.SerialSize() + sizeof(int) + annotation.length() + 1;
+}
+
+unsigned char *
+Visualization::serializeDelta(unsigned char *p)
+{
+  p = lighting.Serialize(p);
+
+  int l = annotation.length() + 1;
+  *(int *)p = l;
+  p += sizeof(l);
+
+  memcpy(p, annotation.c_str(), l-1);
+  p[l-1] = 0;
+  p += l;
+
+  return p;
+}
+
+unsigned char *
+Visualization::deserializeDelta(unsigned char *p)
+{
+  p = lighting.Deserialize(p);
+
+  int l = *(int *)p;
+  p += sizeof(l);
+  annotation = (char *)p;
+  p += l;
+
+  return p;
+}
+
+bool
+Visualization::local_commit_delta(MPI_Comm c)
+{
+  // Lighting is resolved from here when each Rendering starts, so there's
+  // no ISPC or OSPRay state to rebuild
+
+  return false;
+}
+
 void 
 Visualization::destroy_ispc()
 {
@@ -79,6 +79,24 @@ public:
   //! construct a Visualization from a Galaxy JSON specification
   virtual bool LoadFromJSON(rapidjson::Value&);
 
+  //! update this Visualization in place from a Galaxy JSON specification
+  /*! This only succeeds if the specification has the same Vis elements, of the same
+   * types and applied to the same datasets, as the current Visualization.  Each Vis and
+   * the lighting are then updated and their dirty masks set for what actually changed.
+   * If the structure differs the Visualization is left untouched and false is returned;
+   * the caller should build and Commit a new one.
+   */
+  bool UpdateFromJSON(rapidjson::Value&);
+
+  //! commit only the Vis parameters and lighting changed since the last commit, in a single collective
+  bool CommitChanges();
+
+  //! dirty-mask bits for a Visualization
+  enum
+  {
+    DIRTY_SETTINGS = 0x01   //!< lighting or annotation changed
+  };
+
   //! set the annotation string for this Visualization
   void  SetAnnotation(std::string a) { annotation = a; }
   //! get the current annotation string for this Visualization
@@ -107,6 +125,10 @@ public:
    */
   bool has_neighbor(unsigned int face) { return neighbors[face] >= 0; }
 
+  //! return the process across the given face whose partition contains the point `p` on that face, or -1
+  /*! With an irregular decomposition a face may border several partitions; see Partitioning */
+  int neighbor_at(int face, vec3f& p) { return partitioning.empty() ? neighbors[face] : partitioning.neighbor_at(face, p); }
+
   //! get a pointer to the Lighting object for this Visualization
 	Lighting *get_the_lights() { return &lighting; }
 
@@ -129,13 +151,22 @@ protected:
   virtual unsigned char *serialize(unsigned char *);
   virtual unsigned char *deserialize(unsigned char *);
 
+  virtual int deltaSize();
+  virtual unsigned char *serializeDelta(unsigned char *);
+  virtual unsigned char *deserializeDelta(unsigned char *);
+  virtual bool local_commit_delta(MPI_Comm);
+
   std::string annotation;
 
   vis_t vis;
 
+  //! the OSPRay objects ospModel was built from, so it is only rebuilt when one changes
+  std::vector<OsprayObjectP> model_objects;
+
   Box global_box;
   Box local_box;
   int neighbors[6];
+  Partitioning partitioning;
 };
 
 } // namespace gxy
@@ -162,6 +162,155 @@ VolumeVis::LoadFromJSON(Value& v)
   return true;
 }
 
+bool
+VolumeVis::UpdateFromJSON(Value& v)
+{
+  // Everything a VolumeVis serializes is covered by one of the MappedVis or
+  // VolumeVis groups, so compare group by group rather than falling back
+  // to Vis' all-or-nothing DIRTY_OTHER.
+
+  std::vector<vec4f> old_colormap = colormap;
+  std::vector<vec2f> old_opacitymap = opacitymap;
+  bool old_data_range = data_range;
+  float old_data_range_min = data_range_min, old_data_range_max = data_range_max;
+  std::vector<vec4f> old_slices = slices;
+  std::vector<float> old_isovalues = isovalues;
+  bool old_volume_rendering = volume_rendering;
+
+  std::vector<unsigned char> before = SaveState();
+  int old_dirty = dirty;
+  Key k = datakey;
+
+  if (! LoadFromJSON(v))
+  {
+    RestoreState(before);
+    return false;
+  }
+
+  datakey = k;
+
+  int bits = mapping_changes(old_colormap, old_opacitymap, old_data_range, old_data_range_min, old_data_range_max);
+
+  if (slices.size() != old_slices.size() || memcmp(slices.data(), old_slices.data(), slices.size()*sizeof(vec4f)))
+    bits |= DIRTY_SLICES;
+
+  if (isovalues != old_isovalues)
+    bits |= DIRTY_ISOVALUES;
+
+  if (volume_rendering != old_volume_rendering)
+    bits |= DIRTY_VOLUME_RENDERING;
+
+  // LoadFromJSON goes through the setters, which mark groups dirty whether
+  // or not they changed; keep only what really did
+
+  dirty = old_dirty | bits;
+  return true;
+}
+
+int
+VolumeVis::deltaSize()
+{
+  int sz = super::deltaSize();
+  if (dirty & DIRTY_OTHER)
+    return sz;
+
+  if (dirty & DIRTY_SLICES)
+    sz += sizeof(int) + slices.size()*sizeof(vec4f);
+
+  if (dirty & DIRTY_ISOVALUES)
+    sz += sizeof(int) + isovalues.size()*sizeof(float);
+
+  if (dirty & DIRTY_VOLUME_RENDERING)
+    sz += sizeof(bool);
+
+  return sz;
+}
+
+unsigned char *
+VolumeVis::serializeDelta(unsigned char *ptr)
+{
+  ptr = super::serializeDelta(ptr);
+  if (dirty & DIRTY_OTHER)
+    return ptr;
+
+  if (dirty & DIRTY_SLICES)
+  {
+    *(int *)ptr = slices.size();
+    ptr += sizeof(int);
+    memcpy(ptr, slices.data(), slices.size()*sizeof(vec4f));
+    ptr += slices.size()*sizeof(vec4f);
+  }
+
+  if (dirty & DIRTY_ISOVALUES)
+  {
+    *(int *)ptr = isovalues.size();
+    ptr += sizeof(int);
+    memcpy(ptr, isovalues.data(), isovalues.size()*sizeof(float));
+    ptr += isovalues.size()*sizeof(float);
+  }
+
+  if (dirty & DIRTY_VOLUME_RENDERING)
+  {
+    *(bool *)ptr = volume_rendering;
+    ptr += sizeof(bool);
+  }
+
+  return ptr;
+}
+
+unsigned char *
+VolumeVis::deserializeDelta(unsigned char *ptr)
+{
+  ptr = super::deserializeDelta(ptr);
+  if (dirty & DIRTY_OTHER)
+    return ptr;
+
+  if (dirty & DIRTY_SLICES)
+  {
+    int ns = *(int *)ptr;
+    ptr += sizeof(int);
+    SetSlices(ns, (vec4f*)ptr);
+    ptr += ns*sizeof(vec4f);
+  }
+
+  if (dirty & DIRTY_ISOVALUES)
+  {
+    int ni = *(int *)ptr;
+    ptr += sizeof(int);
+    SetIsovalues(ni, (float*)ptr);
+    ptr += ni*sizeof(float);
+  }
+
+  if (dirty & DIRTY_VOLUME_RENDERING)
+  {
+    SetVolumeRendering(*(bool *)ptr);
+    ptr += sizeof(bool);
+  }
+
+  return ptr;
+}
+
+bool
+VolumeVis::local_commit_delta(MPI_Comm c)
+{
+  if (dirty & DIRTY_OTHER)
+    return super::local_commit_delta(c);
+
+  if (super::local_commit_delta(c))
+    return true;
+
+	if (dirty & DIRTY_SLICES)
+    ispc::VolumeVis_SetSlices(GetIspc(), slices.size(), ((float *)slices.data()));
+
+	if (dirty & DIRTY_ISOVALUES)
+    ispc::VolumeVis_SetIsovalues(GetIspc(), isovalues.size(), ((float *)isovalues.data()));
+
+	if (dirty & DIRTY_VOLUME_RENDERING)
+    ispc::VolumeVis_SetVolumeRenderFlag(GetIspc(), volume_rendering);
+
+	return false;
+}
+
 void
 VolumeVis::destroy_ispc()
 {
@@ -55,12 +55,14 @@ public:
   void AddSlice(vec4f s)
   {
     slices.push_back(s);
+    mark_dirty(DIRTY_SLICES);
   }
 
   //! set the slice plane(s) to use in this VolumeVis object
   void SetSlices(int n, vec4f *s)
   {
     slices.clear();
+    mark_dirty(DIRTY_SLICES);
     for (int i = 0; i < n; i++)
       AddSlice(s[i]);
   }
@@ -76,12 +78,14 @@ public:
   void AddIsovalue(float iv)
   {
     isovalues.push_back(iv);
+    mark_dirty(DIRTY_ISOVALUES);
   }
 
   //! set the isovalue(s) to extract from this VolumeVis object
   void SetIsovalues(int n, float *isos)
   {
     isovalues.clear();
+    mark_dirty(DIRTY_ISOVALUES);
     for (int i = 0; i < n; i++)
       AddIsovalue(isos[i]);
   }
@@ -94,12 +98,23 @@ public:
   }
 
   //! set whether to use direct volume rendering to render this VolumeVis
-  void SetVolumeRendering(bool yn) { volume_rendering = yn; }
+  void SetVolumeRendering(bool yn) { volume_rendering = yn; mark_dirty(DIRTY_VOLUME_RENDERING); }
   //! is direct volume rendering used to render this VolumeVis?
   bool GetVolumeRendering() { return volume_rendering; }
 
   virtual bool local_commit(MPI_Comm);
 
+  //! update an already-committed VolumeVis in place, tracking each parameter group separately
+  virtual bool UpdateFromJSON(rapidjson::Value&);
+
+  //! dirty-mask bits for the parameters of a VolumeVis
+  enum
+  {
+    DIRTY_SLICES           = 0x10,
+    DIRTY_ISOVALUES        = 0x20,
+    DIRTY_VOLUME_RENDERING = 0x40
+  };
+
 protected:
 
 	virtual void initialize_ispc();
@@ -112,6 +127,11 @@ protected:
   virtual unsigned char* serialize(unsigned char *ptr);
   virtual unsigned char* deserialize(unsigned char *ptr);
 
+  virtual int deltaSize();
+  virtual unsigned char *serializeDelta(unsigned char *);
+  virtual unsigned char *deserializeDelta(unsigned char *);
+  virtual bool local_commit_delta(MPI_Comm);
+
   bool volume_rendering;
 
   std::vector<vec4f> slices;
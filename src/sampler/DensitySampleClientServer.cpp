@@ -48,45 +48,31 @@ DensitySampleClientServer::DensitySampleClientServer(SocketHandler *sh) : MultiS
 static float *
 CellValues(VolumeP v, DensitySampleClientServer::Args *a)
 {
-  float *cellValues = new float((a->ni-1) * (a->nj-1) * (a->nk-1));
+  // Cell value is the sum of the first component at its eight corners
+
+  float *cellValues = new float[(a->ni-1) * (a->nj-1) * (a->nk-1)];
+
+  int nc = v->get_number_of_components();
 
   float *d = cellValues;
-  if (v->get_type() == Volume::FLOAT)
-  {
-    float *s = (float *)v->get_samples();
-    for (int i = 0; i < a->nj-1; i++)
-      for (int j = 0; i < a->nj-1; j++)
-        for (int k = 0; k < a->nk-1; k++)
-        {
-          int corner = (a->goi+i)*a->istep + (a->goj+k)*a->jstep + (a->gok+k)*a->kstep;
-          *d++ = s[corner + 0*a->istep + 0*a->jstep + 0*a->kstep] +
-                 s[corner + 1*a->istep + 0*a->jstep + 0*a->kstep] +
-                 s[corner + 0*a->istep + 1*a->jstep + 0*a->kstep] +
-                 s[corner + 1*a->istep + 1*a->jstep + 0*a->kstep] +
-                 s[corner + 0*a->istep + 0*a->jstep + 1*a->kstep] +
-                 s[corner + 1*a->istep + 0*a->jstep + 1*a->kstep] +
-                 s[corner + 0*a->istep + 1*a->jstep + 1*a->kstep] +
-                 s[corner + 1*a->istep + 1*a->jstep + 1*a->kstep];
-        }
-  }
-  else
-  {
-    double *s = (double *)v->get_samples();
-    for (int i = 0; i < a->nj-1; i++)
-      for (int j = 0; i < a->nj-1; j++)
-        for (int k = 0; k < a->nk-1; k++)
+  for (int i = 0; i < a->ni-1; i++)
+    for (int j = 0; j < a->nj-1; j++)
+      for (int k = 0; k < a->nk-1; k++)
+      {
+        int corner = (a->goi+i)*a->istep + (a->goj+j)*a->jstep + (a->gok+k)*a->kstep;
+
+        float sum = 0.0;
+        for (int c = 0; c < 8; c++)
         {
-          int corner = (a->goi+i)*a->istep + (a->goj+k)*a->jstep + (a->gok+k)*a->kstep;
-          *d++ = s[corner + 0*a->istep + 0*a->jstep + 0*a->kstep] +
-                 s[corner + 1*a->istep + 0*a->jstep + 0*a->kstep] +
-                 s[corner + 0*a->istep + 1*a->jstep + 0*a->kstep] +
-                 s[corner + 1*a->istep + 1*a->jstep + 0*a->kstep] +
-                 s[corner + 0*a->istep + 0*a->jstep + 1*a->kstep] +
-                 s[corner + 1*a->istep + 0*a->jstep + 1*a->kstep] +
-                 s[corner + 0*a->istep + 1*a->jstep + 1*a->kstep] +
-                 s[corner + 1*a->istep + 1*a->jstep + 1*a->kstep];
+          int offset = corner + (c&1)*a->istep + ((c>>1)&1)*a->jstep + ((c>>2)&1)*a->kstep;
+          if (v->get_type() == Volume::FLOAT)
+            sum += ((float *)v->get_samples())[offset*nc];
+          else
+            sum += ((unsigned char *)v->get_samples())[offset*nc];
         }
-  }
+
+        *d++ = sum;
+      }
 
   return cellValues;
 }
@@ -103,17 +89,24 @@ DensitySample(MPI_Comm c, DensitySampleClientServer::Args *a)
 
   v->get_local_counts(a->ni, a->nj, a->nk);
   v->get_ghosted_local_counts(a->gi, a->gj, a->gk);
-  v->get_ghosted_local_offsets(a->goi, a->goj, a->gok);
   v->get_local_origin(a->ox, a->oy, a->oz);
   v->get_deltas(a->dx, a->dy, a->dz);
 
+  // Offsets of the non-ghosted partition within the ghosted sample array
+
+  float gox, goy, goz;
+  v->get_ghosted_local_origin(gox, goy, goz);
+  a->goi = (int)(((a->ox - gox) / a->dx) + 0.5);
+  a->goj = (int)(((a->oy - goy) / a->dy) + 0.5);
+  a->gok = (int)(((a->oz - goz) / a->dz) + 0.5);
+
   a->istep = 1;
   a->jstep = a->gi;
   a->kstep = a->gi * a->gj;
 
   float *cellValues = CellValues(v, a);
 
-  int ncells = a->ni * a->nj * a->nk;
+  int ncells = (a->ni-1) * (a->nj-1) * (a->nk-1);
 
   float local_total = 0.0, global_total;
   for (int i = 0; i < ncells; i++)
@@ -122,37 +115,66 @@ DensitySample(MPI_Comm c, DensitySampleClientServer::Args *a)
   MPI_Allreduce(&local_total, &global_total, 1, MPI_FLOAT, MPI_SUM, c);
 
   float f_this_part = (local_total / global_total) * a->nSamples;
-  int n_this_part   = ((int)f_this_part) + ((RNDM < (f_this_part - (int)f_this_part)) ? 1 : 0);
 
   if (local_total > 0)
   {
-    float *tcell = cellValues;
+    // First decide how many samples land in each cell so the particle
+    // arrays can be allocated once, then place them and interpolate the
+    // data values in a single batch
+
+    int *cellCounts = new int[ncells];
+
+    int n = 0;
+    for (int i = 0; i < ncells; i++)
+    {
+      float f_this_cell = (cellValues[i] / local_total) * f_this_part;
+      cellCounts[i] = (int)f_this_cell + ((RNDM < (f_this_cell - (int)f_this_cell)) ? 1 : 0);
+      n += cellCounts[i];
+    }
+
+    p->allocate_vertices(n);
 
-    for (int i = 0; i < a->nj-1; i++)
+    vec3f *xyz = p->GetVertices();
+    int *tcount = cellCounts;
+
+    for (int i = 0; i < a->ni-1; i++)
     {
       float ox = a->ox + i*a->dx;
 
-      for (int j = 0; i < a->nj-1; j++)
+      for (int j = 0; j < a->nj-1; j++)
       {
-        float oy = a->oy + i*a->dx;
+        float oy = a->oy + j*a->dy;
 
         for (int k = 0; k < a->nk-1; k++)
         {
-          float oz = a->oz + i*a->dx;
-
-          float f_this_cell = (*tcell++ / local_total) * f_this_part;
-          int n_this_part   = (int)f_this_cell + ((RNDM < (f_this_cell - (int)f_this_cell)) ? 1 : 0);
+          float oz = a->oz + k*a->dz;
 
-          for (int l = 0; l < n_this_part; l++)
-          {
-            Particle s(ox + RNDM, oy + RNDM, oz + RNDM, 0);
-            p->push_back(s);
-          }
+          for (int l = *tcount++; l > 0; l--)
+            *xyz++ = vec3f(ox + RNDM*a->dx, oy + RNDM*a->dy, oz + RNDM*a->dz);
         }
       }
     }
+
+    int nc = v->get_number_of_components();
+    if (nc == 1)
+      v->Sample(n, p->GetVertices(), p->GetData());
+    else
+    {
+      float *values = new float[n*nc];
+      v->Sample(n, p->GetVertices(), values);
+
+      float *dst = p->GetData();
+      for (int i = 0; i < n; i++)
+        dst[i] = values[i*nc];
+
+      delete[] values;
+    }
+
+    delete[] cellCounts;
   }
 
+  delete[] cellValues;
+
   std::cerr << "created " << p->GetNumberOfVertices() << " samples\n";
 }
 
@@ -54,9 +54,6 @@ public:
     Key   vk;                         // Volume key
     Key   sk;                         // Source particles key
     Key   dk;                         // Destinationb particles key  
-    float istride, jstride, kstride;  // strides along i, j, and k axes 
-    float ox, oy, oz;                 // origin of local partition
-    float dx, dy, dz;                 // steps in X, Y and Z
   } args;
 };
 
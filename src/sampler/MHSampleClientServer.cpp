@@ -118,61 +118,15 @@ static float Q(VolumeP v, float s, MHSampleClientServer::Args *a)
   return q;
 }
 
-static float sample(MHSampleClientServer::Args *args, VolumeP v, float x, float y, float z)
-{
-  float dx, dy, dz;
-  v->get_deltas(dx, dy, dz);
+// Each step of the chain depends on the previous sample, so there's nothing
+// to batch here; go through the volume's own interpolator
 
-  float ox, oy, oz;
-  v->get_ghosted_local_origin(ox, oy, oz);
-
-  x = (x - ox) / dx;
-  y = (y - oy) / dy;
-  z = (z - oz) / dz;
-
-  int ix = (int)x;
-  int iy = (int)y;
-  int iz = (int)z;
-
-  dx = x - ix;
-  dy = y - iy;
-  dz = z - iz;
-
-  int v000 = (ix + 0) * args->istep + (iy + 0) * args->jstep + (iz + 0) * args->kstep;
-  int v001 = (ix + 0) * args->istep + (iy + 0) * args->jstep + (iz + 1) * args->kstep;
-  int v010 = (ix + 0) * args->istep + (iy + 1) * args->jstep + (iz + 0) * args->kstep;
-  int v011 = (ix + 0) * args->istep + (iy + 1) * args->jstep + (iz + 1) * args->kstep;
-  int v100 = (ix + 1) * args->istep + (iy + 0) * args->jstep + (iz + 0) * args->kstep;
-  int v101 = (ix + 1) * args->istep + (iy + 0) * args->jstep + (iz + 1) * args->kstep;
-  int v110 = (ix + 1) * args->istep + (iy + 1) * args->jstep + (iz + 0) * args->kstep;
-  int v111 = (ix + 1) * args->istep + (iy + 1) * args->jstep + (iz + 1) * args->kstep;
-
-  float b000 = (1.0 - dx) * (1.0 - dy) * (1.0 - dz);
-  float b001 = (1.0 - dx) * (1.0 - dy) * (dz);
-  float b010 = (1.0 - dx) * (dy) * (1.0 - dz);
-  float b011 = (1.0 - dx) * (dy) * (dz);
-  float b100 = (dx) * (1.0 - dy) * (1.0 - dz);
-  float b101 = (dx) * (1.0 - dy) * (dz);
-  float b110 = (dx) * (dy) * (1.0 - dz);
-  float b111 = (dx) * (dy) * (dz);
-
-  if (v->get_type() == Volume::FLOAT)
-  {
-    float *p = (float *)v->get_samples();
-    return p[v000]*b000 + p[v001]*b001 + p[v010]*b010 + p[v011]*b011 +
-           p[v100]*b100 + p[v101]*b101 + p[v110]*b110 + p[v111]*b111;
-  }
-  else
-  {
-    unsigned char *p = (unsigned char *)v->get_samples();
-    return p[v000]*b000 + p[v001]*b001 + p[v010]*b010 + p[v011]*b011 +
-           p[v100]*b100 + p[v101]*b101 + p[v110]*b110 + p[v111]*b111;
-  }
+static float sample(VolumeP v, vec3f xyz)
+{
+  float value;
+  return v->Sample(xyz, value) ? value : 0.0;
 }
 
-float sample(MHSampleClientServer::Args *args, VolumeP v, Particle& p) { return sample(args, v, p.xyz.x, p.xyz.y, p.xyz.z); }
-float sample(MHSampleClientServer::Args *args, VolumeP v, vec3f xyz) { return sample(args, v, xyz.x, xyz.y, xyz.z); }
-
 static void
 Metropolis_Hastings(MHSampleClientServer::Args *a)
 {
@@ -212,13 +166,9 @@ Metropolis_Hastings(MHSampleClientServer::Args *a)
   v->get_local_counts(ngx, ngy, ngz);
   int global_count = ngx*ngy*ngz;
 
-  a->istep = 1;
-  a->jstep = gnli;
-  a->kstep = gnli * gnlj;
-
   Particle tp;
   tp.xyz = get_starting_point(v);
-  tp.u.value = sample(a, v, tp.xyz);
+  tp.u.value = sample(v, tp.xyz);
 
   float tq = Q(v, tp.u.value, a);
 
@@ -235,7 +185,7 @@ Metropolis_Hastings(MHSampleClientServer::Args *a)
 
     iteration ++;
 
-    cp.u.value = sample(a, v, cp);
+    cp.u.value = sample(v, cp.xyz);
     float cq = Q(v, cp.u.value, a);
 
     if ((cq > tq) || (RNDM < (cq/tq)))
@@ -249,7 +199,7 @@ Metropolis_Hastings(MHSampleClientServer::Args *a)
     else if (++miss_count > a->n_miss)
     {
       tp.xyz = get_starting_point(v);
-      tp.u.value = sample(a, v, tp.xyz);
+      tp.u.value = sample(v, tp.xyz);
       miss_count = 0;
     }
   }
@@ -72,9 +72,6 @@ public:
     int   n_skip;         // only retain every n_skip'th successful sample
     int   n_miss;         // max number of successive misses allowed before termination
     float r, g, b, a;     // color for spheres
-    float istep;          // steps along i, j, and k axes 
-    float jstep;
-    float kstep;
   } args;
 };
 
@@ -20,7 +20,9 @@
 
 #define _GNU_SOURCE // XXX TODO: what needs this? remove if possible
 
+#include <algorithm>
 #include <stdlib.h>
+#include <time.h>
 #include "Sampler.h"
 #include "SamplerVis.h"
 #include "Particles.h"
@@ -33,20 +35,73 @@ namespace gxy
 {
 KEYED_OBJECT_CLASS_TYPE(Sampler)
 
+WORK_CLASS_TYPE(Sampler::CollectSamplesMsg)
+
+static long
+my_time()
+{
+  timespec s;
+  clock_gettime(CLOCK_REALTIME, &s);
+  return 1000000000*s.tv_sec + s.tv_nsec;
+}
+
 void
 Sampler::Initialize()
 { 
   RegisterClass();
   SamplerVis::Register();
+  CollectSamplesMsg::Register();
 }
 
-#if 0
 void
 Sampler::initialize()
 {
+  super::initialize();
   pthread_mutex_init(&lock, NULL);
+  pthread_key_create(&buffer_key, NULL);
+  sampling_start = my_time();
+}
+
+Sampler::~Sampler()
+{
+  for (auto b : buffers)
+    delete b;
+
+  pthread_key_delete(buffer_key);
+  pthread_mutex_destroy(&lock);
+}
+
+// Each thread that handles terminated rays gets a buffer of its own the
+// first time through; after that, stashing samples takes no lock at all
+
+std::vector<Particle> *
+Sampler::get_thread_buffer()
+{
+  std::vector<Particle> *buffer = (std::vector<Particle> *)pthread_getspecific(buffer_key);
+  if (! buffer)
+  {
+    buffer = new std::vector<Particle>;
+    pthread_setspecific(buffer_key, (void *)buffer);
+
+    pthread_mutex_lock(&lock);
+    buffers.push_back(buffer);
+    pthread_mutex_unlock(&lock);
+  }
+
+  return buffer;
+}
+
+void
+Sampler::local_render(RendererP renderer, RenderingSetP renderingSet)
+{
+  pthread_mutex_lock(&lock);
+  for (auto b : buffers)
+    b->clear();
+  sampling_start = my_time();
+  pthread_mutex_unlock(&lock);
+
+  super::local_render(renderer, renderingSet);
 }
-#endif
 
 void
 Sampler::HandleTerminatedRays(RayList *raylist)
@@ -64,9 +119,13 @@ Sampler::HandleTerminatedRays(RayList *raylist)
 
   if (hit_count == 0) return;
 
-  ParticlesP samples = this->GetSamples();
+  std::vector<Particle> *buffer = get_thread_buffer();
 
-  samples->Lock();
+  // Grow geometrically; reserving exactly what this list needs would copy
+  // the whole buffer on every RayList
+
+  if (buffer->capacity() < (buffer->size() + hit_count))
+    buffer->reserve(std::max(2*buffer->capacity(), buffer->size() + hit_count));
 
   for (int i = 0; i < raylist->GetRayCount(); i++)
   {
@@ -79,13 +138,76 @@ Sampler::HandleTerminatedRays(RayList *raylist)
       newsample.xyz.z = raylist->get_oz(i) + raylist->get_t(i)*raylist->get_dz(i);
       newsample.u.value = 0.0;
 
-      samples->push_back(newsample);
+      buffer->push_back(newsample);
     }
   }
+}
+
+void
+Sampler::CollectSamples()
+{
+  CollectSamplesMsg *msg = new CollectSamplesMsg(this);
+  msg->Broadcast(true, true);
+}
+
+void
+Sampler::_collectSamples(MPI_Comm c)
+{
+  ParticlesP samples = GetSamples();
+
+  pthread_mutex_lock(&lock);
+
+  double elapsed = (my_time() - sampling_start) / 1000000000.0;
+
+  // Size the samples' arrays once, then copy each thread's buffer in
+
+  int n = 0;
+  for (auto b : buffers)
+    n += b->size();
+
+  samples->Lock();
+
+  int base = samples->GetNumberOfVertices();
+  samples->allocate_vertices(base + n);
+
+  vec3f *xyz = samples->GetVertices() + base;
+  float *data = samples->GetData() + base;
+
+  for (auto b : buffers)
+  {
+    for (auto& p : *b)
+    {
+      *xyz++  = p.xyz;
+      *data++ = p.u.value;
+    }
+
+    std::vector<Particle>().swap(*b);
+  }
 
   samples->Unlock();
 
-  // std::cerr << "Sampler::HandleTerminatedRays: " << samples->GetNumberOfVertices() << " samples stashed\n";
+  pthread_mutex_unlock(&lock);
+
+  long local_count = n, global_count = n;
+  double global_elapsed = elapsed;
+
+  if (GetTheApplication()->GetTheMessageManager()->UsingMPI())
+  {
+    MPI_Reduce(&local_count, &global_count, 1, MPI_LONG, MPI_SUM, 0, c);
+    MPI_Reduce(&elapsed, &global_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, c);
+  }
+
+  if (GetTheApplication()->GetRank() == 0)
+    std::cerr << "Sampler: " << global_count << " samples in " << global_elapsed << " seconds ("
+              << (global_elapsed > 0 ? global_count / global_elapsed : 0) << " samples/sec)\n";
+}
+
+bool
+Sampler::CollectSamplesMsg::CollectiveAction(MPI_Comm c, bool isRoot)
+{
+  SamplerP s = Sampler::GetByKey(*(Key *)contents->get());
+  s->_collectSamples(c);
+  return false;
 }
 
 int
@@ -36,6 +36,7 @@
 #include <pthread.h>
 
 #include "Renderer.h"
+#include "Particles.h"
 
 namespace gxy
 {
@@ -50,11 +51,21 @@ class Sampler : public Renderer
     
 public:
   static void Initialize();
-  // virtual void initialize(); //!< initialize this object
+  virtual void initialize(); //!< initialize this object
+  virtual ~Sampler();
 
   virtual void HandleTerminatedRays(RayList *);
   virtual void Trace(RayList *);
 
+  //! clears the per-thread sample buffers and starts the sampling timer
+  virtual void local_render(RendererP, RenderingSetP);
+
+  //! merge the per-thread sample buffers into the samples dataset on every process
+  /*! HandleTerminatedRays stashes samples in buffers private to the calling thread.
+   * Call this once the sampling RenderingSet is done, before committing the samples.
+   */
+  void CollectSamples();
+
   void SetSamples(ParticlesP p) {mSamples = p;}
   ParticlesP GetSamples()
   {
@@ -66,9 +77,29 @@ public:
   virtual unsigned char *Deserialize(unsigned char *);
 
 private:
+  void _collectSamples(MPI_Comm);
+  std::vector<Particle> *get_thread_buffer();
+
   ParticlesP mSamples = NULL;
   pthread_mutex_t lock;
 
+  pthread_key_t buffer_key;                     // this thread's sample buffer
+  std::vector<std::vector<Particle> *> buffers; // every thread's sample buffer
+  long sampling_start;
+
+  class CollectSamplesMsg : public Work
+  {
+  public:
+    CollectSamplesMsg(Sampler *s) : CollectSamplesMsg(sizeof(Key))
+    {
+      *(Key *)contents->get() = s->getkey();
+    }
+
+    WORK_CLASS(CollectSamplesMsg, true);
+
+  public:
+    bool CollectiveAction(MPI_Comm coll_comm, bool isRoot);
+  };
 };
 
 } // namespace gxy
@@ -25,6 +25,7 @@
 #include "Particles.h"
 #include "Rays.h"
 #include "SchlierenTraceRays.h"
+#include "SchlierenGradient.h"
 
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
@@ -49,6 +50,13 @@ Schlieren::Initialize()
   super::Initialize();
 }
 
+void
+Schlieren::initialize()
+{
+  super::initialize();
+  SetPrecomputeGradient(false);
+}
+
 void
 Schlieren::HandleTerminatedRays(RayList *raylist)
 {
@@ -200,7 +208,7 @@ Schlieren::HandleTerminatedRays(RayList *raylist)
 int
 Schlieren::SerialSize()
 {
-  return super::SerialSize() + sizeof(float);
+  return super::SerialSize() + sizeof(float) + sizeof(int);
 }
 
 unsigned char *
@@ -209,6 +217,8 @@ Schlieren::Serialize(unsigned char *p)
   p = super::Serialize(p);
   *(float *)p = GetFar();
   p += sizeof(float);
+  *(int *)p = GetPrecomputeGradient() ? 1 : 0;
+  p += sizeof(int);
   return p;
 }
 
@@ -218,6 +228,8 @@ Schlieren::Deserialize(unsigned char *p)
   p = super::Deserialize(p);
   SetFar(*(float *)p);
   p += sizeof(float);
+  SetPrecomputeGradient(*(int *)p != 0);
+  p += sizeof(int);
   return p;
 }
 
@@ -237,6 +249,9 @@ Schlieren::Trace(RayList *raylist)
 
   SchlierenTraceRays tracer;
 
+  if (GetPrecomputeGradient())
+    tracer.SetGradientField(SchlierenGradient::Find(std::atomic_load(&gradients), visualization));
+
   RayList *out = tracer.Trace(rendering->GetLighting(), visualization, raylist);
   if (out)
   {
@@ -262,6 +277,9 @@ Schlieren::LoadStateFromValue(Value& v)
   if (v.HasMember("far"))
       SetFar(v["far"].GetDouble());
 
+  if (v.HasMember("precompute gradient"))
+      SetPrecomputeGradient(v["precompute gradient"].GetBool());
+
   return true;
 }
 
@@ -269,6 +287,18 @@ void
 Schlieren::SaveStateToValue(Value& v, Document& doc)
 {
   v.AddMember("far", Value().SetDouble(GetFar()), doc.GetAllocator());
+  v.AddMember("precompute gradient", Value().SetBool(GetPrecomputeGradient()), doc.GetAllocator());
+}
+
+void
+Schlieren::local_render(RendererP renderer, RenderingSetP renderingSet)
+{
+  // Compute (or validate cached) gradient fields before any rays are spawned
+
+  if (GetPrecomputeGradient())
+    std::atomic_store(&gradients, SchlierenGradient::Prepare(renderingSet));
+
+  super::local_render(renderer, renderingSet);
 }
 
 bool
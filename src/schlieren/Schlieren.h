@@ -35,6 +35,7 @@
 #include <vector>
 
 #include "Renderer.h"
+#include "SchlierenGradient.h"
 
 namespace gxy
 {
@@ -49,6 +50,7 @@ class Schlieren : public Renderer
     
 public:
   static void Initialize();
+  virtual void initialize(); //!< initializes the singleton Renderer
 
   virtual bool LoadStateFromValue(rapidjson::Value&);
   virtual void SaveStateToValue(rapidjson::Value&, rapidjson::Document&);
@@ -63,12 +65,22 @@ public:
 
   void NormalizeImages(RenderingSetP);
 
+  //! if set, bend rays using a gradient field precomputed from the volume (see SchlierenGradient.h)
+  bool GetPrecomputeGradient() { return precompute_gradient; }
+  void SetPrecomputeGradient(bool b) { precompute_gradient = b; }
+
+  virtual void local_render(RendererP, RenderingSetP);
+
 protected:
   float GetFar() { return far; }
   void  SetFar(float f) { far = f; }
 
 private:
   float far;
+  bool precompute_gradient;
+
+  // this frame's gradient fields, replaced by local_render and read by Trace
+  SchlierenGradient::FieldsP gradients;
 
   //! a Work unit to instruct Galaxy processes to begin rendering
   class NormalizeSchlierenImagesMsg : public Work
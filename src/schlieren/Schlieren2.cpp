@@ -26,6 +26,7 @@
 #include "Particles.h"
 #include "Rays.h"
 #include "Schlieren2TraceRays.h"
+#include "SchlierenGradient.h"
 
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
@@ -56,6 +57,7 @@ Schlieren2::initialize()
   super::initialize();
   SetFar(10);
   SetRaysPerPixel(-1);
+  SetPrecomputeGradient(false);
 }
 
 void
@@ -224,7 +226,7 @@ Schlieren2::HandleTerminatedRays(RayList *raylist)
 int
 Schlieren2::SerialSize()
 {
-  return super::SerialSize() + 2*sizeof(float) + 2*sizeof(int);
+  return super::SerialSize() + 2*sizeof(float) + 3*sizeof(int);
 }
 
 unsigned char *
@@ -239,6 +241,8 @@ Schlieren2::Serialize(unsigned char *p)
   p += sizeof(float);
   *(int *)p = GetCutoffType();
   p += sizeof(int);
+  *(int *)p = GetPrecomputeGradient() ? 1 : 0;
+  p += sizeof(int);
   return p;
 }
 
@@ -254,6 +258,8 @@ Schlieren2::Deserialize(unsigned char *p)
   p += sizeof(float);
   SetCutoffType(*(int *)p);
   p += sizeof(int);
+  SetPrecomputeGradient(*(int *)p != 0);
+  p += sizeof(int);
   return p;
 }
 
@@ -273,6 +279,9 @@ Schlieren2::Trace(RayList *raylist)
 
   Schlieren2TraceRays tracer;
 
+  if (GetPrecomputeGradient())
+    tracer.SetGradientField(SchlierenGradient::Find(std::atomic_load(&gradients), visualization));
+
   RayList *out = tracer.Trace(rendering->GetLighting(), visualization, raylist);
   if (out)
   {
@@ -301,6 +310,9 @@ Schlieren2::LoadStateFromValue(Value& v)
   if (v.HasMember("rays per pixel"))
       SetRaysPerPixel(v["rays per pixel"].GetInt());
 
+  if (v.HasMember("precompute gradient"))
+      SetPrecomputeGradient(v["precompute gradient"].GetBool());
+
   return true;
 }
 
@@ -308,6 +320,7 @@ void
 Schlieren2::SaveStateToValue(Value& v, Document& doc)
 {
   v.AddMember("far", Value().SetDouble(GetFar()), doc.GetAllocator());
+  v.AddMember("precompute gradient", Value().SetBool(GetPrecomputeGradient()), doc.GetAllocator());
 }
 
 bool
@@ -375,6 +388,9 @@ Schlieren2::local_render(RendererP renderer, RenderingSetP renderingSet)
   int fnum = renderingSet->NeedInitialRays();
   if (fnum != -1)
   {
+    if (GetPrecomputeGradient())
+      std::atomic_store(&gradients, SchlierenGradient::Prepare(renderingSet));
+
 #ifdef GXY_WRITE_IMAGES
     GetTheRayQManager()->Pause();
 
@@ -35,6 +35,7 @@
 #include <vector>
 
 #include "Renderer.h"
+#include "SchlierenGradient.h"
 
 namespace gxy
 {
@@ -76,6 +77,10 @@ public:
 
   float GetCutoffType() { return cutoff_type; }
   void SetCutoffType(int t) { cutoff_type = t; }
+
+  //! if set, bend rays using a gradient field precomputed from the volume (see SchlierenGradient.h)
+  bool GetPrecomputeGradient() { return precompute_gradient; }
+  void SetPrecomputeGradient(bool b) { precompute_gradient = b; }
   
   virtual void local_render(RendererP, RenderingSetP);
 
@@ -84,6 +89,10 @@ private:
   int raysPerPixel;
   float cutoff_value;
   int cutoff_type;
+  bool precompute_gradient;
+
+  // this frame's gradient fields, replaced by local_render and read by Trace
+  SchlierenGradient::FieldsP gradients;
 
   //! a Work unit to instruct Galaxy processes to begin rendering
   class NormalizeSchlieren2ImagesMsg : public Work
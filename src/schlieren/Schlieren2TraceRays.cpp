@@ -46,6 +46,42 @@ Schlieren2TraceRays::~Schlieren2TraceRays()
 {
 }
 
+void
+Schlieren2TraceRays::allocate_ispc()
+{
+  ispc = ispc::Schlieren2TraceRays_allocate();
+}
+
+void
+Schlieren2TraceRays::initialize_ispc()
+{
+  ispc::Schlieren2TraceRays_initialize(GetIspc());
+}
+
+void    
+Schlieren2TraceRays::destroy_ispc()
+{            
+  ispc::Schlieren2TraceRays_destroy(GetIspc());
+}
+
+void
+Schlieren2TraceRays::SetGradientField(SchlierenGradientP g)
+{
+  // Hold a reference so the field outlives the trace even if the cache drops it
+
+  gradient = g;
+
+  if (g)
+  {
+    vec3i c = g->GetCounts();
+    vec3f o = g->GetOrigin();
+    vec3f d = g->GetDeltas();
+    ispc::Schlieren2TraceRays_SetGradientField(GetIspc(), g->GetGradients(), c.x, c.y, c.z, o.x, o.y, o.z, d.x, d.y, d.z);
+  }
+  else
+    ispc::Schlieren2TraceRays_SetGradientField(GetIspc(), NULL, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+}
+
 RayList *
 Schlieren2TraceRays::Trace(Lighting* lights, VisualizationP visualization, RayList *raysIn)
 {
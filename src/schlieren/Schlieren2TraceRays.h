@@ -34,6 +34,7 @@
 #include "IspcObject.h"
 #include "Lighting.h"
 #include "Rays.h"
+#include "SchlierenGradient.h"
 #include "Visualization.h"
 
 namespace gxy
@@ -58,7 +59,15 @@ public:
    */
   RayList *Trace(Lighting* lights, VisualizationP visualization, RayList * raysIn);
 
+  //! use the given precomputed gradient field rather than computing gradients from the volume
+  void SetGradientField(SchlierenGradientP);
+
 protected:
+  virtual void allocate_ispc();
+  virtual void initialize_ispc();
+  virtual void destroy_ispc();
+
+  SchlierenGradientP gradient;
 
 };
 
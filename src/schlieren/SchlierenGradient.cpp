@@ -0,0 +1,160 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#include "SchlierenGradient.h"
+
+namespace gxy
+{
+
+std::map<Key, SchlierenGradientP> SchlierenGradient::cache;
+pthread_mutex_t SchlierenGradient::cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+SchlierenGradient::SchlierenGradient(VolumeP v)
+{
+  v->get_ghosted_local_counts(counts.x, counts.y, counts.z);
+  v->get_ghosted_local_origin(origin.x, origin.y, origin.z);
+  v->get_deltas(deltas.x, deltas.y, deltas.z);
+
+  modification_count = v->getModificationCount();
+  gradients = new float[3 * counts.x * counts.y * counts.z];
+
+  if (v->isFloat())
+    compute((float *)v->get_samples(), v->get_number_of_components());
+  else
+    compute((unsigned char *)v->get_samples(), v->get_number_of_components());
+}
+
+SchlierenGradient::~SchlierenGradient()
+{
+  delete[] gradients;
+}
+
+// Central differences in the interior, one-sided differences on the faces
+// of the partition.   Only the first component of the volume is used.
+
+template <typename T>
+void
+SchlierenGradient::compute(T *samples, int ncomp)
+{
+  int sx = ncomp;
+  int sy = ncomp * counts.x;
+  int sz = ncomp * counts.x * counts.y;
+
+  float *g = gradients;
+  for (int k = 0; k < counts.z; k++)
+    for (int j = 0; j < counts.y; j++)
+      for (int i = 0; i < counts.x; i++)
+      {
+        T *s = samples + k*sz + j*sy + i*sx;
+
+        int i0 = (i > 0) ? -sx : 0, i1 = (i < counts.x-1) ? sx : 0;
+        int j0 = (j > 0) ? -sy : 0, j1 = (j < counts.y-1) ? sy : 0;
+        int k0 = (k > 0) ? -sz : 0, k1 = (k < counts.z-1) ? sz : 0;
+
+        *g++ = (i1 != i0) ? (float(s[i1]) - float(s[i0])) / (((i1 - i0) / sx) * deltas.x) : 0.0;
+        *g++ = (j1 != j0) ? (float(s[j1]) - float(s[j0])) / (((j1 - j0) / sy) * deltas.y) : 0.0;
+        *g++ = (k1 != k0) ? (float(s[k1]) - float(s[k0])) / (((k1 - k0) / sz) * deltas.z) : 0.0;
+      }
+}
+
+SchlierenGradientP
+SchlierenGradient::Get(VolumeP v)
+{
+  if (! v)
+    return nullptr;
+
+  static pthread_once_t hooked = PTHREAD_ONCE_INIT;
+  pthread_once(&hooked, [](){ Volume::AddDestroyHook(SchlierenGradient::release); });
+
+  pthread_mutex_lock(&cache_lock);
+
+  SchlierenGradientP g;
+
+  auto it = cache.find(v->getkey());
+  if (it != cache.end() && it->second->modification_count == v->getModificationCount())
+    g = it->second;
+  else
+  {
+    g = SchlierenGradientP(new SchlierenGradient(v));
+    cache[v->getkey()] = g;
+  }
+
+  pthread_mutex_unlock(&cache_lock);
+  return g;
+}
+
+SchlierenGradientP
+SchlierenGradient::Get(VisualizationP visualization)
+{
+  for (int i = 0; i < visualization->GetNumberOfVis(); i++)
+  {
+    VolumeVisP vvis = VolumeVis::Cast(visualization->GetVis(i));
+    if (vvis)
+      return Get(Volume::Cast(vvis->GetTheData()));
+  }
+
+  return nullptr;
+}
+
+SchlierenGradient::FieldsP
+SchlierenGradient::Prepare(RenderingSetP renderingSet)
+{
+  FieldsP fields = FieldsP(new Fields);
+
+  for (int i = 0; i < renderingSet->GetNumberOfRenderings(); i++)
+  {
+    VisualizationP visualization = renderingSet->GetRendering(i)->GetTheVisualization();
+    if (visualization)
+      (*fields)[visualization->getkey()] = Get(visualization);
+  }
+
+  return fields;
+}
+
+SchlierenGradientP
+SchlierenGradient::Find(FieldsP fields, VisualizationP visualization)
+{
+  if (fields)
+  {
+    auto it = fields->find(visualization->getkey());
+    if (it != fields->end())
+      return it->second;
+  }
+
+  return Get(visualization);
+}
+
+void
+SchlierenGradient::release(Key k)
+{
+  pthread_mutex_lock(&cache_lock);
+  cache.erase(k);
+  pthread_mutex_unlock(&cache_lock);
+}
+
+void
+SchlierenGradient::Clear()
+{
+  pthread_mutex_lock(&cache_lock);
+  cache.clear();
+  pthread_mutex_unlock(&cache_lock);
+}
+
+}
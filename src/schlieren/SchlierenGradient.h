@@ -0,0 +1,110 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file SchlierenGradient.h 
+ * \brief a precomputed gradient field used to bend Schlieren rays
+ * \ingroup render
+ */
+
+#include <map>
+#include <memory>
+#include <pthread.h>
+
+#include "dtypes.h"
+#include "KeyedObject.h"
+#include "Rendering.h"
+#include "RenderingSet.h"
+#include "Visualization.h"
+#include "Volume.h"
+
+namespace gxy
+{
+
+class SchlierenGradient;
+typedef std::shared_ptr<SchlierenGradient> SchlierenGradientP;
+
+//! a precomputed gradient field used to bend Schlieren rays
+/*! The Schlieren tracers need the gradient of the refractive index at
+ * every step at which the sample changes.   Computing it on the fly takes
+ * six extra samples of the volume; instead, the gradient of the local
+ * (ghosted) partition of the volume can be computed once by central
+ * differences and stored as a 3-component grid with the same geometry,
+ * so each step costs a single trilinear fetch.
+ *
+ * Gradient fields are cached per process by the key of the source
+ * Volume, recomputed when the Volume is modified and dropped when it is
+ * destroyed.   The renderers look them up once per frame in Prepare, so
+ * tracing never touches the cache.
+ * \ingroup render
+ */
+class SchlierenGradient
+{
+public:
+  ~SchlierenGradient();
+
+  //! gradient fields by Visualization key, as found by Prepare
+  typedef std::map<Key, SchlierenGradientP> Fields;
+  typedef std::shared_ptr<Fields> FieldsP;
+
+  //! return the gradient field of the given Volume, computing it if necessary
+  static SchlierenGradientP Get(VolumeP);
+
+  //! return the gradient field of the first volume in the Visualization, or NULL
+  static SchlierenGradientP Get(VisualizationP);
+
+  //! compute gradient fields for every Visualization in the RenderingSet
+  /*! Called before the RenderingSet spawns rays so the cost is paid before tracing starts
+   * \returns the fields by Visualization key, for Find
+   */
+  static FieldsP Prepare(RenderingSetP);
+
+  //! return the gradient field of the Visualization from Prepare's result, without locking
+  /*! Falls back on Get if Prepare did not see the Visualization */
+  static SchlierenGradientP Find(FieldsP, VisualizationP);
+
+  //! drop all cached gradient fields
+  static void Clear();
+
+  float *GetGradients() { return gradients; }   //!< xyz gradient triples, x varying fastest
+  vec3i GetCounts() { return counts; }          //!< the grid dimensions
+  vec3f GetOrigin() { return origin; }          //!< the world-space location of the first grid point
+  vec3f GetDeltas() { return deltas; }          //!< the grid spacing
+
+private:
+  SchlierenGradient(VolumeP);
+
+  template <typename T> void compute(T *samples, int ncomp);
+
+  //! Volume::DestroyHook to drop a Volume's entry
+  static void release(Key);
+
+  float *gradients;
+  vec3i counts;
+  vec3f origin;
+  vec3f deltas;
+  int modification_count;   // of the source Volume when computed
+
+  static std::map<Key, SchlierenGradientP> cache;
+  static pthread_mutex_t cache_lock;
+};
+
+}
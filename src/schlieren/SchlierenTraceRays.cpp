@@ -46,6 +46,42 @@ SchlierenTraceRays::~SchlierenTraceRays()
 {
 }
 
+void
+SchlierenTraceRays::allocate_ispc()
+{
+  ispc = ispc::SchlierenTraceRays_allocate();
+}
+
+void
+SchlierenTraceRays::initialize_ispc()
+{
+  ispc::SchlierenTraceRays_initialize(GetIspc());
+}
+
+void    
+SchlierenTraceRays::destroy_ispc()
+{            
+  ispc::SchlierenTraceRays_destroy(GetIspc());
+}
+
+void
+SchlierenTraceRays::SetGradientField(SchlierenGradientP g)
+{
+  // Hold a reference so the field outlives the trace even if the cache drops it
+
+  gradient = g;
+
+  if (g)
+  {
+    vec3i c = g->GetCounts();
+    vec3f o = g->GetOrigin();
+    vec3f d = g->GetDeltas();
+    ispc::SchlierenTraceRays_SetGradientField(GetIspc(), g->GetGradients(), c.x, c.y, c.z, o.x, o.y, o.z, d.x, d.y, d.z);
+  }
+  else
+    ispc::SchlierenTraceRays_SetGradientField(GetIspc(), NULL, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+}
+
 RayList *
 SchlierenTraceRays::Trace(Lighting* lights, VisualizationP visualization, RayList *raysIn)
 {
@@ -50,6 +50,8 @@ syntax(char *a)
   cerr << "  -S2        Snell integration, accumulation at hit point" << endl;
   cerr << "  -c         client/server interface" << endl;
   cerr << "  -N         max number of simultaneous renderings (VERY large)" << endl;
+  cerr << "  -G         bend rays using a precomputed gradient field (overrides state file)" << endl;
+  cerr << "  -g         bend rays using on-the-fly gradients (overrides state file)" << endl;
   exit(1);
 }
 
@@ -77,6 +79,7 @@ int main(int argc,  char *argv[])
   int maxConcurrentRenderings = 99999999;
   bool override_windowsize = false;
   bool original_algorithm = true;
+  int precompute_gradient = -1;
 
   for (int i = 1; i < argc; i++)
   {
@@ -93,6 +96,8 @@ int main(int argc,  char *argv[])
         override_windowsize = true;
     }
     else if (!strcmp(argv[i], "-N")) maxConcurrentRenderings = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-G")) precompute_gradient = 1;
+    else if (!strcmp(argv[i], "-g")) precompute_gradient = 0;
     else if (statefile == "")   statefile = argv[i];
     else syntax(argv[0]);
   }
@@ -159,6 +164,14 @@ int main(int argc,  char *argv[])
 
     theRenderer->LoadStateFromDocument(*doc);
 
+    if (precompute_gradient != -1)
+    {
+      if (original_algorithm)
+        Schlieren::Cast(theRenderer)->SetPrecomputeGradient(precompute_gradient == 1);
+      else
+        Schlieren2::Cast(theRenderer)->SetPrecomputeGradient(precompute_gradient == 1);
+    }
+
     vector<CameraP> theCameras;
     if (! Camera::LoadCamerasFromJSON(*doc, theCameras))
     {
@@ -253,6 +266,7 @@ int main(int argc,  char *argv[])
     theApplication.SyncApplication();
 
     long t_rendering_start = my_time();
+    long total_rays = 0, trace_time = 0;
 
     for (auto& rs : theRenderingSets)
     {
@@ -292,6 +306,7 @@ int main(int argc,  char *argv[])
 #endif
 #endif
       rs->WaitForDone();
+      trace_time += my_time() - t0;
 
       if (original_algorithm)
         Schlieren::Cast(theRenderer)->NormalizeImages(rs);
@@ -301,11 +316,22 @@ int main(int argc,  char *argv[])
 
       long t1 = my_time();
       cout << rs->GetNumberOfRenderings() << ": " << ((t1 - t0) / 1000000000.0) << " seconds" << endl;
+
+      for (int i = 0; i < rs->GetNumberOfRenderings(); i++)
+      {
+        int w, h;
+        rs->GetRendering(i)->GetTheSize(w, h);
+        total_rays += w * h;
+      }
     }
 
     long t_done = my_time();
     cout << "TIMING total " << (t_done - t_rendering_start) / 1000000000.0 << " seconds" << endl;
 
+    // Exclude normalization and image output so the two gradient modes compare on tracing alone
+
+    cout << "TIMING rays/sec " << total_rays / (trace_time / 1000000000.0) << endl;
+
     theDatasets = nullptr;
 
     theRenderingSets.clear();
@@ -3,6 +3,7 @@
 #include "Volume.h"
 
 #include <pthread.h>
+#include <algorithm>
 
 using namespace std;
 
@@ -152,12 +153,11 @@ RungeKutta::local_trace(int id, int n, vec3f& p, vec3f& u, float t)
 
   VolumeP v = GetVectorField();
 
-  // h will be the step size
+  // h will be the step size.   It is a multiple of the size of the cell
+  // containing the current point, so it adapts to the local resolution
+  // of refined (AMR) vector fields; for uniform volumes its constant.
 
-  vec3f d;
-  v->get_deltas(d.x, d.y, d.z);
-
-  float h = stepsize * (d.x > d.y ? d.y > d.z ? d.z : d.y : d.x > d.z ? d.z : d.x);
+  float h;
 
   // If this is the first point, find a reasonable up
 
@@ -190,6 +190,8 @@ RungeKutta::local_trace(int id, int n, vec3f& p, vec3f& u, float t)
   bool terminated = false; vec3f last_tangent;
   while (! terminated)
   {
+    h = stepsize * v->CellSize(p);
+
     float vel[3];
     v->Sample(p, vel);
 
@@ -375,6 +377,8 @@ RungeKutta::local_trace(int id, int n, vec3f& p, vec3f& u, float t)
     ti->second->push_back(seg);
   }
 
+  store.SetDirty();
+
   Unlock();
 
   if (terminated || next == -1)
@@ -386,4 +390,109 @@ RungeKutta::local_trace(int id, int n, vec3f& p, vec3f& u, float t)
     _Trace(next, id, n, pLast, uLast, tLast);
 }
 
+void
+TrajectoryStore::Build(std::map<int, trajectory>& trajectories)
+{
+  std::vector<segment> segs;
+  for (auto t : trajectories)
+    for (auto s : *t.second)
+      if (s->times.size())
+        segs.push_back(s);
+
+  std::sort(segs.begin(), segs.end(), [](const segment& a, const segment& b) { return a->times[0] < b->times[0]; });
+
+  int n = 0;
+  for (auto s : segs)
+    n += s->times.size();
+
+  points.resize(n);
+  times.resize(n);
+  segments.resize(segs.size());
+
+  n = 0;
+  for (int i = 0; i < segs.size(); i++)
+  {
+    segment s = segs[i];
+    int k = s->times.size();
+
+    memcpy(points.data() + n, s->points.data(), k*sizeof(vec3f));
+    memcpy(times.data() + n, s->times.data(), k*sizeof(float));
+
+    segments[i].first = n;
+    segments[i].count = k;
+    segments[i].tmin = s->times[0];
+    segments[i].tmax = s->times[k-1];
+
+    n += k;
+  }
+
+  lo.resize(segments.size());
+  hi.resize(segments.size());
+  active.clear();
+  next_segment = 0;
+  windowed = false;
+  dirty = false;
+}
+
+void
+TrajectoryStore::SetWindow(float t0, float t1, std::vector<Span>& spans)
+{
+  spans.clear();
+
+  // If the window has moved backwards start over
+
+  if (! windowed || t0 < window_t0 || t1 < window_t1)
+  {
+    active.clear();
+    next_segment = 0;
+  }
+
+  // Advance the bounds of segments that were in the last window, retiring
+  // those that the window has passed
+
+  int n = 0;
+  for (auto s : active)
+  {
+    SegmentInfo& si = segments[s];
+    if (si.tmax <= t0)
+      continue;
+
+    float *st = times.data() + si.first;
+    while (lo[s] < si.count && st[lo[s]] <= t0) lo[s]++;
+    while (hi[s] < si.count && st[hi[s]] < t1) hi[s]++;
+
+    active[n++] = s;
+  }
+  active.resize(n);
+
+  // Activate segments that start before the end of the window
+
+  for ( ; next_segment < segments.size() && segments[next_segment].tmin < t1; next_segment++)
+  {
+    int s = next_segment;
+    SegmentInfo& si = segments[s];
+    if (si.tmax <= t0)
+      continue;
+
+    float *st = times.data() + si.first;
+    lo[s] = std::upper_bound(st, st + si.count, t0) - st;
+    hi[s] = std::lower_bound(st, st + si.count, t1) - st;
+
+    active.push_back(s);
+  }
+
+  for (auto s : active)
+    if ((hi[s] - lo[s]) > 1)
+    {
+      Span span;
+      span.first = segments[s].first + lo[s];
+      span.count = hi[s] - lo[s];
+      spans.push_back(span);
+    }
+
+  windowed = true;
+  window_t0 = t0;
+  window_t1 = t1;
+}
+
 }
@@ -26,6 +26,59 @@ struct _segment
 typedef std::shared_ptr<_segment> segment;
 typedef std::shared_ptr<std::vector<segment>> trajectory;
 
+// A compact, time-indexed copy of the points and times of the local 
+// trajectories, used to extract the portions of the trajectories that fall
+// in a time window.   Samples of all segments are stored contiguously, segment 
+// by segment, with the segments sorted by their starting time.   Since times
+// increase monotonically along a segment, the window within a segment is 
+// found by binary search.   When successive windows move forward in time 
+// (as when animating) only the change is processed: the window bounds of 
+// segments already in the window are advanced, segments are activated when 
+// the window reaches their start and retired when it passes their end.
+
+class TrajectoryStore
+{
+public:
+  TrajectoryStore() : dirty(true), windowed(false), next_segment(0) {}
+
+  //! a run of count contiguous samples starting at first
+  struct Span
+  {
+    int first, count;
+  };
+
+  //! rebuild the store from the given trajectories
+  void Build(std::map<int, trajectory>& trajectories);
+
+  //! set the window to samples with t0 < time < t1 and return the runs (of two or more samples) within it
+  void SetWindow(float t0, float t1, std::vector<Span>& spans);
+
+  vec3f *GetPoints() { return points.data(); }
+  float *GetTimes() { return times.data(); }
+
+  bool IsDirty() { return dirty; }
+  void SetDirty() { dirty = true; }
+
+private:
+  struct SegmentInfo
+  {
+    int first, count;
+    float tmin, tmax;
+  };
+
+  bool dirty;
+
+  std::vector<vec3f> points;
+  std::vector<float> times;
+  std::vector<SegmentInfo> segments;
+
+  bool windowed;
+  float window_t0, window_t1;
+  int next_segment;
+  std::vector<int> active;
+  std::vector<int> lo, hi;
+};
+
 #define RUNGEKUTTA_INFLIGHT_OFFSET  999999999
 
 class RungeKutta: public KeyedDataObject
@@ -69,6 +122,16 @@ public:
 
   trajectory get_trajectory(int id) { return trajectories[id]; }
 
+  //! the time-indexed store of the local trajectories, rebuilt if traces have been added
+  TrajectoryStore& get_trajectory_store()
+  {
+    Lock();
+    if (store.IsDirty())
+      store.Build(trajectories);
+    Unlock();
+    return store;
+  }
+
   bool SetVectorField(VolumeP v);
   VolumeP GetVectorField() { return vectorField; }
 
@@ -118,6 +181,7 @@ protected:
   virtual unsigned char* deserialize(unsigned char *ptr);
 
   std::map<int, trajectory> trajectories;
+  TrajectoryStore store;
 
   int max_steps;
   float stepsize;
@@ -46,32 +46,23 @@ public:
 
     plp->CopyPartitioning(rkp);
 
-    std::vector<int> keys;
-    rkp->get_keys(keys);
-
     plp->clear();
 
+    // Find the runs of samples in the window.   When successive calls move
+    // the window forward the store only processes the change.
+
+    TrajectoryStore& store = rkp->get_trajectory_store();
+
+    std::vector<TrajectoryStore::Span> spans;
+    store.SetWindow(t - dt, t, spans);
+
     // How much space do I need?
 
-    int np = 0, nc = 0, ii = 0;
-    for (auto id = keys.begin(); id != keys.end(); id++, ii++)
+    int np = 0, nc = 0;
+    for (auto& span : spans)
     {
-      trajectory traj = rkp->get_trajectory(*id);
-      for (auto segp = traj->begin(); segp != traj->end(); segp++)
-      {
-        auto seg = *segp;
-
-        auto k = 0;
-        for (auto n = 0; n < seg->times.size(); n++)
-          if (seg->times[n] > (t - dt) && seg->times[n] < t)
-            k++;
-
-          if (k > 1)
-          {
-            np += k;
-            nc += k - 1;
-          }
-      }
+      np += span.count;
+      nc += span.count - 1;
     }
 
     plp->allocate(np, nc);
@@ -80,30 +71,18 @@ public:
     float *dbuf = plp->GetData();
     int   *cbuf = plp->GetConnectivity();
 
+    vec3f *points = store.GetPoints();
+    float *times  = store.GetTimes();
+
     np = 0; nc = 0;
-    for (auto id = keys.begin(); id != keys.end(); id++)
+    for (auto& span : spans)
     {
-      trajectory traj = rkp->get_trajectory(*id);
-      for (auto segp = traj->begin(); segp != traj->end(); segp++)
-      {
-        auto seg = *segp;
-        auto k = 0, ik = -1;
-        for (auto n = 0; n < seg->times.size(); n++)
-          if (seg->times[n] > (t - dt) && seg->times[n] < t)
-          {
-            k++;
-            if (ik < 0) ik = n;
-          }
-
-        if (k > 1)
-        {
-          memcpy((void *)(pbuf + np), ((vec3f *)seg->points.data()) + ik, k*sizeof(vec3f));
-          memcpy((void *)(dbuf + np), ((float *)seg->times.data()) + ik,  k*sizeof(float));
-          for (int i = 0; i < k; i++, np++)
-            if (i < (k - 1))
-              cbuf[nc++] = np;
-        }
-      }
+      int k = span.count;
+      memcpy((void *)(pbuf + np), points + span.first, k*sizeof(vec3f));
+      memcpy((void *)(dbuf + np), times + span.first,  k*sizeof(float));
+      for (int i = 0; i < k; i++, np++)
+        if (i < (k - 1))
+          cbuf[nc++] = np;
     }
 
     MPI_Barrier(c);
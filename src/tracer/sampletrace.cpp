@@ -284,6 +284,7 @@ main(int argc, char * argv[])
     theSampler->Commit();
     theSampler->Start(theSamplingRenderingSet);
     theSamplingRenderingSet->WaitForDone();
+    theSampler->CollectSamples();
 
     samples->Commit();
 
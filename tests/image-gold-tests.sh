@@ -160,6 +160,13 @@ if [ "${TRAVIS_OS_NAME}" == "linux" ]; then
   ${GXY_CREATE_PARTITION_DOC} -v radial-0-eightBalls.vol 2 > partition.json
   ${GXY_PARTITION_VTUS} partition.json streamlines.vtu eightBalls-points.vtu oneBall-mesh.vtu
   run_tests
+
+  # wave termination must give the same images when message delivery is reordered
+  export GXY_TERMINATION=wave
+  export GXY_MESSAGE_DELAY=2000
+  report "Running MPI tests with wave termination and randomly delayed messages..."
+  run_tests
+  unset GXY_TERMINATION GXY_MESSAGE_DELAY
 fi
 
 if [ ${FAILS} == 0 ]; then